@@ -4,11 +4,16 @@
 #include <stdint.h>
 #include <stdio.h>
 
+#include "common.h"
+
 struct gb_core;
 
 #define SAMPLING_RATE 44100
 #define AUDIO_BUFFER_SIZE 512
 
+/* TCycles the APU may lag behind, bounds the added audio latency to about 1 ms */
+#define APU_CATCH_UP_PERIOD 4096
+
 #define NRx4_TRIGGER_MASK (1 << 7)
 #define NRx4_LENGTH_ENABLE (1 << 6)
 #define NRx4_UNUSED_PART (0x7 << 3)
@@ -110,9 +115,16 @@ struct apu
     uint32_t sampling_counter;
 
     uint16_t previous_div_apu;
+
+    uint64_t sync_time; /* Master clock time the APU has run up to, see apu_catch_up() */
 };
 
-void apu_init(struct apu *apu);
+static inline int is_apu_register(uint16_t address)
+{
+    return address >= NR10 && address < WAVE_RAM + WAVE_RAM_SIZE;
+}
+
+void apu_init(struct gb_core *gb);
 
 void handle_trigger_event_ch1(struct gb_core *gb);
 void handle_trigger_event_ch2(struct gb_core *gb);
@@ -121,11 +133,26 @@ void handle_trigger_event_ch4(struct gb_core *gb);
 
 void apu_reload_timer(struct gb_core *gb, uint8_t ch_number);
 
-void apu_tick(struct gb_core *gb);
+/*
+ * The APU lags behind the CPU like the PPU, it never requests interrupts so it is only caught up before its registers
+ * or DIV are accessed, STOP, save states and every APU_CATCH_UP_PERIOD for the audio output.
+ */
+void apu_catch_up(struct gb_core *gb);
 
 void apu_turn_off(struct gb_core *gb);
 
-void apu_write_reg(struct gb_core *gb, uint16_t address, uint8_t val);
+/* Register write side effects, see io_registers.h. The APU must be caught up */
+void apu_write_nr10(struct gb_core *gb, uint16_t address, uint8_t val);
+void apu_write_nrx1(struct gb_core *gb, uint16_t address, uint8_t val);
+void apu_write_nrx2(struct gb_core *gb, uint16_t address, uint8_t val);
+void apu_write_nr30(struct gb_core *gb, uint16_t address, uint8_t val);
+void apu_write_nrx4(struct gb_core *gb, uint16_t address, uint8_t val);
+void apu_write_nr52(struct gb_core *gb, uint16_t address, uint8_t val);
+/* Registers only writable while the APU is on */
+void apu_write_powered(struct gb_core *gb, uint16_t address, uint8_t val);
+
+uint8_t apu_read_wave_ram(struct gb_core *gb, uint16_t address);
+void apu_write_wave_ram(struct gb_core *gb, uint16_t address, uint8_t val);
 
 void apu_serialize(FILE *stream, struct apu *apu);
 
@@ -5,21 +5,78 @@
 #include <stdint.h>
 #include <stdio.h>
 
+/* 8 bit registers aliased with their 16 bit pair, the low register must sit at the lower address on little endian */
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define CPU_REGISTER_PAIR(HI, LO)                                                                                      \
+    union                                                                                                              \
+    {                                                                                                                  \
+        struct                                                                                                         \
+        {                                                                                                              \
+            uint8_t HI;                                                                                                \
+            uint8_t LO;                                                                                                \
+        };                                                                                                             \
+        uint16_t HI##LO;                                                                                               \
+    }
+#else
+#define CPU_REGISTER_PAIR(HI, LO)                                                                                      \
+    union                                                                                                              \
+    {                                                                                                                  \
+        struct                                                                                                         \
+        {                                                                                                              \
+            uint8_t LO;                                                                                                \
+            uint8_t HI;                                                                                                \
+        };                                                                                                             \
+        uint16_t HI##LO;                                                                                               \
+    }
+#endif
+
+/*
+ * Lazy flags: ALU instructions only record their operands and result, the F register is rebuilt on demand by
+ * get_f() or flags_materialise(). FLAGS_MATERIALISED means f holds every flag.
+ */
+enum flags_kind
+{
+    FLAGS_MATERIALISED = 0,
+    FLAGS_ADD, /* add, adc */
+    FLAGS_SUB, /* sub, sbc, cp */
+    FLAGS_INC, /* inc r, carry is kept in f */
+    FLAGS_DEC, /* dec r, carry is kept in f */
+    FLAGS_AND,
+    FLAGS_OR, /* or, xor */
+};
+
+/* Micro-program running on the microcoded CPU (see microcode.h), MC_NONE at an instruction boundary */
+enum mc_program
+{
+    MC_NONE = 0,
+    MC_OPCODE,
+    MC_INTERRUPT,
+};
+
 struct cpu
 {
     uint8_t a;
     uint8_t f;
-    uint8_t b;
-    uint8_t c;
-    uint8_t d;
-    uint8_t e;
-    uint8_t h;
-    uint8_t l;
+    CPU_REGISTER_PAIR(b, c);
+    CPU_REGISTER_PAIR(d, e);
+    CPU_REGISTER_PAIR(h, l);
 
     uint16_t sp;
     uint16_t pc;
 
     uint8_t ime;
+
+    uint8_t flags_kind;
+    uint8_t flags_lhs;
+    uint8_t flags_rhs;
+    uint16_t flags_result;
+
+    /* Microcoded CPU state, lets an instruction be suspended between two MCycles */
+    uint8_t mc_program;
+    uint8_t mc_step;
+    uint8_t mc_opcode;
+    uint8_t mc_z; /* Temporary registers, hold the operand or the address being built */
+    uint8_t mc_w;
 };
 
 void cpu_set_registers_post_boot(struct cpu *cpu, int checksum);
@@ -0,0 +1,45 @@
+#ifndef CORE_DECODE_CACHE_H
+#define CORE_DECODE_CACHE_H
+
+#include <stdint.h>
+
+struct gb_core;
+
+/* Direct mapped on the low bits of PC, the tag disambiguates banks */
+#define DECODE_CACHE_SIZE 0x2000
+#define DECODE_CACHE_MASK (DECODE_CACHE_SIZE - 1)
+
+/* Instruction pre-decoded from ROM, bytes holds the opcode followed by its immediate operands */
+struct decoded_instr
+{
+    int (*handler)(struct gb_core *gb); /* See opcode_handlers */
+    uint32_t tag;                       /* ROM offset of the instruction + 1, 0 when the entry is empty */
+    uint8_t length;
+    uint8_t bytes[3];
+    uint8_t superop; /* Loop recognised at this address, see superop.h */
+};
+
+struct decode_cache
+{
+    /* Instruction being executed and its address, NULL when it was not fetched through the cache */
+    const struct decoded_instr *current;
+    uint16_t current_pc;
+
+    /* ROM offsets of the banks mapped at 0x0000 and 0x4000 */
+    uint32_t rom_base[2];
+
+    struct decoded_instr entries[DECODE_CACHE_SIZE];
+};
+
+void decode_cache_init(struct decode_cache *cache);
+
+/* Must be called whenever the ROM image changes */
+void decode_cache_flush(struct gb_core *gb);
+
+/* Must be called whenever the MBC may have switched ROM banks */
+void decode_cache_update_banks(struct gb_core *gb);
+
+const struct decoded_instr *decode_cache_fill(struct gb_core *gb, struct decoded_instr *entry, uint16_t address,
+                                              uint32_t tag);
+
+#endif
@@ -1,8 +1,34 @@
 #ifndef CORE_DISASSEMBLER_H
 #define CORE_DISASSEMBLER_H
 
+#include <stdint.h>
+
 struct gb_core;
 
 int next_op(struct gb_core *gb);
 
+/* Upper bound for one next_ops() call, one scanline keeps the frontend responsive */
+#define NEXT_OPS_MAX_MCYCLES 114
+
+/*
+ * Run instructions until one halts the CPU, an interrupt may be serviced, the next scheduler event is due, an idle loop
+ * is tracked or max_mcycles have elapsed. Returns the MCycles spent or -1 on an undefined opcode. Same as calling
+ * next_op() then check_interrupt() in a loop, the caller must still call check_interrupt() once afterwards.
+ */
+int next_ops(struct gb_core *gb, int max_mcycles);
+
+/* Fetch the opcode at PC (opcode MCycle), handles the HALT bug */
+uint8_t fetch_opcode(struct gb_core *gb);
+
+/* Handler of every opcode, runs the instruction after its opcode MCycle and returns its MCycles or -1 */
+extern int (*const opcode_handlers[256])(struct gb_core *gb);
+
+/* Run the handler of an already fetched opcode */
+int execute_opcode(struct gb_core *gb, uint8_t opcode);
+
+/* Apply a CB opcode to operand, the (HL) operand being already read, doesn't tick */
+int prefix_execute(struct gb_core *gb, uint8_t opcode, uint8_t *operand);
+
+const char *get_opcode_mnemonic(uint8_t opcode);
+
 #endif
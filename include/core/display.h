@@ -4,7 +4,6 @@
 #include <stdint.h>
 
 struct gb_core;
-struct pixel;
 
 struct color
 {
@@ -15,7 +14,8 @@ struct color
 
 void *get_frame_buffer(void);
 
-void draw_pixel(struct gb_core *gb, struct pixel p);
+/* Compose the pixels from to to - 1 of the current line, see pixel_kernels.h */
+void draw_line(struct gb_core *gb, const uint8_t *bg, const uint8_t *obj, unsigned int from, unsigned int to);
 
 void lcd_off(struct gb_core *gb);
 
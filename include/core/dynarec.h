@@ -0,0 +1,26 @@
+#ifndef CORE_DYNAREC_H
+#define CORE_DYNAREC_H
+
+struct gb_core;
+
+/*
+ * Optional x86-64 basic block recompiler for code running from ROM.
+ *
+ * Hot straight-line blocks of register only instructions are compiled to host code. Blocks stop before any instruction
+ * accessing memory or changing control flow, such instructions are always left to the interpreter. A block runs as
+ * many instructions as fit before the next scheduler event and its MCycles are charged at once on exit, so no
+ * interrupt can be requested in between and timing is identical to the interpreter. On other hosts dynarec_run()
+ * never executes anything.
+ *
+ * The code buffer is mapped writable while a block is compiled and executable the rest of the time.
+ */
+
+/* Returns the MCycles spent in the block at PC, 0 if none was run and the interpreter must handle PC */
+int dynarec_run(struct gb_core *gb);
+
+/* Drop every compiled block, must be called whenever the ROM image changes */
+void dynarec_flush(struct gb_core *gb);
+
+void dynarec_free(struct gb_core *gb);
+
+#endif
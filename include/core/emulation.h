@@ -17,6 +17,11 @@ struct global_settings
     char *open_rom;
     double render_period_ns;
     bool apu_channels_enable[4];
+    bool dynarec;
+    bool idle_loop_detection;
+    bool superinstructions;
+    bool microcoded_cpu;
+    bool scanline_renderer; /* Default PPU renderer of the ROMs, see ppu_render_sync() */
 };
 
 void reset_gb(struct gb_core *gb);
@@ -27,4 +32,17 @@ int load_rom(struct gb_core *gb, char *rom_path, char *boot_rom_path);
 
 void tick_m(struct gb_core *gb);
 
+/* Same as mcycles calls to tick_m(), the caller must make sure no event is due before the last one */
+void tick_mcycles(struct gb_core *gb, int mcycles);
+
+/* Upper bound for one halt_fast_forward() call, one scanline keeps the frontend responsive */
+#define HALT_FAST_FORWARD_MAX_MCYCLES 114
+
+/*
+ * Step a halted CPU until an enabled interrupt is requested or max_mcycles have elapsed, returns the MCycles spent.
+ * Time moves from one scheduler event to the next, which is cycle identical to calling tick_m() then
+ * check_interrupt() in a loop. The caller must still call check_interrupt() once afterwards to wake the CPU up.
+ */
+int halt_fast_forward(struct gb_core *gb, int max_mcycles);
+
 #endif
@@ -1,51 +1,92 @@
 #ifndef CORE_GB_H
 #define CORE_GB_H
 
+#include <stdalign.h>
+
 #include "apu.h"
 #include "common.h"
 #include "cpu.h"
+#include "decode_cache.h"
+#include "idle_loop.h"
+#include "mbc_base.h"
+#include "obj_lines.h"
+#include "page_table.h"
 #include "ppu.h"
-
+#include "scheduler.h"
+#include "tile_cache.h"
+
+#define CACHE_LINE_SIZE 64
+
+/*
+ * A core is a single cache line aligned block holding the CPU, every component, the decode cache and the emulated
+ * memory of the console (WRAM, HRAM, IO, OAM, VRAM, cartridge RAM and boot ROM, both at their largest size), so one
+ * allocation is enough per instance. Only the ROM image (shared between cores, see rom_image.h), the MBC registers and
+ * the dynarec code buffer, which must be mapped executable, live outside of it. It is not a self contained snapshot,
+ * save states go through gb_core_serialize() and gb_core_load_from_file().
+ *
+ * Fields are ordered from hottest to coldest: what every instruction touches first (CPU, scheduler, decode cache, page
+ * table, WRAM and HRAM), then the components only run on catch-ups, and the pointers, statistics and callbacks last.
+ * Each memory region starts on its own cache line.
+ */
 struct gb_core
 {
-    /* Components */
+    /* Hot: touched by every instruction */
     struct cpu cpu;
-    struct ppu ppu;
-    struct apu apu;
+    struct scheduler scheduler;
+    uint64_t tcycles_since_sync;
+
+    uint8_t pending_interrupts; /* IF & IE, see interrupts.h */
+    uint8_t halt;
+    uint8_t halt_bug;
+    uint8_t stop;
+
+    struct decode_cache decode_cache; /* Entries last, the lookup only touches one of them */
 
     struct memory_map
     {
-        uint32_t boot_rom_size;
-        uint8_t *boot_rom;
-        uint8_t *vram;
-        uint8_t *wram;
-        uint8_t oam[OAM_SIZE];
-        uint8_t *unusable_mem;
-        uint8_t io[IO_SIZE];
-        uint8_t hram[HRAM_SIZE];
+        uint8_t *read_pages[PAGE_COUNT];
+        uint8_t *write_pages[PAGE_COUNT];
+
+        alignas(CACHE_LINE_SIZE) uint8_t wram[WRAM_SIZE];
+        alignas(CACHE_LINE_SIZE) uint8_t hram[HRAM_SIZE];
         uint8_t ie;
+        alignas(CACHE_LINE_SIZE) uint8_t io[IO_SIZE];
+        alignas(CACHE_LINE_SIZE) uint8_t oam[OAM_SIZE];
+        alignas(CACHE_LINE_SIZE) uint8_t vram[VRAM_SIZE];
+        uint8_t unusable_mem[NOT_USABLE_SIZE];
+
+        /* Cold: only reached through ram_bank of the MBC and while the boot ROM is mapped */
+        alignas(CACHE_LINE_SIZE) uint8_t cart_ram[CART_RAM_MAX_SIZE]; /* See mbc_base.ram */
+        uint32_t boot_rom_size;
+        uint8_t boot_rom[BOOT_ROM_MAX_SIZE];
     } memory;
 
+    /* Components */
+    alignas(CACHE_LINE_SIZE) struct ppu ppu;
+    alignas(CACHE_LINE_SIZE) struct tile_cache tile_cache; /* Derived from VRAM, never saved */
+    alignas(CACHE_LINE_SIZE) struct obj_lines obj_lines;   /* Derived from OAM, never saved */
+    alignas(CACHE_LINE_SIZE) struct apu apu;
+
     /* Internal registers */
-    uint16_t internal_div;
+    alignas(CACHE_LINE_SIZE) uint64_t div_origin; /* Master clock timestamp DIV was 0 at, see timers.h */
+    uint64_t timer_sync_time;
     uint8_t prev_tac_AND;
-    uint8_t prev_serial_AND;
 
     uint8_t schedule_tima_overflow;
 
-    uint8_t halt;
-    uint8_t halt_bug;
-    uint8_t stop;
-
-    uint16_t serial_clock;
+    uint64_t serial_origin; /* Master clock timestamp the serial clock was 0 at, see serial.h */
+    uint64_t serial_sync_time;
+    uint8_t prev_serial_AND;
     uint8_t serial_acc;
 
-    struct mbc_base *mbc;
-
     uint8_t joyp_a;
     uint8_t joyp_d;
 
-    uint64_t tcycles_since_sync;
+    /* Cold */
+    struct mbc_base *mbc;
+    struct dynarec *dynarec;
+    struct idle_loop idle_loop;
+
     int64_t last_sync_timestamp;
 
     /* Callbacks */
@@ -59,6 +100,11 @@ struct gb_core
     } callbacks;
 };
 
+static inline uint8_t is_boot_rom_mapped(struct gb_core *gb, uint16_t address)
+{
+    return !(gb->memory.io[IO_OFFSET(BOOT)] & 0x01) && address < gb->memory.boot_rom_size;
+}
+
 static inline uint8_t is_apu_on(struct gb_core *gb)
 {
     return gb->memory.io[IO_OFFSET(NR52)] >> 7;
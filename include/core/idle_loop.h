@@ -0,0 +1,85 @@
+#ifndef CORE_IDLE_LOOP_H
+#define CORE_IDLE_LOOP_H
+
+#include <stdint.h>
+
+#include "cpu.h"
+
+/*
+ * Idle loop detection for polling loops such as "ldh a,(LY); cp N; jr nz" running from ROM.
+ *
+ * After a short backward branch one iteration is recorded instruction by instruction. The loop is armed when that
+ * iteration only reads a single pollable location (PPU/timer registers, IF, WRAM or HRAM), never writes memory and
+ * ends with the same registers it started with. An armed loop is then replayed by ticking the components only. From
+ * the loop head, time jumps over the whole iterations whose read is known to return the current value, bounded by the
+ * next scheduler event and by the next MCycle the polled location may change on (see ppu_stable_dots() and
+ * timer_stable_tcycles()). The iteration after is stepped one MCycle at a time, the location being sampled at the exact
+ * MCycle the real read happens. Replay stops as soon as the value changes, an interrupt is about to be serviced or the
+ * budget is spent, leaving the CPU at the matching instruction boundary.
+ */
+
+#define IDLE_LOOP_MAX_INSTRS 16
+#define IDLE_LOOP_MAX_LENGTH 32 /* Max bytes between the loop head and the backward branch */
+#define IDLE_LOOP_MAX_MCYCLES 114
+
+/* Loops failing to arm this many times in a row are never recorded again */
+#define IDLE_LOOP_REJECT_SIZE 0x100
+#define IDLE_LOOP_REJECT_MASK (IDLE_LOOP_REJECT_SIZE - 1)
+#define IDLE_LOOP_MAX_STRIKES 4
+
+enum idle_loop_state
+{
+    IDLE_LOOP_NONE = 0,
+    IDLE_LOOP_RECORDING,
+    IDLE_LOOP_ARMED,
+};
+
+struct idle_loop
+{
+    uint8_t state;
+
+    uint16_t head;
+    uint16_t end; /* Address right after the backward branch */
+    uint32_t head_tag;
+
+    /* Recorded iteration, registers and MCycles of every instruction in execution order */
+    uint8_t count;
+    uint16_t pcs[IDLE_LOOP_MAX_INSTRS];
+    uint8_t mcycles[IDLE_LOOP_MAX_INSTRS];
+    struct cpu boundaries[IDLE_LOOP_MAX_INSTRS];
+
+    /* The single polled read of the iteration */
+    uint8_t read_index;
+    uint8_t read_tick; /* MCycles of the instruction elapsed before the read */
+    uint8_t read_dest; /* Offset of the destination register in struct cpu */
+    uint16_t read_address;
+    uint8_t read_value;
+    uint8_t read_offset; /* MCycles from the loop head to the read */
+    uint8_t iteration_mcycles;
+
+    struct
+    {
+        uint32_t tag;
+        uint8_t strikes;
+    } rejects[IDLE_LOOP_REJECT_SIZE];
+
+    /* Statistics */
+    uint64_t detected;
+    uint64_t fast_forwards;
+    uint64_t skipped_mcycles;
+};
+
+struct gb_core;
+
+/* Must be called whenever the ROM image changes or the CPU state is replaced */
+void idle_loop_flush(struct gb_core *gb);
+
+/* Called before an instruction while a loop is tracked, returns the MCycles fast-forwarded or 0 */
+int idle_loop_before_op(struct gb_core *gb);
+
+/* Called after the instruction at pc took mcycles */
+void idle_loop_after_op(struct gb_core *gb, uint16_t pc, int mcycles);
+
+void idle_loop_log_stats(struct gb_core *gb);
+
+#endif
@@ -11,6 +11,16 @@
 #define INTERRUPT_JOYPAD    4
 // clang-format on
 
+/*
+ * The interrupts both requested and enabled are cached in gb->pending_interrupts so the CPU only tests one byte between
+ * two instructions. IF and IE must only be modified through the helpers below, or be followed by a call to
+ * update_pending_interrupts().
+ */
+static inline void update_pending_interrupts(struct gb_core *gb)
+{
+    gb->pending_interrupts = gb->memory.io[IO_OFFSET(IF)] & gb->memory.ie & 0x1F;
+}
+
 static inline int get_if(struct gb_core *gb, int bit)
 {
     return (gb->memory.io[IO_OFFSET(IF)] >> bit) & 0x01;
@@ -19,11 +29,13 @@ static inline int get_if(struct gb_core *gb, int bit)
 static inline void set_if(struct gb_core *gb, int bit)
 {
     gb->memory.io[IO_OFFSET(IF)] |= (0x01 << bit);
+    update_pending_interrupts(gb);
 }
 
 static inline void clear_if(struct gb_core *gb, int bit)
 {
     gb->memory.io[IO_OFFSET(IF)] &= ~(0x01 << bit);
+    update_pending_interrupts(gb);
 }
 
 static inline int get_ie(struct gb_core *gb, int bit)
@@ -34,15 +46,23 @@ static inline int get_ie(struct gb_core *gb, int bit)
 static inline void set_ie(struct gb_core *gb, int bit)
 {
     gb->memory.ie |= (0x01 << bit);
+    update_pending_interrupts(gb);
 }
 
 static inline void clear_ie(struct gb_core *gb, int bit)
 {
     gb->memory.ie &= ~(0x01 << bit);
+    update_pending_interrupts(gb);
 }
 
 int check_interrupt(struct gb_core *gb);
 
+/* Interrupt checks done between two instructions, returns 1 when an interrupt must be serviced now */
+int poll_interrupt(struct gb_core *gb);
+
+/* Clear the IF bit of the highest priority pending interrupt and return its handler, 0 if it was cancelled */
+uint16_t acknowledge_interrupt(struct gb_core *gb);
+
 void check_joyp_int(struct gb_core *gb, uint8_t prev_joyp);
 
 #endif
@@ -6,12 +6,14 @@
 
 struct cpu;
 
+#define CART_RAM_MAX_SIZE 0x20000 /* 16 banks of 8 KiB */
+
 #define MBC_SET_VTABLE(MBC_PTR)                                                                                        \
     do                                                                                                                 \
     {                                                                                                                  \
         (MBC_PTR)->_mbc_reset = _mbc_reset;                                                                            \
         (MBC_PTR)->_mbc_free = _mbc_free;                                                                              \
-        (MBC_PTR)->_read_mbc_rom = _read_mbc_rom;                                                                      \
+        (MBC_PTR)->_mbc_update_banks = _mbc_update_banks;                                                              \
         (MBC_PTR)->_write_mbc_rom = _write_mbc_rom;                                                                    \
         (MBC_PTR)->_read_mbc_ram = _read_mbc_ram;                                                                      \
         (MBC_PTR)->_write_mbc_ram = _write_mbc_ram;                                                                    \
@@ -37,7 +39,7 @@ struct mbc_base
     FILE *save_file;
 
     uint8_t *rom;
-    uint8_t *ram;
+    uint8_t *ram; /* CART_RAM_MAX_SIZE bytes owned by the core, see set_mbc() */
 
     uint8_t rom_size_header;
     uint8_t ram_size_header;
@@ -48,11 +50,15 @@ struct mbc_base
     unsigned int rom_total_size;
     unsigned int ram_total_size;
 
+    /* Banks currently mapped, recomputed by _mbc_update_banks() every time a register changes */
+    uint8_t *rom_banks[2]; /* 0x0000-0x3FFF and 0x4000-0x7FFF */
+    uint8_t *ram_bank;     /* 0xA000-0xBFFF, NULL when reads don't come from plain RAM (disabled, RTC, MBC2) */
+
     /* Functions pointers */
     void (*_mbc_reset)(struct mbc_base *mbc_base);
     void (*_mbc_free)(struct mbc_base *mbc_base);
+    void (*_mbc_update_banks)(struct mbc_base *mbc_base);
 
-    uint8_t (*_read_mbc_rom)(struct mbc_base *mbc, uint16_t address);
     void (*_write_mbc_rom)(struct mbc_base *mbc, uint16_t address, uint8_t val);
 
     uint8_t (*_read_mbc_ram)(struct mbc_base *mbc, uint16_t address);
@@ -62,15 +68,35 @@ struct mbc_base
     void (*_mbc_load_from_stream)(struct mbc_base *mbc, FILE *stream);
 };
 
-int set_mbc(struct mbc_base **output, uint8_t *rom, char *rom_path);
+/*
+ * Replaces *output with the MBC of rom. ram is the CART_RAM_MAX_SIZE bytes cartridge RAM buffer of the core, cleared
+ * then filled from the save file, the previous MBC must not be used anymore even if this fails.
+ */
+int set_mbc(struct mbc_base **output, uint8_t *rom, uint8_t *ram, char *rom_path);
 
 void mbc_reset(struct mbc_base *mbc);
 void mbc_free(struct mbc_base *mbc);
 
-uint8_t read_mbc_rom(struct mbc_base *mbc, uint16_t address);
+/* Offset in the ROM image of the byte currently mapped at address (0x0000-0x7FFF) */
+static inline unsigned int mbc_rom_offset(struct mbc_base *mbc, uint16_t address)
+{
+    return (mbc->rom_banks[address >> 14] - mbc->rom) | (address & 0x3FFF);
+}
+
+static inline uint8_t read_mbc_rom(struct mbc_base *mbc, uint16_t address)
+{
+    return mbc->rom_banks[address >> 14][address & 0x3FFF];
+}
+
 void write_mbc_rom(struct mbc_base *mbc, uint16_t address, uint8_t val);
 
-uint8_t read_mbc_ram(struct mbc_base *mbc, uint16_t address);
+static inline uint8_t read_mbc_ram(struct mbc_base *mbc, uint16_t address)
+{
+    if (mbc->ram_bank)
+        return mbc->ram_bank[address & 0x1FFF];
+    return mbc->_read_mbc_ram(mbc, address);
+}
+
 void write_mbc_ram(struct mbc_base *mbc, uint16_t address, uint8_t val);
 
 void mbc_serialize(struct mbc_base *mbc, FILE *stream);
@@ -0,0 +1,40 @@
+#ifndef CORE_MEMORY_FETCH_H
+#define CORE_MEMORY_FETCH_H
+
+#include <stdint.h>
+
+#include "decode_cache.h"
+#include "emulation.h"
+#include "gb_core.h"
+#include "read.h"
+
+static inline const struct decoded_instr *decode_cache_lookup(struct gb_core *gb, uint16_t address)
+{
+    if (address >= 0x8000 || gb->halt_bug || is_boot_rom_mapped(gb, address) || is_dma_bus_conflict(gb, address))
+        return NULL;
+
+    struct decode_cache *cache = &gb->decode_cache;
+    uint32_t tag = (cache->rom_base[address >> 14] | (address & 0x3FFF)) + 1;
+    struct decoded_instr *entry = &cache->entries[address & DECODE_CACHE_MASK];
+    if (entry->tag == tag)
+        return entry;
+    return decode_cache_fill(gb, entry, address, tag);
+}
+
+/*
+ * Same as read_mem_tick for instruction bytes, served from the decoded instruction when possible. An OAM DMA started
+ * by the instruction before may already conflict with its operands.
+ */
+static inline uint8_t fetch_mem_tick(struct gb_core *gb, uint16_t address)
+{
+    const struct decoded_instr *instr = gb->decode_cache.current;
+    uint16_t offset = address - gb->decode_cache.current_pc;
+    if (instr && offset < instr->length && !is_dma_bus_conflict(gb, address))
+    {
+        tick_m(gb);
+        return instr->bytes[offset];
+    }
+    return read_mem_tick(gb, address);
+}
+
+#endif
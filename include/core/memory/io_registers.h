@@ -0,0 +1,49 @@
+#ifndef CORE_MEMORY_IO_REGISTERS_H
+#define CORE_MEMORY_IO_REGISTERS_H
+
+#include <stdint.h>
+
+#include "common.h"
+
+/*
+ * One descriptor per address of the IO area. An access first runs the component owning the register up to the master
+ * clock, then goes through the handler if the register has side effects, otherwise the masks are applied to the
+ * backing byte in gb->memory.io directly. Unmapped addresses have empty masks: they read as $FF and ignore writes.
+ *
+ * The masks are only correct for DMG !
+ */
+
+struct gb_core;
+
+struct io_register
+{
+    uint8_t read_mask;  /* Implemented bits, the others always read as 1 */
+    uint8_t write_mask; /* Bits writable by the CPU */
+
+    /* All optional */
+    void (*catch_up)(struct gb_core *gb);
+    uint8_t (*read)(struct gb_core *gb, uint16_t address);
+    void (*write)(struct gb_core *gb, uint16_t address, uint8_t val);
+
+    const char *name; /* NULL for unmapped addresses */
+};
+
+extern const struct io_register io_registers[IO_SIZE];
+
+/* Raw register accesses without side effects */
+static inline uint8_t io_read(uint8_t *io, uint16_t address)
+{
+    return io[IO_OFFSET(address)] | ~io_registers[IO_OFFSET(address)].read_mask;
+}
+
+static inline void io_write(uint8_t *io, uint16_t address, uint8_t val)
+{
+    uint8_t mask = io_registers[IO_OFFSET(address)].write_mask;
+    io[IO_OFFSET(address)] = (val & mask) | (io[IO_OFFSET(address)] & ~mask);
+}
+
+/* CPU accesses */
+uint8_t io_register_read(struct gb_core *gb, uint16_t address);
+void io_register_write(struct gb_core *gb, uint16_t address, uint8_t val);
+
+#endif
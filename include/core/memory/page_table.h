@@ -0,0 +1,29 @@
+#ifndef CORE_MEMORY_PAGE_TABLE_H
+#define CORE_MEMORY_PAGE_TABLE_H
+
+/*
+ * The address space is split in 256 pages of 256 bytes, each with a host pointer for reads and one for writes.
+ * read_mem() and write_mem() access a page directly through its pointer and only go through the handlers of read.c
+ * and write.c when it is NULL: accesses with side effects or depending on a component state (ROM and cartridge RAM
+ * writes, cartridge RAM reads other than from a plain RAM bank, OAM, IO, HRAM which shares its page with IO, VRAM
+ * while the PPU may lock it, VRAM tile data writes which invalidate the tile cache).
+ *
+ * Pointers must be updated whenever the mapping changes: MBC bank switch, boot ROM unmapping, LCD on/off and OAM DMA
+ * start and end. While an OAM DMA runs, the pages on the bus it copies from have no read pointer and its source page
+ * no write pointer.
+ */
+
+#define PAGE_COUNT 0x100
+#define PAGE_SHIFT 8
+#define PAGE_MASK 0xFF
+
+struct gb_core;
+
+/* Send every access to the handlers */
+void page_table_clear(struct gb_core *gb);
+
+void page_table_update(struct gb_core *gb);
+void page_table_update_banks(struct gb_core *gb);
+void page_table_update_vram(struct gb_core *gb);
+
+#endif
@@ -1,11 +1,36 @@
 #ifndef CORE_MEMORY_READ_H
 #define CORE_MEMORY_READ_H
 
+#include <stdbool.h>
 #include <stdint.h>
 
-struct gb_core;
+#include "gb_core.h"
+#include "page_table.h"
 
-uint8_t read_mem(struct gb_core *gb, uint16_t address);
+/*
+ * The OAM DMA drives the bus it copies from: the external one (ROM, cartridge RAM and WRAM) or the video one. CPU
+ * reads anywhere on it return the byte the DMA reads during the same MCycle, OAM, IO and HRAM being on neither.
+ */
+static inline bool is_dma_bus_conflict(struct gb_core *gb, uint16_t address)
+{
+    bool vram = address >= VRAM && address < EXRAM;
+    bool source_vram = gb->ppu.dma_source >= (VRAM >> 8) && gb->ppu.dma_source < (EXRAM >> 8);
+    return gb->ppu.dma && address < OAM && vram == source_vram;
+}
+
+/* Reads of pages without a host pointer, see page_table.h */
+uint8_t read_mem_slow(struct gb_core *gb, uint16_t address);
+
+/* Reads of the OAM DMA from its source, which never conflict */
+uint8_t read_mem_dma(struct gb_core *gb, uint16_t address);
+
+static inline uint8_t read_mem(struct gb_core *gb, uint16_t address)
+{
+    const uint8_t *page = gb->memory.read_pages[address >> PAGE_SHIFT];
+    if (page)
+        return page[address & PAGE_MASK];
+    return read_mem_slow(gb, address);
+}
 
 uint8_t read_mem_tick(struct gb_core *gb, uint16_t address);
 
@@ -0,0 +1,29 @@
+#ifndef CORE_MICROCODE_H
+#define CORE_MICROCODE_H
+
+#include "gb_core.h"
+
+/*
+ * Microcoded CPU: every instruction is a short program of micro-ops, each one doing exactly one MCycle of work (a bus
+ * access or an internal cycle). The program and step being run live in struct cpu, so the CPU can be suspended between
+ * any two MCycles and resumed later, a caller only has to ask for the number of MCycles it wants to run.
+ *
+ * Instructions of one or two MCycles reuse the opcode handlers as is, longer ones, CB (HL) opcodes and the interrupt
+ * dispatch have their own program. Running whole instructions through next_op() and check_interrupt() stays cycle
+ * identical as long as the CPU is at an instruction boundary when switching between both.
+ */
+
+#define MC_MAX_STEPS 5
+
+/* MCycles run by the frontend between two synchronizations, one scanline */
+#define MICROCODE_RUN_MCYCLES 114
+
+/* Run exactly mcycles MCycles, returns mcycles or -1 on an undefined opcode */
+int microcode_run(struct gb_core *gb, int mcycles);
+
+static inline int microcode_at_boundary(struct gb_core *gb)
+{
+    return gb->cpu.mc_program == MC_NONE;
+}
+
+#endif
@@ -0,0 +1,40 @@
+#ifndef CORE_OBJ_LINES_H
+#define CORE_OBJ_LINES_H
+
+#include <stdint.h>
+
+#include "common.h"
+
+#define OBJ_ENTRIES (OAM_SIZE / 4)
+
+/*
+ * The OAM entries the OAM scan selects on every line, before the 10 objects limit. An entry is moved to its new lines
+ * on the first use after a write to its Y or X byte: every write to OAM must invalidate it. The lines are built for one
+ * object height, all of them are built again when LCDC.2 changes.
+ */
+struct obj_lines
+{
+    uint64_t lines[SCREEN_HEIGHT]; /* Bit i is set when entry i is on the line */
+    uint8_t y[OBJ_ENTRIES];        /* Y of the entries in lines, 0 when on none */
+    uint64_t dirty;
+    uint8_t height; /* 8 or 16, 0 when nothing is built */
+};
+
+/* Move the invalidated entries, or build every line again for another height */
+void obj_lines_update(struct obj_lines *cache, const uint8_t *oam, uint8_t height);
+
+static inline void obj_lines_invalidate_all(struct obj_lines *cache)
+{
+    cache->height = 0;
+}
+
+/* offset is relative to the start of OAM, writes to the tile and attributes bytes are ignored */
+static inline void obj_lines_invalidate(struct obj_lines *cache, uint8_t offset)
+{
+    if (offset < OAM_SIZE && offset % 4 < 2)
+        cache->dirty |= (uint64_t)1 << (offset / 4);
+}
+
+void obj_lines_invalidate_range(struct obj_lines *cache, uint8_t offset, uint32_t length);
+
+#endif
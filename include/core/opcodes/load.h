@@ -5,11 +5,11 @@
 
 struct gb_core;
 
-int ld_rr_a(struct gb_core *gb, uint8_t *hi, uint8_t *lo);
+int ld_rr_a(struct gb_core *gb, uint16_t *rr);
 int ld_r_r(struct gb_core *gb, uint8_t *dest, uint8_t *src);
 int ld_r_u8(struct gb_core *gb, uint8_t *dest);
 int ld_hl_u8(struct gb_core *gb);
-int ld_a_rr(struct gb_core *gb, uint8_t *hi, uint8_t *lo);
+int ld_a_rr(struct gb_core *gb, uint16_t *rr);
 int ld_hl_r(struct gb_core *gb, uint8_t *src);
 int ld_r_hl(struct gb_core *gb, uint8_t *dest);
 int ld_nn_a(struct gb_core *gb);
@@ -27,16 +27,17 @@ int ldd_hl_a(struct gb_core *gb);
 int ldi_a_hl(struct gb_core *gb);
 int ldd_a_hl(struct gb_core *gb);
 
-int ld_rr_nn(struct gb_core *gb, uint8_t *hi, uint8_t *lo);
+int ld_rr_nn(struct gb_core *gb, uint16_t *rr);
 int ld_sp_nn(struct gb_core *gb);
 int ld_sp_hl(struct gb_core *gb);
 int ld_nn_sp(struct gb_core *gb);
 
 int ld_hl_spe8(struct gb_core *gb);
 
-int pop_rr(struct gb_core *gb, uint8_t *hi, uint8_t *lo);
+int pop_rr(struct gb_core *gb, uint16_t *rr);
 int pop_af(struct gb_core *gb);
 
-int push_rr(struct gb_core *gb, uint8_t *hi, uint8_t *lo);
+int push_rr(struct gb_core *gb, uint16_t *rr);
+int push_af(struct gb_core *gb);
 
 #endif
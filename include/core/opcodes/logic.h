@@ -9,13 +9,13 @@ struct gb_core;
 int inc_r(struct gb_core *gb, uint8_t *dest);
 int inc_hl(struct gb_core *gb);
 
-int inc_rr(struct gb_core *gb, uint8_t *hi, uint8_t *lo);
+int inc_rr(struct gb_core *gb, uint16_t *rr);
 int inc_sp(struct gb_core *gb);
 
 int dec_r(struct gb_core *gb, uint8_t *dest);
 int dec_hl(struct gb_core *gb);
 
-int dec_rr(struct gb_core *gb, uint8_t *hi, uint8_t *lo);
+int dec_rr(struct gb_core *gb, uint16_t *rr);
 int dec_sp(struct gb_core *gb);
 
 int add_a_r(struct gb_core *gb, uint8_t *src);
@@ -26,7 +26,7 @@ int adc_a_r(struct gb_core *gb, uint8_t *src);
 int adc_a_hl(struct gb_core *gb);
 int adc_a_n(struct gb_core *gb);
 
-int add_hl_rr(struct gb_core *gb, uint8_t *hi, uint8_t *lo);
+int add_hl_rr(struct gb_core *gb, uint16_t *rr);
 int add_hl_sp(struct gb_core *gb);
 
 int add_sp_e8(struct gb_core *gb);
@@ -0,0 +1,280 @@
+#ifndef CORE_OPCODE_TABLE_H
+#define CORE_OPCODE_TABLE_H
+
+#include "control.h"
+#include "jump.h"
+#include "load.h"
+#include "logic.h"
+#include "rotshift.h"
+#include "utils.h"
+
+/*
+ * SM83 instruction description table, single source of truth for the opcode dispatcher.
+ *
+ * Each entry is X(OPCODE, MNEMONIC, LENGTH, HANDLER): LENGTH is the instruction size in bytes (opcode included) and
+ * HANDLER is the expression executing the instruction and returning its duration in MCycles. HANDLER expressions can
+ * refer to the `gb` core pointer in scope at the expansion site.
+ * The 0xCB entry expands to prefix_op(gb) and illegal opcodes to undefined_op(gb), both are provided by the dispatcher.
+ */
+// clang-format off
+#define SM83_OPCODE_TABLE(X)                                                                                           \
+    X(0x00, "NOP", 1, nop())                                                                                           \
+    X(0x01, "LD BC,u16", 3, ld_rr_nn(gb, &gb->cpu.bc))                                                                 \
+    X(0x02, "LD (BC),A", 1, ld_rr_a(gb, &gb->cpu.bc))                                                                  \
+    X(0x03, "INC BC", 1, inc_rr(gb, &gb->cpu.bc))                                                                      \
+    X(0x04, "INC B", 1, inc_r(gb, &gb->cpu.b))                                                                         \
+    X(0x05, "DEC B", 1, dec_r(gb, &gb->cpu.b))                                                                         \
+    X(0x06, "LD B,u8", 2, ld_r_u8(gb, &gb->cpu.b))                                                                     \
+    X(0x07, "RLCA", 1, rlca(gb))                                                                                       \
+    X(0x08, "LD (u16),SP", 3, ld_nn_sp(gb))                                                                            \
+    X(0x09, "ADD HL,BC", 1, add_hl_rr(gb, &gb->cpu.bc))                                                                \
+    X(0x0A, "LD A,(BC)", 1, ld_a_rr(gb, &gb->cpu.bc))                                                                  \
+    X(0x0B, "DEC BC", 1, dec_rr(gb, &gb->cpu.bc))                                                                      \
+    X(0x0C, "INC C", 1, inc_r(gb, &gb->cpu.c))                                                                         \
+    X(0x0D, "DEC C", 1, dec_r(gb, &gb->cpu.c))                                                                         \
+    X(0x0E, "LD C,u8", 2, ld_r_u8(gb, &gb->cpu.c))                                                                     \
+    X(0x0F, "RRCA", 1, rrca(gb))                                                                                       \
+    X(0x10, "STOP", 1, stop(gb))                                                                                       \
+    X(0x11, "LD DE,u16", 3, ld_rr_nn(gb, &gb->cpu.de))                                                                 \
+    X(0x12, "LD (DE),A", 1, ld_rr_a(gb, &gb->cpu.de))                                                                  \
+    X(0x13, "INC DE", 1, inc_rr(gb, &gb->cpu.de))                                                                      \
+    X(0x14, "INC D", 1, inc_r(gb, &gb->cpu.d))                                                                         \
+    X(0x15, "DEC D", 1, dec_r(gb, &gb->cpu.d))                                                                         \
+    X(0x16, "LD D,u8", 2, ld_r_u8(gb, &gb->cpu.d))                                                                     \
+    X(0x17, "RLA", 1, rla(gb))                                                                                         \
+    X(0x18, "JR i8", 2, jr_e8(gb))                                                                                     \
+    X(0x19, "ADD HL,DE", 1, add_hl_rr(gb, &gb->cpu.de))                                                                \
+    X(0x1A, "LD A,(DE)", 1, ld_a_rr(gb, &gb->cpu.de))                                                                  \
+    X(0x1B, "DEC DE", 1, dec_rr(gb, &gb->cpu.de))                                                                      \
+    X(0x1C, "INC E", 1, inc_r(gb, &gb->cpu.e))                                                                         \
+    X(0x1D, "DEC E", 1, dec_r(gb, &gb->cpu.e))                                                                         \
+    X(0x1E, "LD E,u8", 2, ld_r_u8(gb, &gb->cpu.e))                                                                     \
+    X(0x1F, "RRA", 1, rra(gb))                                                                                         \
+    X(0x20, "JR NZ,i8", 2, jr_cc_e8(gb, get_z(&gb->cpu) == 0))                                                         \
+    X(0x21, "LD HL,u16", 3, ld_rr_nn(gb, &gb->cpu.hl))                                                                 \
+    X(0x22, "LD (HL+),A", 1, ldi_hl_a(gb))                                                                             \
+    X(0x23, "INC HL", 1, inc_rr(gb, &gb->cpu.hl))                                                                      \
+    X(0x24, "INC H", 1, inc_r(gb, &gb->cpu.h))                                                                         \
+    X(0x25, "DEC H", 1, dec_r(gb, &gb->cpu.h))                                                                         \
+    X(0x26, "LD H,u8", 2, ld_r_u8(gb, &gb->cpu.h))                                                                     \
+    X(0x27, "DAA", 1, daa(gb))                                                                                         \
+    X(0x28, "JR Z,i8", 2, jr_cc_e8(gb, get_z(&gb->cpu) == 1))                                                          \
+    X(0x29, "ADD HL,HL", 1, add_hl_rr(gb, &gb->cpu.hl))                                                                \
+    X(0x2A, "LD A,(HL+)", 1, ldi_a_hl(gb))                                                                             \
+    X(0x2B, "DEC HL", 1, dec_rr(gb, &gb->cpu.hl))                                                                      \
+    X(0x2C, "INC L", 1, inc_r(gb, &gb->cpu.l))                                                                         \
+    X(0x2D, "DEC L", 1, dec_r(gb, &gb->cpu.l))                                                                         \
+    X(0x2E, "LD L,u8", 2, ld_r_u8(gb, &gb->cpu.l))                                                                     \
+    X(0x2F, "CPL", 1, cpl(gb))                                                                                         \
+    X(0x30, "JR NC,i8", 2, jr_cc_e8(gb, get_c(&gb->cpu) == 0))                                                         \
+    X(0x31, "LD SP,u16", 3, ld_sp_nn(gb))                                                                              \
+    X(0x32, "LD (HL-),A", 1, ldd_hl_a(gb))                                                                             \
+    X(0x33, "INC SP", 1, inc_sp(gb))                                                                                   \
+    X(0x34, "INC (HL)", 1, inc_hl(gb))                                                                                 \
+    X(0x35, "DEC (HL)", 1, dec_hl(gb))                                                                                 \
+    X(0x36, "LD (HL),u8", 2, ld_hl_u8(gb))                                                                             \
+    X(0x37, "SCF", 1, scf(gb))                                                                                         \
+    X(0x38, "JR C,i8", 2, jr_cc_e8(gb, get_c(&gb->cpu) == 1))                                                          \
+    X(0x39, "ADD HL,SP", 1, add_hl_sp(gb))                                                                             \
+    X(0x3A, "LD A,(HL-)", 1, ldd_a_hl(gb))                                                                             \
+    X(0x3B, "DEC SP", 1, dec_sp(gb))                                                                                   \
+    X(0x3C, "INC A", 1, inc_r(gb, &gb->cpu.a))                                                                         \
+    X(0x3D, "DEC A", 1, dec_r(gb, &gb->cpu.a))                                                                         \
+    X(0x3E, "LD A,u8", 2, ld_r_u8(gb, &gb->cpu.a))                                                                     \
+    X(0x3F, "CCF", 1, ccf(gb))                                                                                         \
+    X(0x40, "LD B,B", 1, ld_r_r(gb, &gb->cpu.b, &gb->cpu.b))                                                           \
+    X(0x41, "LD B,C", 1, ld_r_r(gb, &gb->cpu.b, &gb->cpu.c))                                                           \
+    X(0x42, "LD B,D", 1, ld_r_r(gb, &gb->cpu.b, &gb->cpu.d))                                                           \
+    X(0x43, "LD B,E", 1, ld_r_r(gb, &gb->cpu.b, &gb->cpu.e))                                                           \
+    X(0x44, "LD B,H", 1, ld_r_r(gb, &gb->cpu.b, &gb->cpu.h))                                                           \
+    X(0x45, "LD B,L", 1, ld_r_r(gb, &gb->cpu.b, &gb->cpu.l))                                                           \
+    X(0x46, "LD B,(HL)", 1, ld_r_hl(gb, &gb->cpu.b))                                                                   \
+    X(0x47, "LD B,A", 1, ld_r_r(gb, &gb->cpu.b, &gb->cpu.a))                                                           \
+    X(0x48, "LD C,B", 1, ld_r_r(gb, &gb->cpu.c, &gb->cpu.b))                                                           \
+    X(0x49, "LD C,C", 1, ld_r_r(gb, &gb->cpu.c, &gb->cpu.c))                                                           \
+    X(0x4A, "LD C,D", 1, ld_r_r(gb, &gb->cpu.c, &gb->cpu.d))                                                           \
+    X(0x4B, "LD C,E", 1, ld_r_r(gb, &gb->cpu.c, &gb->cpu.e))                                                           \
+    X(0x4C, "LD C,H", 1, ld_r_r(gb, &gb->cpu.c, &gb->cpu.h))                                                           \
+    X(0x4D, "LD C,L", 1, ld_r_r(gb, &gb->cpu.c, &gb->cpu.l))                                                           \
+    X(0x4E, "LD C,(HL)", 1, ld_r_hl(gb, &gb->cpu.c))                                                                   \
+    X(0x4F, "LD C,A", 1, ld_r_r(gb, &gb->cpu.c, &gb->cpu.a))                                                           \
+    X(0x50, "LD D,B", 1, ld_r_r(gb, &gb->cpu.d, &gb->cpu.b))                                                           \
+    X(0x51, "LD D,C", 1, ld_r_r(gb, &gb->cpu.d, &gb->cpu.c))                                                           \
+    X(0x52, "LD D,D", 1, ld_r_r(gb, &gb->cpu.d, &gb->cpu.d))                                                           \
+    X(0x53, "LD D,E", 1, ld_r_r(gb, &gb->cpu.d, &gb->cpu.e))                                                           \
+    X(0x54, "LD D,H", 1, ld_r_r(gb, &gb->cpu.d, &gb->cpu.h))                                                           \
+    X(0x55, "LD D,L", 1, ld_r_r(gb, &gb->cpu.d, &gb->cpu.l))                                                           \
+    X(0x56, "LD D,(HL)", 1, ld_r_hl(gb, &gb->cpu.d))                                                                   \
+    X(0x57, "LD D,A", 1, ld_r_r(gb, &gb->cpu.d, &gb->cpu.a))                                                           \
+    X(0x58, "LD E,B", 1, ld_r_r(gb, &gb->cpu.e, &gb->cpu.b))                                                           \
+    X(0x59, "LD E,C", 1, ld_r_r(gb, &gb->cpu.e, &gb->cpu.c))                                                           \
+    X(0x5A, "LD E,D", 1, ld_r_r(gb, &gb->cpu.e, &gb->cpu.d))                                                           \
+    X(0x5B, "LD E,E", 1, ld_r_r(gb, &gb->cpu.e, &gb->cpu.e))                                                           \
+    X(0x5C, "LD E,H", 1, ld_r_r(gb, &gb->cpu.e, &gb->cpu.h))                                                           \
+    X(0x5D, "LD E,L", 1, ld_r_r(gb, &gb->cpu.e, &gb->cpu.l))                                                           \
+    X(0x5E, "LD E,(HL)", 1, ld_r_hl(gb, &gb->cpu.e))                                                                   \
+    X(0x5F, "LD E,A", 1, ld_r_r(gb, &gb->cpu.e, &gb->cpu.a))                                                           \
+    X(0x60, "LD H,B", 1, ld_r_r(gb, &gb->cpu.h, &gb->cpu.b))                                                           \
+    X(0x61, "LD H,C", 1, ld_r_r(gb, &gb->cpu.h, &gb->cpu.c))                                                           \
+    X(0x62, "LD H,D", 1, ld_r_r(gb, &gb->cpu.h, &gb->cpu.d))                                                           \
+    X(0x63, "LD H,E", 1, ld_r_r(gb, &gb->cpu.h, &gb->cpu.e))                                                           \
+    X(0x64, "LD H,H", 1, ld_r_r(gb, &gb->cpu.h, &gb->cpu.h))                                                           \
+    X(0x65, "LD H,L", 1, ld_r_r(gb, &gb->cpu.h, &gb->cpu.l))                                                           \
+    X(0x66, "LD H,(HL)", 1, ld_r_hl(gb, &gb->cpu.h))                                                                   \
+    X(0x67, "LD H,A", 1, ld_r_r(gb, &gb->cpu.h, &gb->cpu.a))                                                           \
+    X(0x68, "LD L,B", 1, ld_r_r(gb, &gb->cpu.l, &gb->cpu.b))                                                           \
+    X(0x69, "LD L,C", 1, ld_r_r(gb, &gb->cpu.l, &gb->cpu.c))                                                           \
+    X(0x6A, "LD L,D", 1, ld_r_r(gb, &gb->cpu.l, &gb->cpu.d))                                                           \
+    X(0x6B, "LD L,E", 1, ld_r_r(gb, &gb->cpu.l, &gb->cpu.e))                                                           \
+    X(0x6C, "LD L,H", 1, ld_r_r(gb, &gb->cpu.l, &gb->cpu.h))                                                           \
+    X(0x6D, "LD L,L", 1, ld_r_r(gb, &gb->cpu.l, &gb->cpu.l))                                                           \
+    X(0x6E, "LD L,(HL)", 1, ld_r_hl(gb, &gb->cpu.l))                                                                   \
+    X(0x6F, "LD L,A", 1, ld_r_r(gb, &gb->cpu.l, &gb->cpu.a))                                                           \
+    X(0x70, "LD (HL),B", 1, ld_hl_r(gb, &gb->cpu.b))                                                                   \
+    X(0x71, "LD (HL),C", 1, ld_hl_r(gb, &gb->cpu.c))                                                                   \
+    X(0x72, "LD (HL),D", 1, ld_hl_r(gb, &gb->cpu.d))                                                                   \
+    X(0x73, "LD (HL),E", 1, ld_hl_r(gb, &gb->cpu.e))                                                                   \
+    X(0x74, "LD (HL),H", 1, ld_hl_r(gb, &gb->cpu.h))                                                                   \
+    X(0x75, "LD (HL),L", 1, ld_hl_r(gb, &gb->cpu.l))                                                                   \
+    X(0x76, "HALT", 1, halt(gb))                                                                                       \
+    X(0x77, "LD (HL),A", 1, ld_hl_r(gb, &gb->cpu.a))                                                                   \
+    X(0x78, "LD A,B", 1, ld_r_r(gb, &gb->cpu.a, &gb->cpu.b))                                                           \
+    X(0x79, "LD A,C", 1, ld_r_r(gb, &gb->cpu.a, &gb->cpu.c))                                                           \
+    X(0x7A, "LD A,D", 1, ld_r_r(gb, &gb->cpu.a, &gb->cpu.d))                                                           \
+    X(0x7B, "LD A,E", 1, ld_r_r(gb, &gb->cpu.a, &gb->cpu.e))                                                           \
+    X(0x7C, "LD A,H", 1, ld_r_r(gb, &gb->cpu.a, &gb->cpu.h))                                                           \
+    X(0x7D, "LD A,L", 1, ld_r_r(gb, &gb->cpu.a, &gb->cpu.l))                                                           \
+    X(0x7E, "LD A,(HL)", 1, ld_r_hl(gb, &gb->cpu.a))                                                                   \
+    X(0x7F, "LD A,A", 1, ld_r_r(gb, &gb->cpu.a, &gb->cpu.a))                                                           \
+    X(0x80, "ADD A,B", 1, add_a_r(gb, &gb->cpu.b))                                                                     \
+    X(0x81, "ADD A,C", 1, add_a_r(gb, &gb->cpu.c))                                                                     \
+    X(0x82, "ADD A,D", 1, add_a_r(gb, &gb->cpu.d))                                                                     \
+    X(0x83, "ADD A,E", 1, add_a_r(gb, &gb->cpu.e))                                                                     \
+    X(0x84, "ADD A,H", 1, add_a_r(gb, &gb->cpu.h))                                                                     \
+    X(0x85, "ADD A,L", 1, add_a_r(gb, &gb->cpu.l))                                                                     \
+    X(0x86, "ADD A,(HL)", 1, add_a_hl(gb))                                                                             \
+    X(0x87, "ADD A,A", 1, add_a_r(gb, &gb->cpu.a))                                                                     \
+    X(0x88, "ADC A,B", 1, adc_a_r(gb, &gb->cpu.b))                                                                     \
+    X(0x89, "ADC A,C", 1, adc_a_r(gb, &gb->cpu.c))                                                                     \
+    X(0x8A, "ADC A,D", 1, adc_a_r(gb, &gb->cpu.d))                                                                     \
+    X(0x8B, "ADC A,E", 1, adc_a_r(gb, &gb->cpu.e))                                                                     \
+    X(0x8C, "ADC A,H", 1, adc_a_r(gb, &gb->cpu.h))                                                                     \
+    X(0x8D, "ADC A,L", 1, adc_a_r(gb, &gb->cpu.l))                                                                     \
+    X(0x8E, "ADC A,(HL)", 1, adc_a_hl(gb))                                                                             \
+    X(0x8F, "ADC A,A", 1, adc_a_r(gb, &gb->cpu.a))                                                                     \
+    X(0x90, "SUB A,B", 1, sub_a_r(gb, &gb->cpu.b))                                                                     \
+    X(0x91, "SUB A,C", 1, sub_a_r(gb, &gb->cpu.c))                                                                     \
+    X(0x92, "SUB A,D", 1, sub_a_r(gb, &gb->cpu.d))                                                                     \
+    X(0x93, "SUB A,E", 1, sub_a_r(gb, &gb->cpu.e))                                                                     \
+    X(0x94, "SUB A,H", 1, sub_a_r(gb, &gb->cpu.h))                                                                     \
+    X(0x95, "SUB A,L", 1, sub_a_r(gb, &gb->cpu.l))                                                                     \
+    X(0x96, "SUB A,(HL)", 1, sub_a_hl(gb))                                                                             \
+    X(0x97, "SUB A,A", 1, sub_a_r(gb, &gb->cpu.a))                                                                     \
+    X(0x98, "SBC A,B", 1, sbc_a_r(gb, &gb->cpu.b))                                                                     \
+    X(0x99, "SBC A,C", 1, sbc_a_r(gb, &gb->cpu.c))                                                                     \
+    X(0x9A, "SBC A,D", 1, sbc_a_r(gb, &gb->cpu.d))                                                                     \
+    X(0x9B, "SBC A,E", 1, sbc_a_r(gb, &gb->cpu.e))                                                                     \
+    X(0x9C, "SBC A,H", 1, sbc_a_r(gb, &gb->cpu.h))                                                                     \
+    X(0x9D, "SBC A,L", 1, sbc_a_r(gb, &gb->cpu.l))                                                                     \
+    X(0x9E, "SBC A,(HL)", 1, sbc_a_hl(gb))                                                                             \
+    X(0x9F, "SBC A,A", 1, sbc_a_r(gb, &gb->cpu.a))                                                                     \
+    X(0xA0, "AND A,B", 1, and_a_r(gb, &gb->cpu.b))                                                                     \
+    X(0xA1, "AND A,C", 1, and_a_r(gb, &gb->cpu.c))                                                                     \
+    X(0xA2, "AND A,D", 1, and_a_r(gb, &gb->cpu.d))                                                                     \
+    X(0xA3, "AND A,E", 1, and_a_r(gb, &gb->cpu.e))                                                                     \
+    X(0xA4, "AND A,H", 1, and_a_r(gb, &gb->cpu.h))                                                                     \
+    X(0xA5, "AND A,L", 1, and_a_r(gb, &gb->cpu.l))                                                                     \
+    X(0xA6, "AND A,(HL)", 1, and_a_hl(gb))                                                                             \
+    X(0xA7, "AND A,A", 1, and_a_r(gb, &gb->cpu.a))                                                                     \
+    X(0xA8, "XOR A,B", 1, xor_a_r(gb, &gb->cpu.b))                                                                     \
+    X(0xA9, "XOR A,C", 1, xor_a_r(gb, &gb->cpu.c))                                                                     \
+    X(0xAA, "XOR A,D", 1, xor_a_r(gb, &gb->cpu.d))                                                                     \
+    X(0xAB, "XOR A,E", 1, xor_a_r(gb, &gb->cpu.e))                                                                     \
+    X(0xAC, "XOR A,H", 1, xor_a_r(gb, &gb->cpu.h))                                                                     \
+    X(0xAD, "XOR A,L", 1, xor_a_r(gb, &gb->cpu.l))                                                                     \
+    X(0xAE, "XOR A,(HL)", 1, xor_a_hl(gb))                                                                             \
+    X(0xAF, "XOR A,A", 1, xor_a_r(gb, &gb->cpu.a))                                                                     \
+    X(0xB0, "OR A,B", 1, or_a_r(gb, &gb->cpu.b))                                                                       \
+    X(0xB1, "OR A,C", 1, or_a_r(gb, &gb->cpu.c))                                                                       \
+    X(0xB2, "OR A,D", 1, or_a_r(gb, &gb->cpu.d))                                                                       \
+    X(0xB3, "OR A,E", 1, or_a_r(gb, &gb->cpu.e))                                                                       \
+    X(0xB4, "OR A,H", 1, or_a_r(gb, &gb->cpu.h))                                                                       \
+    X(0xB5, "OR A,L", 1, or_a_r(gb, &gb->cpu.l))                                                                       \
+    X(0xB6, "OR A,(HL)", 1, or_a_hl(gb))                                                                               \
+    X(0xB7, "OR A,A", 1, or_a_r(gb, &gb->cpu.a))                                                                       \
+    X(0xB8, "CP A,B", 1, cp_a_r(gb, &gb->cpu.b))                                                                       \
+    X(0xB9, "CP A,C", 1, cp_a_r(gb, &gb->cpu.c))                                                                       \
+    X(0xBA, "CP A,D", 1, cp_a_r(gb, &gb->cpu.d))                                                                       \
+    X(0xBB, "CP A,E", 1, cp_a_r(gb, &gb->cpu.e))                                                                       \
+    X(0xBC, "CP A,H", 1, cp_a_r(gb, &gb->cpu.h))                                                                       \
+    X(0xBD, "CP A,L", 1, cp_a_r(gb, &gb->cpu.l))                                                                       \
+    X(0xBE, "CP A,(HL)", 1, cp_a_hl(gb))                                                                               \
+    X(0xBF, "CP A,A", 1, cp_a_r(gb, &gb->cpu.a))                                                                       \
+    X(0xC0, "RET NZ", 1, ret_cc(gb, get_z(&gb->cpu) == 0))                                                             \
+    X(0xC1, "POP BC", 1, pop_rr(gb, &gb->cpu.bc))                                                                      \
+    X(0xC2, "JP NZ,u16", 3, jp_cc_nn(gb, get_z(&gb->cpu) == 0))                                                        \
+    X(0xC3, "JP u16", 3, jp_nn(gb))                                                                                    \
+    X(0xC4, "CALL NZ,u16", 3, call_cc_nn(gb, get_z(&gb->cpu) == 0))                                                    \
+    X(0xC5, "PUSH BC", 1, push_rr(gb, &gb->cpu.bc))                                                                    \
+    X(0xC6, "ADD A,u8", 2, add_a_n(gb))                                                                                \
+    X(0xC7, "RST 00h", 1, rst(gb, 0x00))                                                                               \
+    X(0xC8, "RET Z", 1, ret_cc(gb, get_z(&gb->cpu) == 1))                                                              \
+    X(0xC9, "RET", 1, ret(gb))                                                                                         \
+    X(0xCA, "JP Z,u16", 3, jp_cc_nn(gb, get_z(&gb->cpu) == 1))                                                         \
+    X(0xCB, "PREFIX CB", 2, prefix_op(gb))                                                                             \
+    X(0xCC, "CALL Z,u16", 3, call_cc_nn(gb, get_z(&gb->cpu) == 1))                                                     \
+    X(0xCD, "CALL u16", 3, call_nn(gb))                                                                                \
+    X(0xCE, "ADC A,u8", 2, adc_a_n(gb))                                                                                \
+    X(0xCF, "RST 08h", 1, rst(gb, 0x08))                                                                               \
+    X(0xD0, "RET NC", 1, ret_cc(gb, get_c(&gb->cpu) == 0))                                                             \
+    X(0xD1, "POP DE", 1, pop_rr(gb, &gb->cpu.de))                                                                      \
+    X(0xD2, "JP NC,u16", 3, jp_cc_nn(gb, get_c(&gb->cpu) == 0))                                                        \
+    X(0xD3, "ILLEGAL_D3", 1, undefined_op(gb))                                                                         \
+    X(0xD4, "CALL NC,u16", 3, call_cc_nn(gb, get_c(&gb->cpu) == 0))                                                    \
+    X(0xD5, "PUSH DE", 1, push_rr(gb, &gb->cpu.de))                                                                    \
+    X(0xD6, "SUB A,u8", 2, sub_a_n(gb))                                                                                \
+    X(0xD7, "RST 10h", 1, rst(gb, 0x10))                                                                               \
+    X(0xD8, "RET C", 1, ret_cc(gb, get_c(&gb->cpu) == 1))                                                              \
+    X(0xD9, "RETI", 1, reti(gb))                                                                                       \
+    X(0xDA, "JP C,u16", 3, jp_cc_nn(gb, get_c(&gb->cpu) == 1))                                                         \
+    X(0xDB, "ILLEGAL_DB", 1, undefined_op(gb))                                                                         \
+    X(0xDC, "CALL C,u16", 3, call_cc_nn(gb, get_c(&gb->cpu) == 1))                                                     \
+    X(0xDD, "ILLEGAL_DD", 1, undefined_op(gb))                                                                         \
+    X(0xDE, "SBC A,u8", 2, sbc_a_n(gb))                                                                                \
+    X(0xDF, "RST 18h", 1, rst(gb, 0x18))                                                                               \
+    X(0xE0, "LD (FF00+u8),A", 2, ldh_n_a(gb))                                                                          \
+    X(0xE1, "POP HL", 1, pop_rr(gb, &gb->cpu.hl))                                                                      \
+    X(0xE2, "LD (FF00+C),A", 1, ldh_c_a(gb))                                                                           \
+    X(0xE3, "ILLEGAL_E3", 1, undefined_op(gb))                                                                         \
+    X(0xE4, "ILLEGAL_E4", 1, undefined_op(gb))                                                                         \
+    X(0xE5, "PUSH HL", 1, push_rr(gb, &gb->cpu.hl))                                                                    \
+    X(0xE6, "AND A,u8", 2, and_a_n(gb))                                                                                \
+    X(0xE7, "RST 20h", 1, rst(gb, 0x20))                                                                               \
+    X(0xE8, "ADD SP,i8", 2, add_sp_e8(gb))                                                                             \
+    X(0xE9, "JP HL", 1, jp_hl(gb))                                                                                     \
+    X(0xEA, "LD (u16),A", 3, ld_nn_a(gb))                                                                              \
+    X(0xEB, "ILLEGAL_EB", 1, undefined_op(gb))                                                                         \
+    X(0xEC, "ILLEGAL_EC", 1, undefined_op(gb))                                                                         \
+    X(0xED, "ILLEGAL_ED", 1, undefined_op(gb))                                                                         \
+    X(0xEE, "XOR A,u8", 2, xor_a_n(gb))                                                                                \
+    X(0xEF, "RST 28h", 1, rst(gb, 0x28))                                                                               \
+    X(0xF0, "LD A,(FF00+u8)", 2, ldh_a_n(gb))                                                                          \
+    X(0xF1, "POP AF", 1, pop_af(gb))                                                                                   \
+    X(0xF2, "LD A,(FF00+C)", 1, ldh_a_c(gb))                                                                           \
+    X(0xF3, "DI", 1, di(gb))                                                                                           \
+    X(0xF4, "ILLEGAL_F4", 1, undefined_op(gb))                                                                         \
+    X(0xF5, "PUSH AF", 1, push_af(gb))                                                                                 \
+    X(0xF6, "OR A,u8", 2, or_a_n(gb))                                                                                  \
+    X(0xF7, "RST 30h", 1, rst(gb, 0x30))                                                                               \
+    X(0xF8, "LD HL,SP+i8", 2, ld_hl_spe8(gb))                                                                          \
+    X(0xF9, "LD SP,HL", 1, ld_sp_hl(gb))                                                                               \
+    X(0xFA, "LD A,(u16)", 3, ld_a_nn(gb))                                                                              \
+    X(0xFB, "EI", 1, ei(gb))                                                                                           \
+    X(0xFC, "ILLEGAL_FC", 1, undefined_op(gb))                                                                         \
+    X(0xFD, "ILLEGAL_FD", 1, undefined_op(gb))                                                                         \
+    X(0xFE, "CP A,u8", 2, cp_a_n(gb))                                                                                  \
+    X(0xFF, "RST 38h", 1, rst(gb, 0x38))
+
+// clang-format on
+
+#endif
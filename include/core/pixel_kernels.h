@@ -0,0 +1,46 @@
+#ifndef CORE_PIXEL_KERNELS_H
+#define CORE_PIXEL_KERNELS_H
+
+#include <stdint.h>
+
+/*
+ * Batched per pixel work of the PPU, with a scalar version and SSE2/AVX2 ones on x86 selected at runtime.
+ *
+ * A line is composed from two bytes per pixel: the BG color index and the object pixel popped with it, if any. The
+ * result is an index in a 16 entries table of frame buffer pixels (BGP colors 0-3, OBP0 colors 4-7, OBP1 colors
+ * 12-15), an object pixel byte being that index ORed with its priority bit.
+ */
+
+// clang-format off
+#define PIXEL_OBJ           0x04 /* An object pixel was popped with the BG one */
+#define PIXEL_OBJ_OBP1      0x08
+#define PIXEL_OBJ_PRIORITY  0x10 /* BG colors 1-3 over the object */
+#define PIXEL_ENTRY_MASK    0x0F
+// clang-format on
+
+struct pixel_kernels
+{
+    const char *name;
+
+    /* Color indices of rows of 2bpp tile data (low byte then high byte), leftmost pixel first */
+    void (*decode_rows)(const uint8_t *data, unsigned int rows, uint8_t *colors);
+
+    /* Resolve the OBJ-over-BG priority with the LCDC enable bits and write the 32 bits pixels of the entries */
+    void (*compose_line)(const uint8_t *bg, const uint8_t *obj, uint8_t lcdc, const uint32_t *lut, void *out,
+                         unsigned int count);
+};
+
+extern const struct pixel_kernels pixel_kernels_scalar;
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define PIXEL_KERNELS_X86
+extern const struct pixel_kernels pixel_kernels_sse2;
+extern const struct pixel_kernels pixel_kernels_avx2;
+#endif
+
+/* Kernels in use, the scalar ones until pixel_kernels_init() */
+extern const struct pixel_kernels *pixel_kernels;
+
+/* Select the fastest kernels the CPU supports */
+void pixel_kernels_init(void);
+
+#endif
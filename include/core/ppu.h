@@ -47,12 +47,16 @@ struct fetcher
     uint8_t lx_save;
 };
 
+#define DMA_START_DELAY 8 /* TCycles between the DMA write and the transfer start */
+#define DMA_BYTE_PERIOD 4
+
 typedef struct dma_request
 {
-    uint8_t status;
+    uint64_t start; /* Master clock timestamp of the transfer start */
     uint8_t source;
 } dma_request;
 
+/* MCycles left before a request is active, as stored in save states */
 enum dma_status
 {
     DMA_REQUESTED = 3,
@@ -62,6 +66,14 @@ enum dma_status
 
 DEFINE_RING_BUFFER(dma_request, 3)
 
+/* Per ROM choice of the renderer, PPU_RENDERER_DEFAULT follows the global setting */
+enum ppu_renderer
+{
+    PPU_RENDERER_DEFAULT,
+    PPU_RENDERER_FIFO,
+    PPU_RENDERER_SCANLINE
+};
+
 struct ppu
 {
     uint8_t mode2_tick;
@@ -77,9 +89,12 @@ struct ppu
     } obj_slots[10];
 
     int8_t obj_count;
+    uint8_t obj_scan_lazy; // obj_slots were taken from obj_lines at the start of the OAM scan, see ppu_oam_scan_sync()
+    uint8_t obj_order[10]; // obj_slots indices sorted by X during mode 3, OAM order for the same X
+    uint8_t obj_next;      // First entry of obj_order left for on_object()
 
-    RING_BUFFER(pixel) bg_fifo;
-    RING_BUFFER(pixel) obj_fifo;
+    struct pixel_fifo bg_fifo;
+    struct pixel_fifo obj_fifo;
 
     struct fetcher bg_fetcher;
     struct fetcher obj_fetcher;
@@ -87,10 +102,14 @@ struct ppu
     uint8_t oam_locked;
     uint8_t vram_locked;
 
-    RING_BUFFER(dma_request) dma_requests;
+    RING_BUFFER(dma_request) dma_requests; /* Not started yet */
 
+    /* Current transfer, see dma_catch_up() */
     uint8_t dma;
-    uint8_t dma_acc;
+    uint8_t dma_acc; /* Bytes already copied */
+    uint8_t dma_source;
+    const uint8_t *dma_source_page; /* Host pointer, NULL when read through the bus, see page_table.h */
+    uint64_t dma_start;
 
     uint16_t line_dot_count; // Dot count for current scanline
     uint8_t mode1_153th;
@@ -104,8 +123,25 @@ struct ppu
     uint8_t wy_trigger;
 
     uint8_t obj_mode;
+
+    /* Scanline renderer, see ppu_render_sync() */
+    enum ppu_renderer renderer;
+    uint8_t fast_line;      // Current line is drawn in one pass at the end of mode 3
+    uint16_t fast_line_end; // line_dot_count of the last mode 3 dot
+
+    /* Pixels of the current line, composed in batches, see ppu_render_sync() and pixel_kernels.h */
+    uint8_t line_bg[SCREEN_WIDTH];
+    uint8_t line_obj[SCREEN_WIDTH];
+    uint8_t line_drawn; // Pixels already in the frame buffer
+
+    uint64_t sync_time; /* Master clock time the PPU has run up to, see ppu_catch_up() */
 };
 
+static inline int is_ppu_register(uint16_t address)
+{
+    return address >= LCDC && address <= WX;
+}
+
 static inline int get_lcdc(uint8_t *io, int bit)
 {
     return io[IO_OFFSET(LCDC)] >> bit & 0x01;
@@ -132,10 +168,65 @@ void ppu_init(struct gb_core *gb);
 
 void ppu_reset(struct gb_core *gb);
 
-void dma_handle(struct gb_core *gb);
+void dma_request_transfer(struct gb_core *gb, uint8_t source);
+
+/*
+ * OAM DMA only costs anything while a transfer is running. The SCHED_DMA event fires when a request starts and when
+ * the transfer ends, in between the bytes due are copied in chunks from the host pointer of the source page, before
+ * the PPU scans OAM and before any CPU write which may modify the source (its page has no write pointer meanwhile, see
+ * page_table.h). Sources without a host pointer are read one byte per MCycle through the bus instead.
+ *
+ * The CPU side of the bus conflict is the dma flag: OAM reads $FF and ignores writes while it is set, reads on the
+ * bus of the source return the byte being copied (see read.h).
+ */
+void dma_catch_up(struct gb_core *gb);
+
+/* Byte the running transfer reads from its source during the current MCycle */
+uint8_t dma_bus_value(struct gb_core *gb);
+
+/* Must be called after the memory mapping may have changed during a transfer */
+void dma_schedule(struct gb_core *gb);
+
+/*
+ * The scanline renderer draws a line in one pass on the last dot of mode 3 instead of shifting the pixel FIFO every
+ * dot, the dots before are skipped at once. It only takes lines without objects nor window, whose mode 3 length only
+ * depends on SCX: lines showing objects or the window always use the FIFO, so games drawing them on most lines gain
+ * little. Such a line only reads VRAM (locked during mode 3) and LCDC, SCY, SCX and BGP, the WX and WY writes may
+ * start the window: the PPU switches back to the FIFO before any of them is written during mode 3, replaying the dots
+ * already elapsed in the line, which gives the same pixels and timings as if the FIFO had drawn the whole line.
+ *
+ * The FIFO only pops the pixels of a line, they are composed and written to the frame buffer with the palettes when
+ * the line ends. Pixels popped before a write to LCDC or a palette are composed first.
+ *
+ * Must be called before LCDC, SCY, SCX, BGP, OBP0, OBP1, WY or WX is written and before saving a state.
+ */
+void ppu_render_sync(struct gb_core *gb);
+
+/*
+ * The OAM scan takes the objects of its line from obj_lines (see obj_lines.h) on its first dot instead of checking one
+ * OAM entry every two dots, unless an OAM DMA is running or requested. Before OAM or LCDC.2 changes during the scan,
+ * the PPU keeps the objects of the entries already scanned and checks the remaining ones every two dots, which selects
+ * the same objects as if the whole line had been scanned that way.
+ *
+ * Must be called before LCDC is written, before an OAM DMA is requested or OAM is modified during mode 2, and before
+ * saving a state.
+ */
+void ppu_oam_scan_sync(struct gb_core *gb);
 
 void ppu_tick(struct gb_core *gb);
 
+/*
+ * The PPU lags behind the CPU and runs the dots elapsed since sync_time in one batch when it is resumed. It must be
+ * caught up before anything observes or modifies its state (VRAM, OAM, 0xFF40-0xFF4B, OAM DMA) and before it may
+ * request an interrupt, the SCHED_PPU event being set accordingly, so IF is always exact at MCycle boundaries. Only IF
+ * is shared with the timer, serial and APU, and they only set bits in it, so running the dots late doesn't change the
+ * emulation.
+ */
+void ppu_catch_up(struct gb_core *gb);
+
+/* Lower bound of the dots the PPU can run without changing LY nor STAT, must be called right after ppu_catch_up() */
+uint16_t ppu_stable_dots(struct gb_core *gb);
+
 void ppu_oam_bug_w(struct gb_core *gb);
 void ppu_oam_bug_r(struct gb_core *gb);
 void ppu_oam_bug_rw(struct gb_core *gb);
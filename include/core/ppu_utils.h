@@ -2,37 +2,69 @@
 #define CORE_PPU_UTILS_H
 
 #include <stdint.h>
-
-#include "ring_buffer.h"
+#include <string.h>
 
 struct gb_core;
 struct ppu;
 
-typedef struct pixel
+/*
+ * Pixel FIFO as the shift registers of the hardware: one bit per pixel in each plane, the front pixel in bit 7. Pops
+ * shift every plane left so the bits past count are always 0, a push into the empty FIFO is an OR of the slice.
+ */
+struct pixel_fifo
+{
+    uint8_t lo;
+    uint8_t hi;
+    uint8_t palette;  // OBJ FIFO only, set for OBP1
+    uint8_t priority; // OBJ FIFO only, set when BG colors 1-3 are over the object
+    uint8_t count;
+};
+
+static inline void pixel_fifo_clear(struct pixel_fifo *fifo)
+{
+    memset(fifo, 0, sizeof(struct pixel_fifo));
+}
+
+static inline int pixel_fifo_is_empty(const struct pixel_fifo *fifo)
+{
+    return fifo->count == 0;
+}
+
+// Color index of the front pixel, 0 when empty
+static inline uint8_t pixel_fifo_front(const struct pixel_fifo *fifo)
 {
-    int8_t obj;
-    uint8_t color;
-    uint8_t palette;
-    uint8_t priority;
-} pixel;
+    return ((fifo->hi >> 6) & 0x02) | (fifo->lo >> 7);
+}
 
-DEFINE_RING_BUFFER(pixel, 8)
+static inline void pixel_fifo_shift(struct pixel_fifo *fifo)
+{
+    if (!fifo->count)
+        return;
+    fifo->lo <<= 1;
+    fifo->hi <<= 1;
+    fifo->palette <<= 1;
+    fifo->priority <<= 1;
+    --fifo->count;
+}
 
 // on_window: read LX and LY and check if drawing in Window or BG
 int on_window(struct gb_core *gb);
 
-// on_object: reads the 10 OAM slots and checks if we need to draw an object at current LX LY
+// on_object: checks the OAM slots sorted by X if we need to draw an object at current LX LY
 // returns object index in obj_slots, -1 if no object
 int on_object(struct gb_core *gb, int *bottom_part);
 
-struct pixel select_pixel(struct gb_core *gb);
+// pop_pixel: pop a BG pixel and the OBJ pixel in front of it, composed later, see pixel_kernels.h
+// bg and obj may be NULL to discard them
+void pop_pixel(struct gb_core *gb, uint8_t *bg, uint8_t *obj);
 
-int push_slice(struct gb_core *gb, RING_BUFFER(pixel) * q, uint8_t hi, uint8_t lo, int obj_i);
+// Fill an empty FIFO with the slice planes, leftmost pixel in bit 7
+int push_slice(struct gb_core *gb, struct pixel_fifo *fifo, uint8_t lo, uint8_t hi, int obj_i);
 
 uint8_t slice_xflip(uint8_t slice);
 
 // OBJ Merge version of push_slice in case it is not empty, overwrite transparent pixels OBJ FIFO
-int merge_obj(struct gb_core *gb, uint8_t hi, uint8_t lo, int obj_i);
+int merge_obj(struct gb_core *gb, uint8_t lo, uint8_t hi);
 
 void check_lyc(struct gb_core *gb, int line_153);
 
@@ -0,0 +1,25 @@
+#ifndef CORE_ROM_IMAGE_H
+#define CORE_ROM_IMAGE_H
+
+#include <stdint.h>
+
+/*
+ * Read only ROM images shared by every core of the process loading the same ROM content, identified by a hash of the
+ * file. On Linux and macOS the file is mapped with mmap() so the pages also come from the page cache shared with other
+ * processes, elsewhere it is read into a buffer. On Linux and macOS a file already loaded and not modified since (same
+ * device, inode, size and modification time to the nanosecond) is found without being mapped and hashed again.
+ *
+ * The mapping is not a copy: a ROM file must not be truncated nor rewritten in place while a core runs it. Truncating
+ * it makes every core sharing the image crash with SIGBUS on its next read past the new end, rewriting it changes the
+ * ROM under them. Tools replacing the file through a rename, like most editors and build systems do, are safe.
+ *
+ * Images are padded with zeroes to a power of two covering at least the size declared in the cartridge header and
+ * 32 KiB, so the MBC masking of bank numbers never reads past the end.
+ */
+
+/* NULL on failure, the error is logged */
+uint8_t *rom_image_acquire(const char *path);
+
+void rom_image_release(uint8_t *data);
+
+#endif
@@ -0,0 +1,47 @@
+#ifndef CORE_SCHEDULER_H
+#define CORE_SCHEDULER_H
+
+#include <stdint.h>
+
+/*
+ * Event scheduler driven by a 64 bit master clock counting TCycles since power on, never reset.
+ *
+ * Components which don't need to run in lockstep with the CPU let time accumulate and run it in one batch when they
+ * are observed (register access, save state) or when their next event is due, the earliest of which being the only
+ * thing tick_m() checks. A component registers its next event with scheduler_schedule() every time it catches up.
+ * Events are kept in a binary min-heap with one slot per kind.
+ */
+
+#define SCHED_NEVER UINT64_MAX
+
+enum sched_event
+{
+    SCHED_PPU = 0, /* PPU catch-up before it may request an interrupt */
+    SCHED_APU,     /* Periodic APU catch-up bounding the audio latency */
+    SCHED_TIMER,   /* TIMA overflow reload and interrupt */
+    SCHED_SERIAL,  /* End of a serial transfer */
+    SCHED_DMA,     /* Start and end of an OAM DMA transfer */
+    SCHED_EVENT_COUNT,
+};
+
+struct scheduler
+{
+    uint64_t now;
+    uint64_t next; /* Timestamp of the earliest event */
+
+    uint64_t timestamps[SCHED_EVENT_COUNT];
+    uint8_t heap[SCHED_EVENT_COUNT];
+    uint8_t positions[SCHED_EVENT_COUNT]; /* Index of every event in heap */
+};
+
+struct gb_core;
+
+void scheduler_init(struct scheduler *scheduler);
+
+/* Move the event to timestamp, SCHED_NEVER cancels it */
+void scheduler_schedule(struct gb_core *gb, enum sched_event event, uint64_t timestamp);
+
+/* Run every event due at the current time, each handler is responsible for scheduling its next occurrence */
+void scheduler_run(struct gb_core *gb);
+
+#endif
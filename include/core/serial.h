@@ -13,8 +13,22 @@ static inline uint8_t get_transfer_enable(struct gb_core *gb)
     return (gb->memory.io[IO_OFFSET(SC)] >> 7) & 0x01;
 }
 
+/*
+ * The 8192 Hz serial clock is derived from the master clock. The port only runs when SB or SC are accessed, and while
+ * a transfer is active when its completion event fires.
+ */
+
 void serial_transfer(struct gb_core *gb);
 
-void update_serial(struct gb_core *gb);
+void serial_init(struct gb_core *gb);
+
+uint16_t serial_get_clock(struct gb_core *gb);
+void serial_set_clock(struct gb_core *gb, uint16_t clock);
+
+/* Run the port up to the master clock and schedule the end of the current transfer */
+void serial_catch_up(struct gb_core *gb);
+
+/* Must be called after SC was written */
+void serial_schedule(struct gb_core *gb);
 
 #endif
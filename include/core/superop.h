@@ -0,0 +1,43 @@
+#ifndef CORE_SUPEROP_H
+#define CORE_SUPEROP_H
+
+#include <stdint.h>
+
+/*
+ * Superinstructions for the canonical copy and fill loops found in ROM, such as
+ * "ld a,(hl+); ld (de),a; inc de; dec bc; ld a,b; or c; jr nz".
+ *
+ * Loops are matched when their first instruction is decoded (see decode_cache_fill()). When the head is fetched and
+ * both ranges sit in memory without side effects (ROM, WRAM, HRAM, VRAM and OAM with the LCD off), whole iterations
+ * are run as one host copy followed by their exact MCycles. Interrupts must not be able to be serviced in between,
+ * the last iteration is always left to the interpreter so the CPU stops at the loop head with exact registers.
+ */
+
+/* Stop after this many MCycles so the frontend keeps synchronizing during long loops */
+#define SUPEROP_MAX_MCYCLES 456
+
+enum superop
+{
+    SUPEROP_NONE = 0,
+    SUPEROP_COPY_HL_DE, /* ld a,(hl+); ld (de),a; inc de; dec bc; ld a,b; or c; jr nz */
+    SUPEROP_COPY_DE_HL, /* ld a,(de); ld (hl+),a; inc de; dec bc; ld a,b; or c; jr nz */
+    SUPEROP_COPY8_B,    /* ld a,(hl+); ld (de),a; inc de; dec b; jr nz */
+    SUPEROP_COPY8_C,    /* ld a,(hl+); ld (de),a; inc de; dec c; jr nz */
+    SUPEROP_FILL_INC_B, /* ld (hl+),a; dec b; jr nz */
+    SUPEROP_FILL_INC_C, /* ld (hl+),a; dec c; jr nz */
+    SUPEROP_FILL_DEC_B, /* ld (hl-),a; dec b; jr nz */
+    SUPEROP_FILL_DEC_C, /* ld (hl-),a; dec c; jr nz */
+};
+
+struct gb_core;
+
+/* Superinstruction starting at the ROM address, which must be a valid address for read_mbc_rom() */
+uint8_t superop_match(struct gb_core *gb, uint16_t address);
+
+/*
+ * Called right after the head opcode of a matched loop was fetched, returns the MCycles taken by the iterations run
+ * including that fetch, or 0 when the opcode must be executed normally.
+ */
+int superop_run(struct gb_core *gb, uint8_t superop);
+
+#endif
@@ -0,0 +1,70 @@
+#ifndef CORE_TILE_CACHE_H
+#define CORE_TILE_CACHE_H
+
+#include <stdint.h>
+#include <string.h>
+
+/* Tile data at 0x8000-0x97FF, the tile maps follow */
+#define TILE_DATA_SIZE 0x1800
+#define TILE_COUNT (TILE_DATA_SIZE / 16)
+
+/* Bitplanes of a tile row as the fetchers push them into the pixel FIFOs, also mirrored for X flipped objects */
+struct tile_planes
+{
+    uint8_t lo;
+    uint8_t hi;
+    uint8_t lo_xflip;
+    uint8_t hi_xflip;
+};
+
+/*
+ * Every tile decoded to one color index per pixel, leftmost pixel first, for the scanline renderer and to its
+ * bitplanes for the fetchers. A tile is decoded again on its first use after a write to its bytes: every write to the
+ * tile data must invalidate it, which is why the tile data pages have no write pointer (see page_table.h).
+ */
+struct tile_cache
+{
+    uint8_t rows[TILE_COUNT][8][8];
+    struct tile_planes planes[TILE_COUNT][8];
+    uint64_t dirty[TILE_COUNT / 64];
+};
+
+void tile_cache_decode(struct tile_cache *cache, const uint8_t *vram, unsigned int tile);
+
+static inline void tile_cache_invalidate_all(struct tile_cache *cache)
+{
+    memset(cache->dirty, 0xFF, sizeof(cache->dirty));
+}
+
+/* offset is relative to the start of VRAM, writes to the tile maps are ignored */
+static inline void tile_cache_invalidate(struct tile_cache *cache, uint16_t offset)
+{
+    unsigned int tile = offset / 16;
+    if (tile < TILE_COUNT)
+        cache->dirty[tile / 64] |= (uint64_t)1 << (tile % 64);
+}
+
+void tile_cache_invalidate_range(struct tile_cache *cache, uint16_t offset, uint32_t length);
+
+/* The 8 pixels of the row whose low byte is at offset in the tile data */
+static inline const uint8_t *tile_cache_row(struct tile_cache *cache, const uint8_t *vram, uint16_t offset)
+{
+    unsigned int tile = offset / 16;
+    if ((cache->dirty[tile / 64] >> (tile % 64)) & 0x01)
+        tile_cache_decode(cache, vram, tile);
+    unsigned int row = (offset >> 1) & 0x07;
+    return cache->rows[tile][row];
+}
+
+/* The bitplanes of the row whose low byte is at offset in the tile data */
+static inline const struct tile_planes *tile_cache_planes(struct tile_cache *cache, const uint8_t *vram,
+                                                          uint16_t offset)
+{
+    unsigned int tile = offset / 16;
+    if ((cache->dirty[tile / 64] >> (tile % 64)) & 0x01)
+        tile_cache_decode(cache, vram, tile);
+    unsigned int row = (offset >> 1) & 0x07;
+    return &cache->planes[tile][row];
+}
+
+#endif
@@ -1,8 +1,31 @@
 #ifndef CORE_TIMERS_H
 #define CORE_TIMERS_H
 
+#include <stdint.h>
+
+#include "common.h"
+
+/*
+ * DIV is derived from the master clock and TIMA is run lazily: the falling edges of the TAC selected DIV bit between
+ * two catch-ups are counted in closed form and the next TIMA overflow is scheduled as an event. Writes leaving the
+ * falling edge detector out of step with DIV (DIV reset, TAC change) or a pending overflow reload are run one TCycle at
+ * a time so their glitches stay exact.
+ */
+
 struct gb_core;
 
-void update_timers(struct gb_core *gb);
+void timer_init(struct gb_core *gb);
+
+uint16_t timer_get_div(struct gb_core *gb);
+void timer_set_div(struct gb_core *gb, uint16_t div);
+
+/* TCycles DIV or TIMA (address) keeps the value read at the master clock for, TIMA must have been caught up */
+uint64_t timer_stable_tcycles(struct gb_core *gb, uint16_t address);
+
+/* Run TIMA up to the master clock and schedule its next overflow */
+void timer_catch_up(struct gb_core *gb);
+
+/* Must be called after TIMA, TMA or TAC were written */
+void timer_schedule(struct gb_core *gb);
 
 #endif
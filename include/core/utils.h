@@ -8,50 +8,110 @@
 /* CPU flags manipulation */
 static inline int get_z(struct cpu *cpu)
 {
-    return (cpu->f >> 7) & 1UL;
+    if (cpu->flags_kind == FLAGS_MATERIALISED)
+        return (cpu->f >> 7) & 1UL;
+    return (uint8_t)cpu->flags_result == 0;
+}
+
+static inline int get_n(struct cpu *cpu)
+{
+    switch (cpu->flags_kind)
+    {
+    case FLAGS_MATERIALISED:
+        return (cpu->f >> 6) & 1UL;
+    case FLAGS_SUB:
+    case FLAGS_DEC:
+        return 1;
+    default:
+        return 0;
+    }
+}
+
+static inline int get_h(struct cpu *cpu)
+{
+    switch (cpu->flags_kind)
+    {
+    case FLAGS_MATERIALISED:
+        return (cpu->f >> 5) & 1UL;
+    case FLAGS_AND:
+        return 1;
+    case FLAGS_OR:
+        return 0;
+    default:
+        // Carry (or borrow) into bit 4
+        return ((cpu->flags_lhs ^ cpu->flags_rhs ^ cpu->flags_result) >> 4) & 1UL;
+    }
+}
+
+static inline int get_c(struct cpu *cpu)
+{
+    switch (cpu->flags_kind)
+    {
+    case FLAGS_ADD:
+    case FLAGS_SUB:
+        return (cpu->flags_result >> 8) & 1UL;
+    case FLAGS_AND:
+    case FLAGS_OR:
+        return 0;
+    default:
+        return (cpu->f >> 4) & 1UL;
+    }
+}
+
+static inline uint8_t get_f(struct cpu *cpu)
+{
+    if (cpu->flags_kind == FLAGS_MATERIALISED)
+        return cpu->f;
+    return get_z(cpu) << 7 | get_n(cpu) << 6 | get_h(cpu) << 5 | get_c(cpu) << 4;
+}
+
+static inline void flags_materialise(struct cpu *cpu)
+{
+    cpu->f = get_f(cpu);
+    cpu->flags_kind = FLAGS_MATERIALISED;
+}
+
+/* Record an ALU result, the flags are only computed when read. result must keep bit 8 for add and sub carries */
+static inline void flags_set_lazy(struct cpu *cpu, uint8_t kind, uint8_t lhs, uint8_t rhs, uint16_t result)
+{
+    if (kind == FLAGS_INC || kind == FLAGS_DEC)
+        cpu->f = get_c(cpu) << 4;
+    cpu->flags_kind = kind;
+    cpu->flags_lhs = lhs;
+    cpu->flags_rhs = rhs;
+    cpu->flags_result = result;
 }
 
 static inline void set_z(struct cpu *cpu, int value)
 {
+    flags_materialise(cpu);
     if (value)
         cpu->f = cpu->f | 1UL << 7;
     else
         cpu->f = cpu->f & ~(1UL << 7);
 }
 
-static inline int get_n(struct cpu *cpu)
-{
-    return (cpu->f >> 6) & 1UL;
-}
-
 static inline void set_n(struct cpu *cpu, int value)
 {
+    flags_materialise(cpu);
     if (value)
         cpu->f = cpu->f | 1UL << 6;
     else
         cpu->f = cpu->f & ~(1UL << 6);
 }
 
-static inline int get_h(struct cpu *cpu)
-{
-    return (cpu->f >> 5) & 1UL;
-}
-
 static inline void set_h(struct cpu *cpu, int value)
 {
+    flags_materialise(cpu);
     if (value)
         cpu->f = cpu->f | 1UL << 5;
     else
         cpu->f = cpu->f & ~(1UL << 5);
 }
 
-static inline int get_c(struct cpu *cpu)
-{
-    return (cpu->f >> 4) & 1UL;
-}
-
 static inline void set_c(struct cpu *cpu, int value)
 {
+    flags_materialise(cpu);
     if (value)
         cpu->f = cpu->f | 1UL << 4;
     else
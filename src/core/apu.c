@@ -6,7 +6,10 @@
 
 #include "emulation.h"
 #include "gb_core.h"
+#include "io_registers.h"
+#include "scheduler.h"
 #include "serialization.h"
+#include "timers.h"
 
 // clang-format off
 static unsigned int duty_table[][8] = {
@@ -58,7 +61,6 @@ static unsigned int ch4_divisors[] = {
 #define SWEEP_DIR_INCREMENT 0
 #define SWEEP_DIR_DECREMENT 1
 
-#define WAVE_RAM 0xFF30
 #define WAVE_OUTPUT(NR32) (((NR32) >> 5) & 0x3)
 
 #define NOISE_CLOCK_DIVIDER_CODE(NR43) ((NR43) & 0x7)
@@ -75,6 +77,7 @@ static unsigned int ch4_divisors[] = {
 
 static union audio_sample audio_buffer[AUDIO_BUFFER_SIZE];
 static size_t audio_buffer_len = 0;
+static float capacitor = 0.0f; /* High pass filter state */
 
 struct ch_generic
 {
@@ -88,8 +91,9 @@ struct ch_generic
     uint32_t env_period;
 };
 
-void apu_init(struct apu *apu)
+void apu_init(struct gb_core *gb)
 {
+    struct apu *apu = &gb->apu;
     memset(apu, 0, sizeof(struct apu));
     memset(&apu->ch1, 0, sizeof(struct ch1));
     memset(&apu->ch2, 0, sizeof(struct ch2));
@@ -99,7 +103,11 @@ void apu_init(struct apu *apu)
     apu->sampling_counter = 0;
     apu->previous_div_apu = 0;
 
+    apu->sync_time = gb->scheduler.now;
+    scheduler_schedule(gb, SCHED_APU, gb->scheduler.now + APU_CATCH_UP_PERIOD);
+
     audio_buffer_len = 0;
+    capacitor = 0.0f;
 }
 
 static void length_trigger(struct gb_core *gb, uint8_t ch_number)
@@ -525,7 +533,6 @@ static unsigned int get_channel_amplitude(struct gb_core *gb, uint8_t ch_number,
     return 0;
 }
 
-static float capacitor = 0.0f;
 static float mix_channels(struct gb_core *gb, uint8_t panning)
 {
     float sum = 0.0f;
@@ -572,13 +579,10 @@ static void queue_audio_sample(struct gb_core *gb)
     }
 }
 
-void apu_tick(struct gb_core *gb)
+static void apu_tick(struct gb_core *gb, uint16_t div)
 {
-    if (!is_apu_on(gb))
-        return;
-
     // DIV bit 4 falling edge detection
-    if ((gb->apu.previous_div_apu & DIV_APU_MASK) && !(gb->internal_div & DIV_APU_MASK))
+    if ((gb->apu.previous_div_apu & DIV_APU_MASK) && !(div & DIV_APU_MASK))
         frame_sequencer_step(gb);
 
     ch1_tick(gb);
@@ -593,7 +597,40 @@ void apu_tick(struct gb_core *gb)
         gb->apu.sampling_counter -= CPU_FREQUENCY;
     }
 
-    gb->apu.previous_div_apu = gb->internal_div;
+    gb->apu.previous_div_apu = div;
+}
+
+static void clear_trigger_requests(struct gb_core *gb)
+{
+    gb->apu.ch1.trigger_request = 0;
+    gb->apu.ch2.trigger_request = 0;
+    gb->apu.ch3.trigger_request = 0;
+    gb->apu.ch4.trigger_request = 0;
+}
+
+void apu_catch_up(struct gb_core *gb)
+{
+    uint64_t now = gb->scheduler.now;
+    uint64_t pending = now - gb->apu.sync_time;
+    gb->apu.sync_time = now;
+    scheduler_schedule(gb, SCHED_APU, now + APU_CATCH_UP_PERIOD);
+    if (!pending)
+        return;
+
+    /* Catch-ups happen at MCycle boundaries, a trigger only holds its channel for the MCycle following the write */
+    if (is_apu_on(gb))
+    {
+        /* DIV as updated by the timer on every pending TCycle, DIV doesn't move in STOP mode */
+        uint16_t div = gb->stop ? 0 : timer_get_div(gb) - (pending - 1);
+        for (uint64_t i = 0; i < pending; ++i)
+        {
+            apu_tick(gb, div);
+            div += !gb->stop;
+            if (i == 3)
+                clear_trigger_requests(gb);
+        }
+    }
+    clear_trigger_requests(gb);
 }
 
 void apu_turn_off(struct gb_core *gb)
@@ -631,123 +668,137 @@ static void zombie_mode(struct gb_core *gb, struct ch_generic *ch, uint8_t val)
         ch->current_volume = (ch->current_volume + 1) % 16;
 }
 
-void apu_write_reg(struct gb_core *gb, uint16_t address, uint8_t val)
+/* On DMG it is possible to write initial timer on NRx1 even if APU is off */
+void apu_write_nrx1(struct gb_core *gb, uint16_t address, uint8_t val)
 {
-    switch (address)
-    {
-        /* On DMG it is possible to write initial timer on NRx1 even if APU is off */
-    case NR11:
-    case NR21:
-    case NR41:
-        if (!is_apu_on(gb))
-            val &= 0x3F;
-        /* fall through */
-    case NR31: /* no masking for NR31: whole register is initial timer */
-        io_write(gb->memory.io, address, val);
-        apu_reload_timer(gb, (address - NR11) / (NR21 - NR11) + 1);
-        return;
+    /* No masking for NR31: whole register is initial timer */
+    if (!is_apu_on(gb) && address != NR31)
+        val &= 0x3F;
+    io_write(gb->memory.io, address, val);
+    apu_reload_timer(gb, (address - NR11) / (NR21 - NR11) + 1);
+}
 
-    case NR12:
-        if (!is_apu_on(gb))
-            return;
-        if (!(val & 0xF8))
-            turn_channel_off(gb, 1);
-        zombie_mode(gb, (void *)&gb->apu.ch1, val);
-        break;
-    case NR22:
-        if (!is_apu_on(gb))
-            return;
-        if (!(val & 0xF8))
-            turn_channel_off(gb, 2);
-        zombie_mode(gb, (void *)&gb->apu.ch2, val);
-        break;
-    case NR42:
-        if (!is_apu_on(gb))
-            return;
-        if (!(val & 0xF8))
-            turn_channel_off(gb, 4);
-        zombie_mode(gb, (void *)&gb->apu.ch4, val);
-        break;
-    case NR30:
-        if (!is_apu_on(gb))
-            return;
-        if (!(val & 0x80))
-            turn_channel_off(gb, 3);
-        break;
+void apu_write_nrx2(struct gb_core *gb, uint16_t address, uint8_t val)
+{
+    if (!is_apu_on(gb))
+        return;
+    /* NR32 has no envelope, NR42 is laid out as a fourth square channel */
+    struct ch_generic *channels[] = {
+        (void *)&gb->apu.ch1,
+        (void *)&gb->apu.ch2,
+        NULL,
+        (void *)&gb->apu.ch4,
+    };
+    uint8_t index = (address - NR12) / (NR22 - NR12);
+    if (!(val & 0xF8))
+        turn_channel_off(gb, index + 1);
+    zombie_mode(gb, channels[index], val);
+    io_write(gb->memory.io, address, val);
+}
 
-    case NR10:
-        if (!is_apu_on(gb))
-            return;
-        /* Clearing dir bit when it was previously set may disable channel */
-        if (SWEEP_DIR(gb->memory.io[IO_OFFSET(address)]) && !(val & 0x08) && gb->apu.ch1.neg_calc)
-        {
-            gb->apu.ch1.neg_calc = 0;
-            turn_channel_off(gb, 1);
-        }
-        break;
-    case NR13:
-    case NR23:
-    case NR32:
-    case NR33:
-    case NR43:
-    case NR50:
-    case NR51:
-        if (!is_apu_on(gb))
-            return;
-        break;
+void apu_write_nr30(struct gb_core *gb, uint16_t address, uint8_t val)
+{
+    if (!is_apu_on(gb))
+        return;
+    if (!(val & 0x80))
+        turn_channel_off(gb, 3);
+    io_write(gb->memory.io, address, val);
+}
 
-    case NR14:
-    case NR24:
-    case NR34:
-    case NR44:
-        if (!is_apu_on(gb))
-            return;
+void apu_write_nr10(struct gb_core *gb, uint16_t address, uint8_t val)
+{
+    if (!is_apu_on(gb))
+        return;
+    /* Clearing dir bit when it was previously set may disable channel */
+    if (SWEEP_DIR(gb->memory.io[IO_OFFSET(address)]) && !(val & 0x08) && gb->apu.ch1.neg_calc)
+    {
+        gb->apu.ch1.neg_calc = 0;
+        turn_channel_off(gb, 1);
+    }
+    io_write(gb->memory.io, address, val);
+}
 
-        uint8_t ch_number = ((address - NR14) / (NR24 - NR14)) + 1;
-        uint8_t prev_val = gb->memory.io[IO_OFFSET(address)];
+void apu_write_powered(struct gb_core *gb, uint16_t address, uint8_t val)
+{
+    if (is_apu_on(gb))
         io_write(gb->memory.io, address, val);
+}
 
-        /* Extra length clocking on rising edge of length enable bit
-         * This is done before the trigger handling to allow triggering reloading the timer after the extra clock */
-        if (gb->apu.fs_pos % 2 == 1 && val & NRx4_LENGTH_ENABLE && !(prev_val & NRx4_LENGTH_ENABLE))
-            length_clock(gb, ch_number);
+void apu_write_nrx4(struct gb_core *gb, uint16_t address, uint8_t val)
+{
+    if (!is_apu_on(gb))
+        return;
 
-        /* Trigger event */
-        if (val & NRx4_TRIGGER_MASK)
-        {
-            static void (*trigger_handlers[])(struct gb_core *) = {
-                handle_trigger_event_ch1,
-                handle_trigger_event_ch2,
-                handle_trigger_event_ch3,
-                handle_trigger_event_ch4,
-            };
-
-            trigger_handlers[ch_number - 1](gb);
-        }
+    uint8_t ch_number = ((address - NR14) / (NR24 - NR14)) + 1;
+    uint8_t prev_val = gb->memory.io[IO_OFFSET(address)];
+    io_write(gb->memory.io, address, val);
 
-        return;
+    /* Extra length clocking on rising edge of length enable bit
+     * This is done before the trigger handling to allow triggering reloading the timer after the extra clock */
+    if (gb->apu.fs_pos % 2 == 1 && val & NRx4_LENGTH_ENABLE && !(prev_val & NRx4_LENGTH_ENABLE))
+        length_clock(gb, ch_number);
 
-    case NR52:
-        /* Turns APU off */
-        if (!(val >> 7))
-        {
-            apu_turn_off(gb);
-            return;
-        }
-        /* Turns APU on (does nothing if already on) */
-        if (!(gb->memory.io[IO_OFFSET(address)] >> 7) && val >> 7)
-        {
-            gb->apu.fs_pos = 0;
-            gb->apu.ch1.duty_pos = 0;
-            gb->apu.ch2.duty_pos = 0;
-            gb->apu.ch3.sample_buffer = 0;
-        }
-        break;
+    /* Trigger event */
+    if (val & NRx4_TRIGGER_MASK)
+    {
+        static void (*trigger_handlers[])(struct gb_core *) = {
+            handle_trigger_event_ch1,
+            handle_trigger_event_ch2,
+            handle_trigger_event_ch3,
+            handle_trigger_event_ch4,
+        };
+
+        trigger_handlers[ch_number - 1](gb);
     }
+}
 
+void apu_write_nr52(struct gb_core *gb, uint16_t address, uint8_t val)
+{
+    /* Turns APU off */
+    if (!(val >> 7))
+    {
+        apu_turn_off(gb);
+        return;
+    }
+    /* Turns APU on (does nothing if already on) */
+    if (!(gb->memory.io[IO_OFFSET(address)] >> 7))
+    {
+        gb->apu.fs_pos = 0;
+        gb->apu.ch1.duty_pos = 0;
+        gb->apu.ch2.duty_pos = 0;
+        gb->apu.ch3.sample_buffer = 0;
+    }
     io_write(gb->memory.io, address, val);
 }
 
+/* Wave RAM address the CPU actually accesses, -1 if it can't access it */
+static int wave_ram_address(struct gb_core *gb, uint16_t address)
+{
+    /* Attempting to access wave RAM while channel 3 is active */
+    if (!is_channel_on(gb, 3))
+        return address;
+    /* CPU can only access the Wave RAM when CH3 is also accessing it */
+    if (gb->apu.ch3.frequency_timer >= 4 || gb->apu.ch3.phantom_sample)
+        return -1;
+    /* CPU can only access the same byte that CH3 is acessing (CH3 has priority over CPU) */
+    return WAVE_RAM + (gb->apu.ch3.wave_pos % 32) / 2;
+}
+
+uint8_t apu_read_wave_ram(struct gb_core *gb, uint16_t address)
+{
+    int accessed = wave_ram_address(gb, address);
+    if (accessed < 0)
+        return 0xFF;
+    return gb->memory.io[IO_OFFSET(accessed)];
+}
+
+void apu_write_wave_ram(struct gb_core *gb, uint16_t address, uint8_t val)
+{
+    int accessed = wave_ram_address(gb, address);
+    if (accessed >= 0)
+        gb->memory.io[IO_OFFSET(accessed)] = val;
+}
+
 void apu_serialize(FILE *stream, struct apu *apu)
 {
     fwrite_le_32(stream, apu->ch1.trigger_request);
@@ -32,12 +32,14 @@ void cpu_set_registers_post_boot(struct cpu *cpu, int checksum)
     cpu->sp = 0xFFFE;
 
     cpu->ime = 0;
+    cpu->mc_program = MC_NONE;
 }
 
 void cpu_serialize(FILE *stream, struct cpu *cpu)
 {
     fwrite(&cpu->a, sizeof(uint8_t), 1, stream);
-    fwrite(&cpu->f, sizeof(uint8_t), 1, stream);
+    uint8_t f = get_f(cpu);
+    fwrite(&f, sizeof(uint8_t), 1, stream);
     fwrite(&cpu->b, sizeof(uint8_t), 1, stream);
     fwrite(&cpu->c, sizeof(uint8_t), 1, stream);
     fwrite(&cpu->d, sizeof(uint8_t), 1, stream);
@@ -55,6 +57,7 @@ void cpu_load_from_stream(FILE *stream, struct cpu *cpu)
 {
     fread(&cpu->a, sizeof(uint8_t), 1, stream);
     fread(&cpu->f, sizeof(uint8_t), 1, stream);
+    cpu->flags_kind = FLAGS_MATERIALISED;
     fread(&cpu->b, sizeof(uint8_t), 1, stream);
     fread(&cpu->c, sizeof(uint8_t), 1, stream);
     fread(&cpu->d, sizeof(uint8_t), 1, stream);
@@ -0,0 +1,56 @@
+#include "decode_cache.h"
+
+#include <string.h>
+
+#include "disassembler.h"
+#include "gb_core.h"
+#include "mbc_base.h"
+#include "opcode_table.h"
+#include "superop.h"
+
+void decode_cache_init(struct decode_cache *cache)
+{
+    cache->current = NULL;
+    cache->current_pc = 0;
+    cache->rom_base[0] = 0;
+    cache->rom_base[1] = 0;
+    memset(cache->entries, 0, sizeof(cache->entries));
+}
+
+void decode_cache_flush(struct gb_core *gb)
+{
+    memset(gb->decode_cache.entries, 0, sizeof(gb->decode_cache.entries));
+    gb->decode_cache.current = NULL;
+    decode_cache_update_banks(gb);
+}
+
+void decode_cache_update_banks(struct gb_core *gb)
+{
+    if (!gb->mbc)
+        return;
+    gb->decode_cache.rom_base[0] = mbc_rom_offset(gb->mbc, 0x0000) & ~0x3FFF;
+    gb->decode_cache.rom_base[1] = mbc_rom_offset(gb->mbc, 0x4000) & ~0x3FFF;
+}
+
+const struct decoded_instr *decode_cache_fill(struct gb_core *gb, struct decoded_instr *entry, uint16_t address,
+                                              uint32_t tag)
+{
+#define OPCODE_LENGTH(OPCODE, MNEMONIC, LENGTH, HANDLER) [OPCODE] = LENGTH,
+    static const uint8_t lengths[256] = {SM83_OPCODE_TABLE(OPCODE_LENGTH)};
+#undef OPCODE_LENGTH
+
+    uint8_t opcode = read_mbc_rom(gb->mbc, address);
+    uint8_t length = lengths[opcode];
+
+    /* The operands of an instruction crossing a bank boundary are not in the same bank, don't cache it */
+    if ((address & 0x3FFF) + length > 0x4000)
+        return NULL;
+
+    entry->handler = opcode_handlers[opcode];
+    entry->tag = tag;
+    entry->length = length;
+    for (uint8_t i = 0; i < length; ++i)
+        entry->bytes[i] = read_mbc_rom(gb->mbc, address + i);
+    entry->superop = superop_match(gb, address);
+    return entry;
+}
@@ -2,10 +2,12 @@
 
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "common.h"
 #include "emulation.h"
 #include "gb_core.h"
+#include "pixel_kernels.h"
 #include "sync.h"
 
 struct pixel_data
@@ -14,6 +16,9 @@ struct pixel_data
     struct color values;
 };
 
+/* Written as 32 bits pixels by the pixel kernels */
+_Static_assert(sizeof(struct pixel_data) == sizeof(uint32_t), "Frame buffer pixels must be 32 bits");
+
 #define DEFAULT_PALETTE {224, 248, 208}, {136, 192, 112}, {52, 104, 86}, {8, 24, 32}, {229, 245, 218},
 
 static const struct color default_palette[5] = {DEFAULT_PALETTE};
@@ -27,15 +32,24 @@ void *get_frame_buffer(void)
     return frame_buffer;
 }
 
-void draw_pixel(struct gb_core *gb, struct pixel p)
+void draw_line(struct gb_core *gb, const uint8_t *bg, const uint8_t *obj, unsigned int from, unsigned int to)
 {
-    unsigned int palette_address = p.obj > -1 ? (p.palette ? OBP1 : OBP0) : BGP;
-    unsigned int color_index = (gb->memory.io[IO_OFFSET(palette_address)] >> (p.color * 2)) & 0x03;
+    /* Frame buffer pixels of the palette entries, see pixel_kernels.h */
+    static const unsigned int palettes[4] = {BGP, OBP0, BGP, OBP1};
+    uint32_t lut[16];
+    for (unsigned int entry = 0; entry < 16; ++entry)
+    {
+        unsigned int color_index = (gb->memory.io[IO_OFFSET(palettes[entry / 4])] >> ((entry % 4) * 2)) & 0x03;
+        struct pixel_data p = {.values = color_palette[color_index]};
+        memcpy(&lut[entry], &p, sizeof(uint32_t));
+    }
 
-    frame_buffer[gb->memory.io[IO_OFFSET(LY)] * SCREEN_WIDTH + (gb->ppu.lx - 8)].values = color_palette[color_index];
+    uint8_t ly = gb->memory.io[IO_OFFSET(LY)];
+    pixel_kernels->compose_line(
+        bg + from, obj + from, gb->memory.io[IO_OFFSET(LCDC)], lut, frame_buffer + ly * SCREEN_WIDTH + from, to - from);
 
     /*  A whole frame is ready, render it, handle inputs, synchronize */
-    if (gb->memory.io[IO_OFFSET(LY)] == SCREEN_HEIGHT - 1 && gb->ppu.lx == SCREEN_WIDTH + 7)
+    if (ly == SCREEN_HEIGHT - 1 && to == SCREEN_WIDTH)
         gb->callbacks.frame_ready();
 }
 
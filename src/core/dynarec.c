@@ -0,0 +1,599 @@
+#define _DEFAULT_SOURCE
+
+#include "dynarec.h"
+
+#include "gb_core.h"
+
+#if defined(__x86_64__) && (defined(_LINUX) || defined(_MACOS))
+
+#include <limits.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include "common.h"
+#include "emulation.h"
+#include "logger.h"
+#include "mbc_base.h"
+#include "opcode_table.h"
+#include "read.h"
+#include "utils.h"
+
+#define DYNAREC_CODE_SIZE (1024 * 1024)
+#define DYNAREC_BLOCKS 0x1000
+#define DYNAREC_BLOCKS_MASK (DYNAREC_BLOCKS - 1)
+
+/* The block sizes and threshold may be overridden at build time, the SM83 tests compile every single instruction */
+#ifndef DYNAREC_HOT_THRESHOLD
+#define DYNAREC_HOT_THRESHOLD 16
+#endif
+#define DYNAREC_NOT_COMPILABLE UINT16_MAX
+
+/* Single instructions are faster through the interpreter */
+#ifndef DYNAREC_MIN_INSTRUCTIONS
+#define DYNAREC_MIN_INSTRUCTIONS 2
+#endif
+
+/* Largest block and worst case size of a compiled instruction, including its budget check */
+#ifndef DYNAREC_MAX_INSTRUCTIONS
+#define DYNAREC_MAX_INSTRUCTIONS 64
+#endif
+#define DYNAREC_MAX_INSTRUCTION_SIZE 160
+
+/* budget is the number of MCycles the block may run, see dynarec_run() */
+typedef int (*block_fn)(struct gb_core *gb, int budget);
+
+struct dynarec_block
+{
+    uint32_t tag; /* ROM offset of the block entry + 1, same tagging as the decode cache */
+    uint16_t hits;
+    uint8_t *code;
+};
+
+struct dynarec
+{
+    struct dynarec_block blocks[DYNAREC_BLOCKS];
+    uint8_t *code;
+    size_t code_used;
+};
+
+struct emitter
+{
+    uint8_t *code;
+    size_t size;
+};
+
+/* Offsets of the guest state from the gb_core pointer held in rbx */
+#define GB_OFFSET(MEMBER) ((int32_t)offsetof(struct gb_core, MEMBER))
+
+/* SM83 register encoding order, index 6 is (HL) and is never compiled */
+static const int32_t r8_offsets[8] = {
+    GB_OFFSET(cpu.b), GB_OFFSET(cpu.c), GB_OFFSET(cpu.d), GB_OFFSET(cpu.e),
+    GB_OFFSET(cpu.h), GB_OFFSET(cpu.l), -1,               GB_OFFSET(cpu.a),
+};
+
+/* Register pairs hi/lo encoding order, SP is stored as a 16 bits word */
+static const int32_t rr_hi_offsets[3] = {GB_OFFSET(cpu.b), GB_OFFSET(cpu.d), GB_OFFSET(cpu.h)};
+static const int32_t rr_lo_offsets[3] = {GB_OFFSET(cpu.c), GB_OFFSET(cpu.e), GB_OFFSET(cpu.l)};
+
+/* x86 encodings of the SM83 ALU operations: add, adc, sub, sbc, and, xor, or, cp */
+static const uint8_t alu_mem_opcodes[8] = {0x02, 0x12, 0x2A, 0x1A, 0x22, 0x32, 0x0A, 0x3A};
+static const uint8_t alu_imm_opcodes[8] = {0x04, 0x14, 0x2C, 0x1C, 0x24, 0x34, 0x0C, 0x3C};
+
+enum alu_operation
+{
+    ALU_ADD = 0,
+    ALU_ADC,
+    ALU_SUB,
+    ALU_SBC,
+    ALU_AND,
+    ALU_XOR,
+    ALU_OR,
+    ALU_CP,
+};
+
+/* x86 registers */
+#define EAX 0
+#define ECX 1
+#define EDX 2
+
+static void emit8(struct emitter *e, uint8_t value)
+{
+    e->code[e->size++] = value;
+}
+
+static void emit16(struct emitter *e, uint16_t value)
+{
+    emit8(e, value & 0xFF);
+    emit8(e, value >> 8);
+}
+
+static void emit32(struct emitter *e, uint32_t value)
+{
+    for (size_t i = 0; i < 4; ++i)
+        emit8(e, (value >> (i * 8)) & 0xFF);
+}
+
+/* ModRM for [rbx + disp32] */
+static void emit_mem(struct emitter *e, uint8_t reg, int32_t offset)
+{
+    emit8(e, 0x80 | (reg << 3) | 0x03);
+    emit32(e, (uint32_t)offset);
+}
+
+/* movzx reg, byte [rbx + offset] */
+static void emit_load8(struct emitter *e, uint8_t reg, int32_t offset)
+{
+    emit8(e, 0x0F);
+    emit8(e, 0xB6);
+    emit_mem(e, reg, offset);
+}
+
+/* mov byte [rbx + offset], reg8 */
+static void emit_store8(struct emitter *e, uint8_t reg, int32_t offset)
+{
+    emit8(e, 0x88);
+    emit_mem(e, reg, offset);
+}
+
+/* mov byte [rbx + offset], imm8 */
+static void emit_store_imm8(struct emitter *e, int32_t offset, uint8_t value)
+{
+    emit8(e, 0xC6);
+    emit_mem(e, 0, offset);
+    emit8(e, value);
+}
+
+/* mov word [rbx + offset], imm16 */
+static void emit_store_imm16(struct emitter *e, int32_t offset, uint16_t value)
+{
+    emit8(e, 0x66);
+    emit8(e, 0xC7);
+    emit_mem(e, 0, offset);
+    emit16(e, value);
+}
+
+/* Store PC, return the MCycles elapsed since the block entry */
+static void emit_exit(struct emitter *e, uint16_t pc, int mcycles)
+{
+    emit_store_imm16(e, GB_OFFSET(cpu.pc), pc);
+    emit8(e, 0xB8); /* mov eax, mcycles */
+    emit32(e, mcycles);
+    emit8(e, 0x5B); /* pop rbx */
+    emit8(e, 0xC3); /* ret */
+}
+
+/*
+ * Leave the block before the instruction at pc if it would end past the budget in esi. Returns the offset of the
+ * MCycles count to patch once the instruction is emitted.
+ */
+static size_t emit_budget_check(struct emitter *e, uint16_t pc, int mcycles)
+{
+    emit8(e, 0x81); /* cmp esi, mcycles at the end of the instruction */
+    emit8(e, 0xFE);
+    size_t end_mcycles = e->size;
+    emit32(e, 0);
+    emit8(e, 0x7D); /* jge next instruction */
+    size_t budget_jump = e->size;
+    emit8(e, 0);
+    emit_exit(e, pc, mcycles);
+    e->code[budget_jump] = e->size - budget_jump - 1;
+    return end_mcycles;
+}
+
+/*
+ * Build F from the host flags in rcx (after pushfq; pop rcx): ZF is bit 6, AF bit 4 and CF bit 0, which match Z, H
+ * and C for the 8 bits additions and subtractions. keep_c leaves the SM83 carry untouched (INC/DEC).
+ */
+static void emit_arith_flags(struct emitter *e, uint8_t n, uint8_t keep_c)
+{
+    emit8(e, 0x89); /* mov eax, ecx */
+    emit8(e, 0xC8);
+    emit8(e, 0x83); /* and eax, 0x10 */
+    emit8(e, 0xE0);
+    emit8(e, 0x10);
+    emit8(e, 0xD1); /* shl eax, 1 */
+    emit8(e, 0xE0);
+    emit8(e, 0x89); /* mov edx, ecx */
+    emit8(e, 0xCA);
+    emit8(e, 0x83); /* and edx, 0x40 */
+    emit8(e, 0xE2);
+    emit8(e, 0x40);
+    emit8(e, 0xD1); /* shl edx, 1 */
+    emit8(e, 0xE2);
+    emit8(e, 0x09); /* or edx, eax */
+    emit8(e, 0xC2);
+    if (keep_c)
+    {
+        emit_load8(e, ECX, GB_OFFSET(cpu.f));
+        emit8(e, 0x83); /* and ecx, 0x10 */
+        emit8(e, 0xE1);
+        emit8(e, 0x10);
+    }
+    else
+    {
+        emit8(e, 0x83); /* and ecx, 1 */
+        emit8(e, 0xE1);
+        emit8(e, 0x01);
+        emit8(e, 0xC1); /* shl ecx, 4 */
+        emit8(e, 0xE1);
+        emit8(e, 0x04);
+    }
+    emit8(e, 0x09); /* or edx, ecx */
+    emit8(e, 0xCA);
+    if (n)
+    {
+        emit8(e, 0x83); /* or edx, 0x40 */
+        emit8(e, 0xCA);
+        emit8(e, 0x40);
+    }
+    emit_store8(e, EDX, GB_OFFSET(cpu.f));
+}
+
+static void emit_save_host_flags(struct emitter *e)
+{
+    emit8(e, 0x9C); /* pushfq */
+    emit8(e, 0x59); /* pop rcx */
+}
+
+/* A = A op operand, operand being a register offset or an immediate when offset < 0 */
+static void emit_alu(struct emitter *e, enum alu_operation op, int32_t offset, uint8_t imm)
+{
+    emit_load8(e, EAX, GB_OFFSET(cpu.a));
+    if (op == ALU_ADC || op == ALU_SBC)
+    {
+        emit_load8(e, ECX, GB_OFFSET(cpu.f));
+        emit8(e, 0xC1); /* shr ecx, 5: CF = SM83 carry */
+        emit8(e, 0xE9);
+        emit8(e, 0x05);
+    }
+
+    if (offset < 0)
+    {
+        emit8(e, alu_imm_opcodes[op]);
+        emit8(e, imm);
+    }
+    else
+    {
+        emit8(e, alu_mem_opcodes[op]);
+        emit_mem(e, EAX, offset);
+    }
+
+    if (op >= ALU_AND && op <= ALU_OR)
+    {
+        emit8(e, 0x0F); /* setz dl */
+        emit8(e, 0x94);
+        emit8(e, 0xC2);
+        emit_store8(e, EAX, GB_OFFSET(cpu.a));
+        emit8(e, 0xC0); /* shl dl, 7 */
+        emit8(e, 0xE2);
+        emit8(e, 0x07);
+        if (op == ALU_AND)
+        {
+            emit8(e, 0x80); /* or dl, 0x20 */
+            emit8(e, 0xCA);
+            emit8(e, 0x20);
+        }
+        emit_store8(e, EDX, GB_OFFSET(cpu.f));
+        return;
+    }
+
+    emit_save_host_flags(e);
+    if (op != ALU_CP)
+        emit_store8(e, EAX, GB_OFFSET(cpu.a));
+    emit_arith_flags(e, op == ALU_SUB || op == ALU_SBC || op == ALU_CP, 0);
+}
+
+/* Emit the instruction in bytes, returns its duration in MCycles or 0 if it must be left to the interpreter */
+static int emit_instruction(struct emitter *e, const uint8_t *bytes)
+{
+    uint8_t opcode = bytes[0];
+    uint8_t x = opcode >> 6;
+    uint8_t y = (opcode >> 3) & 0x07;
+    uint8_t z = opcode & 0x07;
+
+    if (x == 1)
+    {
+        /* LD r,r' */
+        if (y == 6 || z == 6)
+            return 0;
+        if (y != z)
+        {
+            emit_load8(e, EAX, r8_offsets[z]);
+            emit_store8(e, EAX, r8_offsets[y]);
+        }
+        return 1;
+    }
+
+    if (x == 2)
+    {
+        /* ALU A,r */
+        if (z == 6)
+            return 0;
+        emit_alu(e, y, r8_offsets[z], 0);
+        return 1;
+    }
+
+    if (x == 3)
+    {
+        /* ALU A,u8 */
+        if (z != 6)
+            return 0;
+        emit_alu(e, y, -1, bytes[1]);
+        return 2;
+    }
+
+    switch (z)
+    {
+    case 0:
+        /* NOP, the other x = 0 and z = 0 opcodes are STOP and jumps */
+        return opcode == 0x00;
+    case 1:
+        /* LD rr,u16 */
+        if (y & 1)
+            return 0;
+        if (y >> 1 == 3)
+            emit_store_imm16(e, GB_OFFSET(cpu.sp), bytes[1] | (bytes[2] << 8));
+        else
+        {
+            emit_store_imm8(e, rr_lo_offsets[y >> 1], bytes[1]);
+            emit_store_imm8(e, rr_hi_offsets[y >> 1], bytes[2]);
+        }
+        return 3;
+    case 3:
+        /* INC rr / DEC rr */
+        if (y >> 1 == 3)
+        {
+            emit8(e, 0x66); /* inc/dec word [SP] */
+            emit8(e, 0xFF);
+            emit_mem(e, y & 1, GB_OFFSET(cpu.sp));
+        }
+        else
+        {
+            emit8(e, 0x80); /* add/sub byte [lo], 1 */
+            emit_mem(e, (y & 1) ? 5 : 0, rr_lo_offsets[y >> 1]);
+            emit8(e, 0x01);
+            emit8(e, 0x73); /* jnc over the upper byte carry */
+            emit8(e, 7);
+            emit8(e, 0x80); /* add/sub byte [hi], 1 */
+            emit_mem(e, (y & 1) ? 5 : 0, rr_hi_offsets[y >> 1]);
+            emit8(e, 0x01);
+        }
+        return 2;
+    case 4:
+    case 5:
+        /* INC r / DEC r */
+        if (y == 6)
+            return 0;
+        emit8(e, 0xFE);
+        emit_mem(e, z == 5, r8_offsets[y]);
+        emit_save_host_flags(e);
+        emit_arith_flags(e, z == 5, 1);
+        return 1;
+    case 6:
+        /* LD r,u8 */
+        if (y == 6)
+            return 0;
+        emit_store_imm8(e, r8_offsets[y], bytes[1]);
+        return 2;
+    case 7:
+        break;
+    default:
+        return 0;
+    }
+
+    switch (opcode)
+    {
+    case 0x2F: /* CPL */
+        emit8(e, 0xF6); /* not byte [A] */
+        emit_mem(e, 2, GB_OFFSET(cpu.a));
+        emit8(e, 0x80); /* or byte [F], 0x60 */
+        emit_mem(e, 1, GB_OFFSET(cpu.f));
+        emit8(e, 0x60);
+        return 1;
+    case 0x37: /* SCF */
+        emit8(e, 0x80); /* and byte [F], 0x80 */
+        emit_mem(e, 4, GB_OFFSET(cpu.f));
+        emit8(e, 0x80);
+        emit8(e, 0x80); /* or byte [F], 0x10 */
+        emit_mem(e, 1, GB_OFFSET(cpu.f));
+        emit8(e, 0x10);
+        return 1;
+    case 0x3F: /* CCF */
+        emit8(e, 0x80); /* and byte [F], 0x90 */
+        emit_mem(e, 4, GB_OFFSET(cpu.f));
+        emit8(e, 0x90);
+        emit8(e, 0x80); /* xor byte [F], 0x10 */
+        emit_mem(e, 6, GB_OFFSET(cpu.f));
+        emit8(e, 0x10);
+        return 1;
+    default:
+        return 0;
+    }
+}
+
+/* The code buffer is either writable or executable, never both */
+static int set_code_protection(struct dynarec *jit, int prot)
+{
+    if (mprotect(jit->code, DYNAREC_CODE_SIZE, prot))
+    {
+        LOG_ERROR("Couldn't change the protection of the dynamic recompiler code");
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+static uint8_t *compile_block(struct gb_core *gb, struct dynarec *jit, uint16_t pc)
+{
+#define OPCODE_LENGTH(OPCODE, MNEMONIC, LENGTH, HANDLER) [OPCODE] = LENGTH,
+    static const uint8_t lengths[256] = {SM83_OPCODE_TABLE(OPCODE_LENGTH)};
+#undef OPCODE_LENGTH
+
+    if (jit->code_used + DYNAREC_MAX_INSTRUCTIONS * DYNAREC_MAX_INSTRUCTION_SIZE + 32 > DYNAREC_CODE_SIZE)
+        dynarec_flush(gb);
+    if (set_code_protection(jit, PROT_READ | PROT_WRITE))
+        return NULL;
+
+    struct emitter e = {.code = jit->code + jit->code_used, .size = 0};
+    emit8(&e, 0x53); /* push rbx */
+    emit8(&e, 0x48); /* mov rbx, rdi */
+    emit8(&e, 0x89);
+    emit8(&e, 0xFB);
+
+    uint16_t address = pc;
+    int mcycles = 0;
+    size_t count = 0;
+    for (; count < DYNAREC_MAX_INSTRUCTIONS; ++count)
+    {
+        uint8_t bytes[3] = {0};
+        bytes[0] = read_mbc_rom(gb->mbc, address);
+        uint8_t length = lengths[bytes[0]];
+
+        /* Blocks never leave the ROM bank they started in */
+        if ((address & 0x3FFF) + length > 0x4000 || (address >> 14) != (pc >> 14))
+            break;
+        for (uint8_t i = 1; i < length; ++i)
+            bytes[i] = read_mbc_rom(gb->mbc, address + i);
+
+        size_t start = e.size;
+        size_t end_mcycles = emit_budget_check(&e, address, mcycles);
+        int instruction_mcycles = emit_instruction(&e, bytes);
+        if (!instruction_mcycles)
+        {
+            e.size = start;
+            break;
+        }
+
+        address += length;
+        mcycles += instruction_mcycles;
+        for (size_t i = 0; i < 4; ++i)
+            e.code[end_mcycles + i] = (mcycles >> (i * 8)) & 0xFF;
+    }
+
+    uint8_t *code = NULL;
+    if (count >= DYNAREC_MIN_INSTRUCTIONS)
+    {
+        emit_exit(&e, address, mcycles);
+        code = jit->code + jit->code_used;
+        jit->code_used += (e.size + 15) & ~(size_t)15;
+    }
+
+    if (set_code_protection(jit, PROT_READ | PROT_EXEC))
+    {
+        /* Nothing compiled so far can be run anymore */
+        dynarec_flush(gb);
+        get_global_settings()->dynarec = false;
+        return NULL;
+    }
+    return code;
+}
+
+static struct dynarec *dynarec_init(void)
+{
+    struct dynarec *jit = calloc(1, sizeof(struct dynarec));
+    if (!jit)
+        return NULL;
+
+    jit->code = mmap(NULL, DYNAREC_CODE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (jit->code == MAP_FAILED)
+    {
+        LOG_ERROR("Couldn't allocate memory for the dynamic recompiler");
+        free(jit);
+        return NULL;
+    }
+    return jit;
+}
+
+int dynarec_run(struct gb_core *gb)
+{
+    uint16_t pc = gb->cpu.pc;
+    if (pc >= 0x8000 || gb->halt_bug || is_boot_rom_mapped(gb, pc) || is_dma_bus_conflict(gb, pc))
+        return 0;
+
+    /* Blocks rely on IME and the pending interrupts staying the same from their entry to their exit */
+    if (gb->cpu.ime > 1 || (gb->cpu.ime == 1 && gb->pending_interrupts))
+        return 0;
+
+    /* Nothing may run in the background before the last MCycle of a block */
+    if (gb->scheduler.next <= gb->scheduler.now)
+        return 0;
+    uint64_t budget = (gb->scheduler.next - gb->scheduler.now + 3) / 4;
+
+    if (!gb->dynarec && !(gb->dynarec = dynarec_init()))
+    {
+        get_global_settings()->dynarec = false;
+        return 0;
+    }
+
+    struct dynarec *jit = gb->dynarec;
+    uint32_t tag = (gb->decode_cache.rom_base[pc >> 14] | (pc & 0x3FFF)) + 1;
+    struct dynarec_block *block = &jit->blocks[pc & DYNAREC_BLOCKS_MASK];
+    if (block->tag != tag)
+    {
+        block->tag = tag;
+        block->hits = 0;
+        block->code = NULL;
+    }
+
+    if (!block->code)
+    {
+        if (block->hits == DYNAREC_NOT_COMPILABLE || ++block->hits < DYNAREC_HOT_THRESHOLD)
+            return 0;
+        if (!(block->code = compile_block(gb, jit, pc)))
+        {
+            block->hits = DYNAREC_NOT_COMPILABLE;
+            return 0;
+        }
+    }
+
+    union
+    {
+        uint8_t *code;
+        block_fn fn;
+    } entry = {.code = block->code};
+    // Compiled blocks work on the F register directly
+    flags_materialise(&gb->cpu);
+    int mcycles = entry.fn(gb, budget < INT_MAX ? (int)budget : INT_MAX);
+    if (mcycles)
+        tick_mcycles(gb, mcycles);
+    return mcycles;
+}
+
+void dynarec_flush(struct gb_core *gb)
+{
+    if (!gb->dynarec)
+        return;
+    memset(gb->dynarec->blocks, 0, sizeof(gb->dynarec->blocks));
+    gb->dynarec->code_used = 0;
+}
+
+void dynarec_free(struct gb_core *gb)
+{
+    if (!gb->dynarec)
+        return;
+    munmap(gb->dynarec->code, DYNAREC_CODE_SIZE);
+    free(gb->dynarec);
+    gb->dynarec = NULL;
+}
+
+#else
+
+int dynarec_run(struct gb_core *gb)
+{
+    (void)gb;
+    return 0;
+}
+
+void dynarec_flush(struct gb_core *gb)
+{
+    (void)gb;
+}
+
+void dynarec_free(struct gb_core *gb)
+{
+    (void)gb;
+}
+
+#endif
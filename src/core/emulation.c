@@ -7,9 +7,16 @@
 #include <sys/stat.h>
 
 #include "common.h"
+#include "decode_cache.h"
 #include "display.h"
+#include "dynarec.h"
+#include "idle_loop.h"
 #include "logger.h"
 #include "mbc_base.h"
+#include "page_table.h"
+#include "ppu.h"
+#include "rom_image.h"
+#include "scheduler.h"
 #include "serial.h"
 #include "sync.h"
 #include "timers.h"
@@ -18,6 +25,8 @@ struct global_settings settings = {
     .audio_volume = 1.0f,
     .render_period_ns = 1e9 / 165,
     .apu_channels_enable = {true, true, true, true},
+    .idle_loop_detection = true,
+    .superinstructions = true,
 };
 
 struct global_settings *get_global_settings(void)
@@ -30,33 +39,30 @@ struct global_settings *get_global_settings(void)
 void reset_gb(struct gb_core *gb)
 {
     memset(gb->memory.vram, 0, VRAM_SIZE * sizeof(uint8_t));
+    tile_cache_invalidate_all(&gb->tile_cache);
     memset(gb->memory.wram, 0, WRAM_SIZE * sizeof(uint8_t));
     memset(gb->memory.oam, 0, OAM_SIZE * sizeof(uint8_t));
+    obj_lines_invalidate_all(&gb->obj_lines);
     memset(gb->memory.unusable_mem, 0, NOT_USABLE_SIZE * sizeof(uint8_t));
     memset(gb->memory.io, 0, IO_SIZE * sizeof(uint8_t));
     memset(gb->memory.hram, 0, HRAM_SIZE * sizeof(uint8_t));
 
     ppu_init(gb);
-    apu_init(&gb->apu);
+    apu_init(gb);
     mbc_reset(gb->mbc);
+    decode_cache_update_banks(gb);
+    idle_loop_flush(gb);
 
     gb->halt = 0;
     gb->halt_bug = 0;
     gb->stop = 0;
 
-    gb->internal_div = -24;
-    gb->prev_tac_AND = 0;
-
-    gb->prev_serial_AND = 0;
-
-    gb->serial_clock = -24;
-    gb->serial_acc = 0;
+    timer_init(gb);
+    serial_init(gb);
 
     gb->joyp_a = 0xF;
     gb->joyp_d = 0xF;
 
-    gb->schedule_tima_overflow = 0;
-
     gb->tcycles_since_sync = 0;
     gb->last_sync_timestamp = get_nanoseconds();
 
@@ -122,7 +128,7 @@ static int load_boot_rom(struct gb_core *gb, char *boot_rom_path)
         goto exit;
     }
 
-    if (fsize > (uint32_t)-1)
+    if (fsize > BOOT_ROM_MAX_SIZE)
     {
         LOG_ERROR("Could not load BOOT ROM, file is too big: %s", boot_rom_path);
         err_code = EXIT_FAILURE;
@@ -130,13 +136,6 @@ static int load_boot_rom(struct gb_core *gb, char *boot_rom_path)
     }
 
     gb->memory.boot_rom_size = fsize;
-    if (!(gb->memory.boot_rom = malloc(sizeof(uint8_t) * fsize)))
-    {
-        LOG_ERROR("Could not load BOOT ROM, error allocating memory");
-        err_code = EXIT_FAILURE;
-        goto exit;
-    }
-
     fread(gb->memory.boot_rom, 1, fsize, fptr);
     if (ferror(fptr))
     {
@@ -155,7 +154,6 @@ int load_rom(struct gb_core *gb, char *rom_path, char *boot_rom_path)
     assert(gb && rom_path);
 
     int err_code = EXIT_SUCCESS;
-    FILE *fptr = NULL;
     uint8_t *rom = NULL;
 
     if (boot_rom_path && load_boot_rom(gb, boot_rom_path))
@@ -171,61 +169,34 @@ int load_rom(struct gb_core *gb, char *rom_path, char *boot_rom_path)
         goto exit;
     }
 
-    fptr = fopen(rom_path, "rb");
-    if (!fptr)
-    {
-        LOG_ERROR("No such file: %s", rom_path);
-        err_code = EXIT_FAILURE;
-        goto exit;
-    }
-
-    /* Get total size of file */
-    if (fseek(fptr, 0, SEEK_END))
-    {
-        LOG_ERROR("Error reading file: %s", rom_path);
-        err_code = EXIT_FAILURE;
-        goto exit;
-    }
-    long fsize = 0;
-    if ((fsize = ftell(fptr)) == -1)
+    /* Init MBC / cartridge info, the ROM image is shared with other cores running the same ROM */
+    if (!(rom = rom_image_acquire(rom_path)))
     {
-        LOG_ERROR("Error reading file: %s", rom_path);
         err_code = EXIT_FAILURE;
         goto exit;
     }
-    rewind(fptr);
 
-    /* Init MBC / cartridge info and fill rom in buffer */
-    if (!(rom = malloc(sizeof(uint8_t) * fsize)))
+    uint8_t checksum = rom[CHECKSUM_ADDR];
+    if (set_mbc(&gb->mbc, rom, gb->memory.cart_ram, rom_path))
     {
-        LOG_ERROR("Error allocating memory for loading ROM file");
+        rom_image_release(rom);
         err_code = EXIT_FAILURE;
         goto exit;
     }
 
-    fread(rom, 1, fsize, fptr);
-    if (ferror(fptr))
-    {
-        LOG_ERROR("Error loading ROM: %s\n", rom_path);
-        err_code = EXIT_FAILURE;
-        free(rom);
-        goto exit;
-    }
+    decode_cache_flush(gb);
+    dynarec_flush(gb);
+    idle_loop_flush(gb);
 
-    uint8_t checksum = rom[CHECKSUM_ADDR];
-    if (set_mbc(&gb->mbc, rom, rom_path))
-    {
-        err_code = EXIT_FAILURE;
-        goto exit;
-    }
+    /* Per ROM setting, the frontend may override it once the ROM is loaded */
+    gb->ppu.renderer = PPU_RENDERER_DEFAULT;
 
     lcd_off(gb);
     if (!boot_rom_path)
         init_gb_core_post_boot(gb, checksum);
+    page_table_update(gb);
 
 exit:
-    if (fptr)
-        fclose(fptr);
     return err_code;
 }
 
@@ -234,21 +205,46 @@ void tick_m(struct gb_core *gb)
     if (gb->cpu.ime > 1)
         --gb->cpu.ime;
 
-    for (size_t i = 0; i < 4; ++i)
-    {
-        gb->tcycles_since_sync += 1;
+    gb->tcycles_since_sync += 4;
 
-        update_timers(gb);
-        update_serial(gb);
+    /* The PPU, APU, timer, serial port and OAM DMA run in batches when their next event is due */
+    gb->scheduler.now += 4;
+    if (gb->scheduler.now >= gb->scheduler.next)
+        scheduler_run(gb);
+}
 
-        apu_tick(gb);
-        ppu_tick(gb);
-    }
+void tick_mcycles(struct gb_core *gb, int mcycles)
+{
+    if (gb->cpu.ime > 1)
+        gb->cpu.ime = gb->cpu.ime > mcycles ? gb->cpu.ime - mcycles : 1;
+
+    gb->tcycles_since_sync += 4 * mcycles;
 
-    dma_handle(gb);
+    gb->scheduler.now += 4 * mcycles;
+    if (gb->scheduler.now >= gb->scheduler.next)
+        scheduler_run(gb);
+}
 
-    gb->apu.ch1.trigger_request = 0;
-    gb->apu.ch2.trigger_request = 0;
-    gb->apu.ch3.trigger_request = 0;
-    gb->apu.ch4.trigger_request = 0;
+int halt_fast_forward(struct gb_core *gb, int max_mcycles)
+{
+    int mcycles = 0;
+    while (1)
+    {
+        /* Interrupts are only requested by events, jump straight to the MCycle the next one is due in */
+        int step = max_mcycles - mcycles;
+        uint64_t to_event = 1;
+        if (gb->scheduler.next > gb->scheduler.now)
+            to_event = (gb->scheduler.next - gb->scheduler.now + 3) / 4;
+        if (to_event < (uint64_t)step)
+            step = (int)to_event;
+
+        tick_mcycles(gb, step);
+        mcycles += step;
+        if (mcycles >= max_mcycles || gb->pending_interrupts)
+            return mcycles;
+
+        /* Nothing to service yet, only the part of check_interrupt() which does not depend on a pending interrupt */
+        if (gb->cpu.ime == 2)
+            gb->cpu.ime = 1;
+    }
 }
@@ -6,11 +6,24 @@
 #include "apu.h"
 #include "common.h"
 #include "cpu.h"
+#include "decode_cache.h"
+#include "dynarec.h"
+#include "idle_loop.h"
+#include "interrupts.h"
 #include "logger.h"
 #include "mbc_base.h"
+#include "page_table.h"
+#include "pixel_kernels.h"
 #include "ppu.h"
+#include "serial.h"
 #include "serialization.h"
 #include "sync.h"
+#include "timers.h"
+
+/* Save states start with a magic and the version of their layout, which must be bumped whenever the layout changes */
+#define SAVE_STATE_MAGIC "GEMUSAVE"
+#define SAVE_STATE_MAGIC_SIZE 8
+#define SAVE_STATE_VERSION 1
 
 static void init_io_post_boot(struct memory_map *mem)
 {
@@ -77,32 +90,35 @@ void init_gb_core_post_boot(struct gb_core *gb, int checksum)
     cpu_set_registers_post_boot(&gb->cpu, checksum);
     init_io_post_boot(&gb->memory);
 
-    gb->internal_div = 0xABCC;
-    gb->serial_clock = 460;
+    timer_set_div(gb, 0xABCC);
+    serial_set_clock(gb, 460);
 
     gb->ppu.current_mode = 1;
     gb->ppu.line_dot_count = 400;
     gb->ppu.mode1_153th = 1;
+    gb->ppu.sync_time = gb->scheduler.now;
+    scheduler_schedule(gb, SCHED_PPU, gb->scheduler.now + 1);
+
+    update_pending_interrupts(gb);
+    page_table_update(gb);
 }
 
 int init_gb_core(struct gb_core *gb)
 {
     memset(&gb->cpu, 0, sizeof(struct cpu));
+    memset(&gb->idle_loop, 0, sizeof(struct idle_loop));
+    scheduler_init(&gb->scheduler);
+    pixel_kernels_init();
 
     gb->memory.boot_rom_size = 0;
-    gb->memory.boot_rom = NULL;
-    gb->memory.vram = calloc(VRAM_SIZE, sizeof(uint8_t));
-    gb->memory.wram = malloc(WRAM_SIZE * sizeof(uint8_t));
-    gb->memory.unusable_mem = malloc(NOT_USABLE_SIZE * sizeof(uint8_t)); /* TODO: Probably useless */
-
-    if (!gb->memory.vram || !gb->memory.wram || !gb->memory.unusable_mem)
-    {
-        LOG_ERROR("Couldn't allocate necessary memory for emulation");
-        return EXIT_FAILURE;
-    }
+    memset(gb->memory.vram, 0, VRAM_SIZE);
+    tile_cache_invalidate_all(&gb->tile_cache);
+    obj_lines_invalidate_all(&gb->obj_lines);
+    decode_cache_init(&gb->decode_cache);
 
+    page_table_clear(gb);
     ppu_init(gb);
-    apu_init(&gb->apu);
+    apu_init(gb);
 
     /* Init Wave RAM pattern */
     uint8_t wave_data[] = {
@@ -129,36 +145,28 @@ int init_gb_core(struct gb_core *gb)
     gb->halt_bug = 0;
     gb->stop = 0;
 
-    gb->internal_div = -24; /* TODO: investigate why this value works */
-
-    gb->prev_tac_AND = 0;
-    gb->prev_serial_AND = 0;
-
-    gb->serial_clock = -24; /* TODO: investigate why this value works */
-    gb->serial_acc = 0;
+    timer_init(gb);
+    serial_init(gb);
 
     gb->joyp_a = 0xF;
     gb->joyp_d = 0xF;
 
     gb->mbc = NULL;
-
-    gb->schedule_tima_overflow = 0;
+    gb->dynarec = NULL;
 
     gb->tcycles_since_sync = 0;
     gb->last_sync_timestamp = get_nanoseconds();
 
     gb->memory.io[IO_OFFSET(JOYP)] = 0xCF;
+    update_pending_interrupts(gb);
 
     return EXIT_SUCCESS;
 }
 
 void free_gb_core(struct gb_core *gb)
 {
-    free(gb->memory.boot_rom);
-    free(gb->memory.vram);
-    free(gb->memory.wram);
-    free(gb->memory.unusable_mem);
     mbc_free(gb->mbc);
+    dynarec_free(gb);
 }
 
 int gb_core_serialize(char *output_path, struct gb_core *gb)
@@ -167,6 +175,17 @@ int gb_core_serialize(char *output_path, struct gb_core *gb)
     if (!(file = fopen(output_path, "wb")))
         return EXIT_FAILURE;
 
+    ppu_catch_up(gb);
+    dma_catch_up(gb);
+    ppu_render_sync(gb);
+    ppu_oam_scan_sync(gb);
+    apu_catch_up(gb);
+    timer_catch_up(gb);
+    serial_catch_up(gb);
+
+    fwrite(SAVE_STATE_MAGIC, sizeof(char), SAVE_STATE_MAGIC_SIZE, file);
+    fwrite_le_32(file, SAVE_STATE_VERSION);
+
     cpu_serialize(file, &gb->cpu);
     ppu_serialize(file, &gb->ppu);
     apu_serialize(file, &gb->apu);
@@ -183,7 +202,7 @@ int gb_core_serialize(char *output_path, struct gb_core *gb)
     fwrite(gb->memory.hram, sizeof(uint8_t), HRAM_SIZE, file);
     fwrite(&gb->memory.ie, sizeof(uint8_t), 1, file);
 
-    fwrite_le_16(file, gb->internal_div);
+    fwrite_le_16(file, timer_get_div(gb));
 
     fwrite(&gb->prev_tac_AND, sizeof(uint8_t), 1, file);
     fwrite(&gb->prev_serial_AND, sizeof(uint8_t), 1, file);
@@ -192,7 +211,7 @@ int gb_core_serialize(char *output_path, struct gb_core *gb)
     fwrite(&gb->halt_bug, sizeof(uint8_t), 1, file);
     fwrite(&gb->stop, sizeof(uint8_t), 1, file);
 
-    fwrite_le_16(file, gb->serial_clock);
+    fwrite_le_16(file, serial_get_clock(gb));
     fwrite(&gb->serial_acc, sizeof(uint8_t), 1, file);
 
     fwrite_le_64(file, gb->tcycles_since_sync);
@@ -200,6 +219,13 @@ int gb_core_serialize(char *output_path, struct gb_core *gb)
 
     mbc_serialize(gb->mbc, file);
 
+    /* Microcoded CPU state */
+    fwrite(&gb->cpu.mc_program, sizeof(uint8_t), 1, file);
+    fwrite(&gb->cpu.mc_step, sizeof(uint8_t), 1, file);
+    fwrite(&gb->cpu.mc_opcode, sizeof(uint8_t), 1, file);
+    fwrite(&gb->cpu.mc_z, sizeof(uint8_t), 1, file);
+    fwrite(&gb->cpu.mc_w, sizeof(uint8_t), 1, file);
+
     fclose(file);
 
     return EXIT_SUCCESS;
@@ -211,30 +237,46 @@ int gb_core_load_from_file(char *input_path, struct gb_core *gb)
     if ((file = fopen(input_path, "rb")) == NULL)
         return EXIT_FAILURE;
 
+    /* Checked before anything is modified, the core keeps running as is on another layout */
+    char magic[SAVE_STATE_MAGIC_SIZE];
+    uint32_t version = 0;
+    if (fread(magic, sizeof(char), SAVE_STATE_MAGIC_SIZE, file) != SAVE_STATE_MAGIC_SIZE ||
+        memcmp(magic, SAVE_STATE_MAGIC, SAVE_STATE_MAGIC_SIZE) || fread_le_32(file, &version) != 4 ||
+        version != SAVE_STATE_VERSION)
+    {
+        LOG_ERROR("%s is not a save state of this version (expected version %d)", input_path, SAVE_STATE_VERSION);
+        fclose(file);
+        return EXIT_FAILURE;
+    }
+
     cpu_load_from_stream(file, &gb->cpu);
+    gb->ppu.sync_time = gb->scheduler.now;
     ppu_load_from_stream(file, &gb->ppu);
     apu_load_from_stream(file, &gb->apu);
 
     fread_le_32(file, &gb->memory.boot_rom_size);
-    if (gb->memory.boot_rom_size > 0)
+    if (gb->memory.boot_rom_size > BOOT_ROM_MAX_SIZE)
     {
-        if (!(gb->memory.boot_rom = realloc(gb->memory.boot_rom, gb->memory.boot_rom_size)))
-        {
-            fclose(file);
-            return EXIT_FAILURE;
-        }
-        fread(gb->memory.boot_rom, sizeof(uint8_t), gb->memory.boot_rom_size, file);
+        LOG_ERROR("%s holds a boot ROM bigger than %d bytes", input_path, BOOT_ROM_MAX_SIZE);
+        gb->memory.boot_rom_size = 0;
+        fclose(file);
+        return EXIT_FAILURE;
     }
+    fread(gb->memory.boot_rom, sizeof(uint8_t), gb->memory.boot_rom_size, file);
 
     fread(gb->memory.vram, sizeof(uint8_t), VRAM_SIZE, file);
+    tile_cache_invalidate_all(&gb->tile_cache);
     fread(gb->memory.wram, sizeof(uint8_t), WRAM_SIZE, file);
     fread(gb->memory.oam, sizeof(uint8_t), OAM_SIZE, file);
+    obj_lines_invalidate_all(&gb->obj_lines);
     fread(gb->memory.unusable_mem, sizeof(uint8_t), NOT_USABLE_SIZE, file);
     fread(gb->memory.io, sizeof(uint8_t), IO_SIZE, file);
     fread(gb->memory.hram, sizeof(uint8_t), HRAM_SIZE, file);
     fread(&gb->memory.ie, sizeof(uint8_t), 1, file);
+    update_pending_interrupts(gb);
 
-    fread_le_16(file, &gb->internal_div);
+    uint16_t div;
+    fread_le_16(file, &div);
 
     fread(&gb->prev_tac_AND, sizeof(uint8_t), 1, file);
     fread(&gb->prev_serial_AND, sizeof(uint8_t), 1, file);
@@ -243,7 +285,8 @@ int gb_core_load_from_file(char *input_path, struct gb_core *gb)
     fread(&gb->halt_bug, sizeof(uint8_t), 1, file);
     fread(&gb->stop, sizeof(uint8_t), 1, file);
 
-    fread_le_16(file, &gb->serial_clock);
+    uint16_t serial_clock;
+    fread_le_16(file, &serial_clock);
     fread(&gb->serial_acc, sizeof(uint8_t), 1, file);
 
     fread_le_64(file, &gb->tcycles_since_sync);
@@ -251,6 +294,31 @@ int gb_core_load_from_file(char *input_path, struct gb_core *gb)
 
     mbc_load_from_stream(gb->mbc, file);
 
+    /* Microcoded CPU state */
+    fread(&gb->cpu.mc_program, sizeof(uint8_t), 1, file);
+    fread(&gb->cpu.mc_step, sizeof(uint8_t), 1, file);
+    fread(&gb->cpu.mc_opcode, sizeof(uint8_t), 1, file);
+    fread(&gb->cpu.mc_z, sizeof(uint8_t), 1, file);
+    fread(&gb->cpu.mc_w, sizeof(uint8_t), 1, file);
+
+    /* They were all caught up when saving, resume them from now */
+    gb->apu.sync_time = gb->scheduler.now;
+    gb->timer_sync_time = gb->scheduler.now;
+    gb->div_origin = gb->scheduler.now - div;
+    gb->serial_sync_time = gb->scheduler.now;
+    gb->serial_origin = gb->scheduler.now - serial_clock;
+    scheduler_schedule(gb, SCHED_PPU, gb->scheduler.now + 1);
+    scheduler_schedule(gb, SCHED_APU, gb->scheduler.now + APU_CATCH_UP_PERIOD);
+    timer_schedule(gb);
+    serial_schedule(gb);
+
+    /* A suspended instruction reads its remaining operands from memory */
+    gb->decode_cache.current = NULL;
+    decode_cache_update_banks(gb);
+    page_table_update(gb);
+    dma_schedule(gb);
+    idle_loop_flush(gb);
+
     fclose(file);
 
     return EXIT_SUCCESS;
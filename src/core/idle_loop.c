@@ -0,0 +1,443 @@
+#include "idle_loop.h"
+
+#include <inttypes.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "common.h"
+#include "emulation.h"
+#include "gb_core.h"
+#include "logger.h"
+#include "ppu.h"
+#include "read.h"
+#include "timers.h"
+#include "utils.h"
+
+#define NO_READ 0xFF
+
+enum idle_op
+{
+    IDLE_OP_REJECT,
+    IDLE_OP_PURE, /* Only depends on registers and immediate operands */
+    IDLE_OP_READ, /* Loads a pollable location in a register */
+};
+
+/* Register operand order used by the encoding, index 6 is (HL) */
+static const uint8_t r_offsets[8] = {
+    offsetof(struct cpu, b), offsetof(struct cpu, c), offsetof(struct cpu, d), offsetof(struct cpu, e),
+    offsetof(struct cpu, h), offsetof(struct cpu, l), 0,                       offsetof(struct cpu, a),
+};
+
+static uint32_t rom_tag(struct gb_core *gb, uint16_t address)
+{
+    return (gb->decode_cache.rom_base[address >> 14] | (address & 0x3FFF)) + 1;
+}
+
+/* Locations whose reads have no side effects and which only change with time or from an interrupt handler */
+static int is_pollable(uint16_t address)
+{
+    if (address >= 0xC000 && address < 0xE000)
+        return 1;
+    if (address >= 0xFF80 && address < 0xFFFF)
+        return 1;
+    switch (address)
+    {
+    case DIV:
+    case TIMA:
+    case IF:
+    case STAT:
+    case LY:
+        return 1;
+    default:
+        return 0;
+    }
+}
+
+static int is_branch(uint8_t opcode)
+{
+    switch (opcode)
+    {
+    case 0x18: // jr e
+    case 0x20: // jr cc,e
+    case 0x28:
+    case 0x30:
+    case 0x38:
+    case 0xC3: // jp nn
+    case 0xC2: // jp cc,nn
+    case 0xCA:
+    case 0xD2:
+    case 0xDA:
+        return 1;
+    default:
+        return 0;
+    }
+}
+
+static enum idle_op classify(struct gb_core *gb, uint16_t pc)
+{
+    struct idle_loop *loop = &gb->idle_loop;
+    uint8_t opcode = read_mem(gb, pc);
+    uint8_t y = (opcode >> 3) & 0x07;
+    uint8_t z = opcode & 0x07;
+
+    if (is_branch(opcode))
+        return IDLE_OP_PURE;
+
+    switch (opcode)
+    {
+    case 0x00: // nop
+    case 0x01: // ld rr,nn
+    case 0x11:
+    case 0x21:
+    case 0x03: // inc rr
+    case 0x13:
+    case 0x23:
+    case 0x0B: // dec rr
+    case 0x1B:
+    case 0x2B:
+    case 0x09: // add hl,rr
+    case 0x19:
+    case 0x29:
+    case 0x07: // rlca, rrca, rla, rra
+    case 0x0F:
+    case 0x17:
+    case 0x1F:
+    case 0x2F: // cpl, scf, ccf
+    case 0x37:
+    case 0x3F:
+    case 0xC6: // alu A,n
+    case 0xCE:
+    case 0xD6:
+    case 0xDE:
+    case 0xE6:
+    case 0xEE:
+    case 0xF6:
+    case 0xFE:
+        return IDLE_OP_PURE;
+    case 0xCB: // Register operand rotations, bit, res and set
+        return (read_mem(gb, pc + 1) & 0x07) == 6 ? IDLE_OP_REJECT : IDLE_OP_PURE;
+    case 0xF0: // ldh A,(n)
+        loop->read_tick = 2;
+        loop->read_address = 0xFF00 | read_mem(gb, pc + 1);
+        loop->read_dest = offsetof(struct cpu, a);
+        return IDLE_OP_READ;
+    case 0xFA: // ld A,(nn)
+        loop->read_tick = 3;
+        loop->read_address = read_mem(gb, pc + 2) << 8 | read_mem(gb, pc + 1);
+        loop->read_dest = offsetof(struct cpu, a);
+        return IDLE_OP_READ;
+    case 0xF2: // ldh A,(C)
+        loop->read_tick = 1;
+        loop->read_address = 0xFF00 | gb->cpu.c;
+        loop->read_dest = offsetof(struct cpu, a);
+        return IDLE_OP_READ;
+    default:
+        break;
+    }
+
+    // inc r, dec r, ld r,n
+    if (opcode < 0x40 && y != 6 && (z == 4 || z == 5 || z == 6))
+        return IDLE_OP_PURE;
+
+    // ld r,r and ld r,(HL), HL must stay constant for the address to be known
+    if (opcode >= 0x40 && opcode < 0x80 && y != 6)
+    {
+        if (z != 6)
+            return IDLE_OP_PURE;
+        if (y == 4 || y == 5)
+            return IDLE_OP_REJECT;
+        loop->read_tick = 1;
+        loop->read_address = gb->cpu.hl;
+        loop->read_dest = r_offsets[y];
+        return IDLE_OP_READ;
+    }
+
+    // alu A,r
+    if (opcode >= 0x80 && opcode < 0xC0 && z != 6)
+        return IDLE_OP_PURE;
+
+    return IDLE_OP_REJECT;
+}
+
+static void reject(struct gb_core *gb, uint8_t strikes)
+{
+    struct idle_loop *loop = &gb->idle_loop;
+    uint32_t tag = loop->head_tag;
+    unsigned int index = tag & IDLE_LOOP_REJECT_MASK;
+    if (loop->rejects[index].tag != tag)
+    {
+        loop->rejects[index].tag = tag;
+        loop->rejects[index].strikes = 0;
+    }
+    loop->rejects[index].strikes += strikes;
+    loop->state = IDLE_LOOP_NONE;
+}
+
+static int is_rejected(struct gb_core *gb, uint32_t tag)
+{
+    struct idle_loop *loop = &gb->idle_loop;
+    unsigned int index = tag & IDLE_LOOP_REJECT_MASK;
+    return loop->rejects[index].tag == tag && loop->rejects[index].strikes >= IDLE_LOOP_MAX_STRIKES;
+}
+
+static int same_registers(struct cpu *cpu, struct cpu *other)
+{
+    return cpu->a == other->a && get_f(cpu) == get_f(other) && cpu->bc == other->bc && cpu->de == other->de &&
+           cpu->hl == other->hl && cpu->sp == other->sp && cpu->pc == other->pc && cpu->ime == other->ime;
+}
+
+static void finish_recording(struct gb_core *gb)
+{
+    struct idle_loop *loop = &gb->idle_loop;
+
+    /* The iteration must be a fixed point, the next ones are then identical as long as the polled value is */
+    if (loop->read_index == NO_READ || !same_registers(&gb->cpu, &loop->boundaries[0]))
+    {
+        reject(gb, 1);
+        return;
+    }
+
+    uint8_t next = (loop->read_index + 1) % loop->count;
+    loop->read_value = ((uint8_t *)&loop->boundaries[next])[loop->read_dest];
+    loop->read_offset = loop->read_tick;
+    loop->iteration_mcycles = 0;
+    for (uint8_t i = 0; i < loop->count; ++i)
+    {
+        if (i < loop->read_index)
+            loop->read_offset += loop->mcycles[i];
+        loop->iteration_mcycles += loop->mcycles[i];
+    }
+    loop->rejects[loop->head_tag & IDLE_LOOP_REJECT_MASK].strikes = 0;
+    loop->state = IDLE_LOOP_ARMED;
+    ++loop->detected;
+}
+
+static void record_instruction(struct gb_core *gb)
+{
+    struct idle_loop *loop = &gb->idle_loop;
+    uint16_t pc = gb->cpu.pc;
+
+    if (pc == loop->head && loop->count)
+    {
+        finish_recording(gb);
+        return;
+    }
+
+    /* Left the loop (exit branch taken or interrupt serviced) */
+    if (pc < loop->head || pc >= loop->end || gb->cpu.ime > 1 || gb->halt_bug)
+    {
+        loop->state = IDLE_LOOP_NONE;
+        return;
+    }
+
+    if (loop->count == IDLE_LOOP_MAX_INSTRS)
+    {
+        reject(gb, IDLE_LOOP_MAX_STRIKES);
+        return;
+    }
+
+    switch (classify(gb, pc))
+    {
+    case IDLE_OP_REJECT:
+        reject(gb, IDLE_LOOP_MAX_STRIKES);
+        return;
+    case IDLE_OP_READ:
+        /* Only a single polled location is supported */
+        if (loop->read_index != NO_READ || !is_pollable(loop->read_address))
+        {
+            reject(gb, 1);
+            return;
+        }
+        loop->read_index = loop->count;
+        break;
+    default:
+        break;
+    }
+
+    loop->pcs[loop->count] = pc;
+    loop->boundaries[loop->count] = gb->cpu;
+}
+
+/* TCycles the polled location keeps the value it has at the master clock for, scheduler events aside */
+static uint64_t stable_tcycles(struct gb_core *gb, uint16_t address)
+{
+    switch (address)
+    {
+    case DIV:
+    case TIMA:
+        return timer_stable_tcycles(gb, address);
+    case STAT:
+    case LY:
+        return ppu_stable_dots(gb);
+    default:
+        /* WRAM, HRAM and IF are only modified by events and interrupt handlers */
+        return UINT64_MAX;
+    }
+}
+
+/* Whole iterations from the loop head whose read returns the polled value and during which no event is due */
+static int skippable_iterations(struct gb_core *gb, int max_mcycles)
+{
+    struct idle_loop *loop = &gb->idle_loop;
+
+    /* Resample, reads of pollable locations only catch their component up */
+    if (read_mem(gb, loop->read_address) != loop->read_value)
+        return 0;
+
+    /* An event due on the last MCycle of an iteration runs at the next loop head, where check_interrupt() sees it */
+    if (gb->scheduler.next <= gb->scheduler.now)
+        return 0;
+    uint64_t mcycles = (gb->scheduler.next - gb->scheduler.now + 3) / 4;
+    if (mcycles > (uint64_t)max_mcycles)
+        mcycles = max_mcycles;
+    uint64_t iterations = mcycles / loop->iteration_mcycles;
+
+    /* The read of iteration n happens read_offset + n * iteration_mcycles MCycles from now */
+    uint64_t stable = stable_tcycles(gb, loop->read_address) / 4;
+    if (stable < loop->read_offset)
+        return 0;
+    uint64_t stable_iterations = (stable - loop->read_offset) / loop->iteration_mcycles + 1;
+    return (int)(stable_iterations < iterations ? stable_iterations : iterations);
+}
+
+static int fast_forward(struct gb_core *gb)
+{
+    struct idle_loop *loop = &gb->idle_loop;
+    int mcycles = 0;
+    uint8_t i = 0;
+
+    while (mcycles < IDLE_LOOP_MAX_MCYCLES)
+    {
+        /* Stop at the boundary where check_interrupt() would service an interrupt */
+        if (gb->cpu.ime == 1 && gb->pending_interrupts)
+            break;
+
+        if (i == 0)
+        {
+            int iterations = skippable_iterations(gb, IDLE_LOOP_MAX_MCYCLES - mcycles);
+            if (iterations)
+            {
+                tick_mcycles(gb, iterations * loop->iteration_mcycles);
+                mcycles += iterations * loop->iteration_mcycles;
+                continue;
+            }
+        }
+
+        uint8_t next = i + 1 == loop->count ? 0 : i + 1;
+        uint8_t instr_mcycles = loop->mcycles[i];
+        mcycles += instr_mcycles;
+
+        if (i != loop->read_index)
+        {
+            for (uint8_t m = 0; m < instr_mcycles; ++m)
+                tick_m(gb);
+            i = next;
+            continue;
+        }
+
+        for (uint8_t m = 0; m < loop->read_tick; ++m)
+            tick_m(gb);
+        uint8_t value = read_mem(gb, loop->read_address);
+        for (uint8_t m = loop->read_tick; m < instr_mcycles; ++m)
+            tick_m(gb);
+
+        if (value != loop->read_value)
+        {
+            /* The loop may exit now, finish the load and let the interpreter take over */
+            gb->cpu = loop->boundaries[next];
+            ((uint8_t *)&gb->cpu)[loop->read_dest] = value;
+            loop->state = IDLE_LOOP_NONE;
+            goto exit;
+        }
+        i = next;
+    }
+
+    gb->cpu = loop->boundaries[i];
+
+exit:
+    if (mcycles)
+        ++loop->fast_forwards;
+    loop->skipped_mcycles += mcycles;
+    return mcycles;
+}
+
+void idle_loop_flush(struct gb_core *gb)
+{
+    struct idle_loop *loop = &gb->idle_loop;
+    loop->state = IDLE_LOOP_NONE;
+    memset(loop->rejects, 0, sizeof(loop->rejects));
+}
+
+int idle_loop_before_op(struct gb_core *gb)
+{
+    struct idle_loop *loop = &gb->idle_loop;
+
+    if (loop->state == IDLE_LOOP_RECORDING)
+        record_instruction(gb);
+    if (loop->state != IDLE_LOOP_ARMED)
+        return 0;
+
+    uint16_t pc = gb->cpu.pc;
+    if (pc < loop->head || pc >= loop->end)
+    {
+        loop->state = IDLE_LOOP_NONE;
+        return 0;
+    }
+
+    /* Mid loop, keep interpreting until the head is reached again */
+    if (pc != loop->head)
+        return 0;
+
+    if (gb->halt_bug || rom_tag(gb, pc) != loop->head_tag || !same_registers(&gb->cpu, &loop->boundaries[0]))
+    {
+        loop->state = IDLE_LOOP_NONE;
+        return 0;
+    }
+
+    /* An OAM DMA may conflict with the fetches and the polled read, which the recording doesn't model */
+    if (gb->ppu.dma || !RING_BUFFER_IS_EMPTY(dma_request, &gb->ppu.dma_requests))
+        return 0;
+
+    return fast_forward(gb);
+}
+
+void idle_loop_after_op(struct gb_core *gb, uint16_t pc, int mcycles)
+{
+    struct idle_loop *loop = &gb->idle_loop;
+
+    if (loop->state == IDLE_LOOP_RECORDING)
+    {
+        if (loop->pcs[loop->count] == pc)
+            loop->mcycles[loop->count++] = mcycles;
+        return;
+    }
+
+    if (loop->state != IDLE_LOOP_NONE)
+        return;
+
+    /* Only short backward branches in ROM start a recording */
+    uint16_t head = gb->cpu.pc;
+    if (head > pc || pc - head >= IDLE_LOOP_MAX_LENGTH || pc >= 0x8000 || is_boot_rom_mapped(gb, head))
+        return;
+    uint8_t opcode = read_mem(gb, pc);
+    if (!is_branch(opcode))
+        return;
+
+    uint32_t tag = rom_tag(gb, head);
+    if (is_rejected(gb, tag))
+        return;
+
+    loop->state = IDLE_LOOP_RECORDING;
+    loop->head = head;
+    loop->end = pc + (opcode == 0xC3 || (opcode & 0xE7) == 0xC2 ? 3 : 2);
+    loop->head_tag = tag;
+    loop->count = 0;
+    loop->read_index = NO_READ;
+}
+
+void idle_loop_log_stats(struct gb_core *gb)
+{
+    struct idle_loop *loop = &gb->idle_loop;
+    LOG_INFO("Idle loops: %" PRIu64 " detected, %" PRIu64 " fast-forwards, %" PRIu64 " MCycles skipped",
+             loop->detected, loop->fast_forwards, loop->skipped_mcycles);
+}
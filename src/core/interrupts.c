@@ -17,6 +17,18 @@ static unsigned int handlers_vector[] = {   0x40,   0x48,   0x50,   0x58,   0x60
 
 // clang-format on
 
+uint16_t acknowledge_interrupt(struct gb_core *gb)
+{
+    for (size_t i = 0; i < 5; ++i)
+    {
+        if (!((gb->pending_interrupts >> i) & 0x01))
+            continue;
+        clear_if(gb, i);
+        return handlers_vector[i];
+    }
+    return 0;
+}
+
 static int handle_interrupt(struct gb_core *gb)
 {
     gb->cpu.ime = 0;
@@ -30,15 +42,7 @@ static int handle_interrupt(struct gb_core *gb)
     write_mem(gb, --gb->cpu.sp, hi);
 
     /* Interrupt may be aborted from the previous upper SP push writing in IE */
-    uint16_t handler = 0;
-    for (size_t i = 0; i < 5; ++i)
-    {
-        if (!get_ie(gb, i) || !get_if(gb, i))
-            continue;
-        clear_if(gb, i);
-        handler = handlers_vector[i];
-        break;
-    }
+    uint16_t handler = acknowledge_interrupt(gb);
 
     /* Lower SP push is too late to cancel even if it modifies IE */
     write_mem(gb, --gb->cpu.sp, lo);
@@ -48,7 +52,7 @@ static int handle_interrupt(struct gb_core *gb)
     return 1;
 }
 
-int check_interrupt(struct gb_core *gb)
+int poll_interrupt(struct gb_core *gb)
 {
     if (gb->cpu.ime == 2)
         gb->cpu.ime = 1;
@@ -56,14 +60,19 @@ int check_interrupt(struct gb_core *gb)
     if (!gb->halt && gb->cpu.ime != 1)
         return 0;
 
-    if (gb->memory.io[IO_OFFSET(IF)] & gb->memory.ie & 0x1F)
+    if (gb->pending_interrupts)
     {
         gb->halt = 0;
-        if (!gb->cpu.ime) // Wake up from halt with IME = 0
-            return 1;
-        handle_interrupt(gb);
+        return gb->cpu.ime; // Wake up from halt with IME = 0
     }
-    return 1;
+    return 0;
+}
+
+int check_interrupt(struct gb_core *gb)
+{
+    if (!poll_interrupt(gb))
+        return 0;
+    return handle_interrupt(gb);
 }
 
 void check_joyp_int(struct gb_core *gb, uint8_t prev_joyp)
@@ -40,7 +40,7 @@ static void _mbc_free(struct mbc_base *mbc)
     (void)mbc;
 }
 
-static uint8_t _read_mbc_rom(struct mbc_base *mbc, uint16_t address)
+static unsigned int rom_offset(struct mbc_base *mbc, uint16_t address)
 {
     struct mbc3 *mbc3 = (struct mbc3 *)mbc;
 
@@ -51,7 +51,25 @@ static uint8_t _read_mbc_rom(struct mbc_base *mbc, uint16_t address)
     // Ensure that res_addr doesn't overflow the ROM size
     res_addr &= mbc->rom_total_size - 1;
 
-    return mbc->rom[res_addr];
+    return res_addr;
+}
+
+static int is_rtc_selected(struct mbc3 *mbc3)
+{
+    return mbc3->bank2 >= RTC_SECONDS && mbc3->bank2 <= RTC_DAY_UPPER;
+}
+
+static void _mbc_update_banks(struct mbc_base *mbc)
+{
+    struct mbc3 *mbc3 = (struct mbc3 *)mbc;
+
+    mbc->rom_banks[0] = mbc->rom + rom_offset(mbc, 0x0000);
+    mbc->rom_banks[1] = mbc->rom + rom_offset(mbc, 0x4000);
+
+    /* RTC registers are read through _read_mbc_ram() */
+    mbc->ram_bank = NULL;
+    if (mbc3->ram_rtc_registers_enabled && !is_rtc_selected(mbc3) && mbc->ram_bank_count != 0)
+        mbc->ram_bank = mbc->ram + ((mbc3->bank2 << 13) & (mbc->ram_total_size - 1));
 }
 
 static void _write_mbc_rom(struct mbc_base *mbc, uint16_t address, uint8_t val)
@@ -83,7 +101,9 @@ static void _write_mbc_rom(struct mbc_base *mbc, uint16_t address, uint8_t val)
     // RAM bank switch OR RTC register select
     else if (address >= 0x4000 && address <= 0x5FFF)
     {
-        if (val < RTC_SECONDS || val > RTC_DAY_UPPER)
+        if (val >= RTC_SECONDS && val <= RTC_DAY_UPPER)
+            mbc3->bank2 = val;
+        else
             mbc3->bank2 = val & 0x03;
     }
 
@@ -124,7 +144,8 @@ static uint8_t _read_mbc_ram(struct mbc_base *mbc, uint16_t address)
         return 0xFF;
 
     // RTC register mapping
-    read_rtc_register(mbc3);
+    if (is_rtc_selected(mbc3))
+        return read_rtc_register(mbc3);
 
     if (mbc->ram_bank_count == 0)
         return 0xFF;
@@ -22,7 +22,7 @@ static void _mbc_free(struct mbc_base *mbc)
     (void)mbc;
 }
 
-static uint8_t _read_mbc_rom(struct mbc_base *mbc, uint16_t address)
+static unsigned int rom_offset(struct mbc_base *mbc, uint16_t address)
 {
     struct mbc5 *mbc5 = (struct mbc5 *)mbc;
 
@@ -37,7 +37,19 @@ static uint8_t _read_mbc_rom(struct mbc_base *mbc, uint16_t address)
     // Ensure that res_addr doesn't overflow the ROM size
     res_addr &= mbc->rom_total_size - 1;
 
-    return mbc->rom[res_addr];
+    return res_addr;
+}
+
+static void _mbc_update_banks(struct mbc_base *mbc)
+{
+    struct mbc5 *mbc5 = (struct mbc5 *)mbc;
+
+    mbc->rom_banks[0] = mbc->rom + rom_offset(mbc, 0x0000);
+    mbc->rom_banks[1] = mbc->rom + rom_offset(mbc, 0x4000);
+
+    mbc->ram_bank = NULL;
+    if (mbc5->RAMG && mbc->ram_bank_count != 0)
+        mbc->ram_bank = mbc->ram + ((mbc5->RAMB << 13) & (mbc->ram_total_size - 1));
 }
 
 static void _write_mbc_rom(struct mbc_base *mbc, uint16_t address, uint8_t val)
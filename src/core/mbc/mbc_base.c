@@ -16,6 +16,7 @@
 #include "mbc3.h"
 #include "mbc5.h"
 #include "no_mbc.h"
+#include "rom_image.h"
 #include "save.h"
 
 void mbc_reset(struct mbc_base *mbc)
@@ -23,6 +24,7 @@ void mbc_reset(struct mbc_base *mbc)
     if (!mbc)
         return;
     mbc->_mbc_reset(mbc);
+    mbc->_mbc_update_banks(mbc);
 }
 
 void mbc_free(struct mbc_base *mbc)
@@ -34,8 +36,7 @@ void mbc_free(struct mbc_base *mbc)
 
     if (mbc->save_file)
         fclose(mbc->save_file);
-    free(mbc->rom);
-    free(mbc->ram);
+    rom_image_release(mbc->rom);
     free(mbc->rom_path);
     free(mbc);
 }
@@ -96,6 +97,9 @@ static int make_mbc(uint8_t type_byte, struct mbc_base **output)
 
     (*output)->rom_total_size = 0;
     (*output)->ram_total_size = 0;
+    (*output)->rom_banks[0] = NULL;
+    (*output)->rom_banks[1] = NULL;
+    (*output)->ram_bank = NULL;
 
     return EXIT_SUCCESS;
 }
@@ -123,10 +127,11 @@ static bool is_multicart(struct mbc_base *mbc)
     return match_counter >= 3;
 }
 
-int set_mbc(struct mbc_base **output, uint8_t *rom, char *rom_path)
+int set_mbc(struct mbc_base **output, uint8_t *rom, uint8_t *ram, char *rom_path)
 {
     assert(output);
     assert(rom);
+    assert(ram);
     assert(rom_path);
 
     uint8_t type = rom[0x0147];
@@ -172,14 +177,9 @@ int set_mbc(struct mbc_base **output, uint8_t *rom, char *rom_path)
     mbc->rom_total_size = mbc->rom_bank_count * 16384;
     mbc->ram_total_size = mbc->ram_bank_count * 8192;
 
-    // Allocate the external RAM
-    if (mbc->type == MBC2)
-        mbc->ram = calloc(512, sizeof(uint8_t));
-    else
-        mbc->ram = calloc(8192 * mbc->ram_bank_count, sizeof(uint8_t));
-
-    if (!mbc->ram)
-        goto error_exit;
+    // The external RAM buffer is sized for the largest cartridges, MBC2 only uses its first 512 bytes
+    mbc->ram = ram;
+    memset(mbc->ram, 0, CART_RAM_MAX_SIZE);
 
     // Create / Load save file if battery
     if (type == 0x03 || type == 0x06 || type == 0x09 || type == 0x0D || type == 0x0F || type == 0x10 || type == 0x13 ||
@@ -195,6 +195,8 @@ int set_mbc(struct mbc_base **output, uint8_t *rom, char *rom_path)
         ((struct mbc1 *)mbc)->multicart = true;
     }
 
+    mbc->_mbc_update_banks(mbc);
+
     // Free previous MBC if one is already loaded
     if (*output)
         mbc_free(*output);
@@ -207,19 +209,10 @@ error_exit:
     return EXIT_FAILURE;
 }
 
-uint8_t read_mbc_rom(struct mbc_base *mbc, uint16_t address)
-{
-    return mbc->_read_mbc_rom(mbc, address);
-}
-
 void write_mbc_rom(struct mbc_base *mbc, uint16_t address, uint8_t val)
 {
     mbc->_write_mbc_rom(mbc, address, val);
-}
-
-uint8_t read_mbc_ram(struct mbc_base *mbc, uint16_t address)
-{
-    return mbc->_read_mbc_ram(mbc, address);
+    mbc->_mbc_update_banks(mbc);
 }
 
 void write_mbc_ram(struct mbc_base *mbc, uint16_t address, uint8_t val)
@@ -237,4 +230,5 @@ void mbc_load_from_stream(struct mbc_base *mbc, FILE *stream)
 {
     fread(mbc->ram, sizeof(uint8_t), mbc->ram_total_size, stream);
     mbc->_mbc_load_from_stream(mbc, stream);
+    mbc->_mbc_update_banks(mbc);
 }
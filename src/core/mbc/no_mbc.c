@@ -16,9 +16,11 @@ static void _mbc_free(struct mbc_base *mbc)
     /* Nothing to do, all is handled in mbc_base */
 }
 
-static uint8_t _read_mbc_rom(struct mbc_base *mbc, uint16_t address)
+static void _mbc_update_banks(struct mbc_base *mbc)
 {
-    return mbc->rom[address];
+    mbc->rom_banks[0] = mbc->rom;
+    mbc->rom_banks[1] = mbc->rom + 0x4000;
+    mbc->ram_bank = NULL;
 }
 
 static void _write_mbc_rom(struct mbc_base *mbc, uint16_t address, uint8_t val)
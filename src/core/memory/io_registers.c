@@ -0,0 +1,196 @@
+#include "io_registers.h"
+
+#include <stddef.h>
+
+#include "apu.h"
+#include "gb_core.h"
+#include "interrupts.h"
+#include "page_table.h"
+#include "ppu.h"
+#include "serial.h"
+#include "timers.h"
+
+static uint8_t joyp_read(struct gb_core *gb, uint16_t address)
+{
+    uint8_t select_bits = (io_read(gb->memory.io, address) >> 4) & 0x03;
+    uint8_t buttons_bits[4] = {
+        gb->joyp_a & gb->joyp_d,
+        gb->joyp_a,
+        gb->joyp_d,
+        0xF,
+    };
+    return (gb->memory.io[IO_OFFSET(address)] & 0xF0) | buttons_bits[select_bits];
+}
+
+static void joyp_write(struct gb_core *gb, uint16_t address, uint8_t val)
+{
+    uint8_t prev_joyp = joyp_read(gb, address);
+    io_write(gb->memory.io, address, val);
+    check_joyp_int(gb, prev_joyp);
+}
+
+static void sc_write(struct gb_core *gb, uint16_t address, uint8_t val)
+{
+    io_write(gb->memory.io, address, val);
+    serial_schedule(gb);
+}
+
+static uint8_t div_read(struct gb_core *gb, uint16_t address)
+{
+    (void)address;
+    return timer_get_div(gb) >> 8;
+}
+
+static void div_write(struct gb_core *gb, uint16_t address, uint8_t val)
+{
+    (void)address;
+    (void)val;
+    /* The frame sequencer is clocked by DIV */
+    apu_catch_up(gb);
+    timer_set_div(gb, 0);
+}
+
+static void timer_write(struct gb_core *gb, uint16_t address, uint8_t val)
+{
+    io_write(gb->memory.io, address, val);
+    timer_schedule(gb);
+}
+
+static void tima_write(struct gb_core *gb, uint16_t address, uint8_t val)
+{
+    /* Ignore TIMA write on cycle after TIMA overflow */
+    if (!gb->schedule_tima_overflow)
+        timer_write(gb, address, val);
+}
+
+static void if_write(struct gb_core *gb, uint16_t address, uint8_t val)
+{
+    io_write(gb->memory.io, address, val);
+    update_pending_interrupts(gb);
+}
+
+/* Registers read by the renderers, see ppu_render_sync() */
+static void render_write(struct gb_core *gb, uint16_t address, uint8_t val)
+{
+    ppu_render_sync(gb);
+    io_write(gb->memory.io, address, val);
+}
+
+static void lcdc_write(struct gb_core *gb, uint16_t address, uint8_t val)
+{
+    ppu_render_sync(gb);
+    ppu_oam_scan_sync(gb);
+    /* LCD off */
+    if (!(val >> 7))
+        ppu_reset(gb);
+    io_write(gb->memory.io, address, val);
+    page_table_update_vram(gb);
+}
+
+static void dma_write(struct gb_core *gb, uint16_t address, uint8_t val)
+{
+    dma_request_transfer(gb, val);
+    io_write(gb->memory.io, address, val);
+}
+
+static void boot_write(struct gb_core *gb, uint16_t address, uint8_t val)
+{
+    if (gb->memory.io[IO_OFFSET(BOOT)] & 0x01)
+        return;
+    io_write(gb->memory.io, address, val);
+    page_table_update_banks(gb);
+}
+
+#define REG(ADDR, READ_MASK, WRITE_MASK, CATCH_UP, READ, WRITE)                                                        \
+    [IO_OFFSET(ADDR)] = {READ_MASK, WRITE_MASK, CATCH_UP, READ, WRITE, #ADDR}
+#define WAVE(N) REG(WAVE_RAM + N, 0xFF, 0xFF, apu_catch_up, apu_read_wave_ram, apu_write_wave_ram)
+
+const struct io_register io_registers[IO_SIZE] = {
+    REG(JOYP, 0x3F, 0x30, NULL, joyp_read, joyp_write),
+    REG(SB, 0xFF, 0xFF, serial_catch_up, NULL, NULL),
+    REG(SC, 0x81, 0x83, serial_catch_up, NULL, sc_write),
+    REG(DIV, 0xFF, 0x00, NULL, div_read, div_write),
+    REG(TIMA, 0xFF, 0xFF, timer_catch_up, NULL, tima_write),
+    REG(TMA, 0xFF, 0xFF, timer_catch_up, NULL, timer_write),
+    REG(TAC, 0x07, 0x07, timer_catch_up, NULL, timer_write),
+    REG(IF, 0x1F, 0x1F, NULL, NULL, if_write),
+
+    REG(NR10, 0x7F, 0x7F, apu_catch_up, NULL, apu_write_nr10),
+    REG(NR11, 0xC0, 0xFF, apu_catch_up, NULL, apu_write_nrx1),
+    REG(NR12, 0xFF, 0xFF, apu_catch_up, NULL, apu_write_nrx2),
+    REG(NR13, 0x00, 0xFF, apu_catch_up, NULL, apu_write_powered),
+    REG(NR14, 0x40, 0xC7, apu_catch_up, NULL, apu_write_nrx4),
+    REG(NR21, 0xC0, 0xFF, apu_catch_up, NULL, apu_write_nrx1),
+    REG(NR22, 0xFF, 0xFF, apu_catch_up, NULL, apu_write_nrx2),
+    REG(NR23, 0x00, 0xFF, apu_catch_up, NULL, apu_write_powered),
+    REG(NR24, 0x40, 0xC7, apu_catch_up, NULL, apu_write_nrx4),
+    REG(NR30, 0x80, 0x80, apu_catch_up, NULL, apu_write_nr30),
+    REG(NR31, 0x00, 0xFF, apu_catch_up, NULL, apu_write_nrx1),
+    REG(NR32, 0x60, 0x60, apu_catch_up, NULL, apu_write_powered),
+    REG(NR33, 0x00, 0xFF, apu_catch_up, NULL, apu_write_powered),
+    REG(NR34, 0x40, 0xC7, apu_catch_up, NULL, apu_write_nrx4),
+    REG(NR41, 0x00, 0x3F, apu_catch_up, NULL, apu_write_nrx1),
+    REG(NR42, 0xFF, 0xFF, apu_catch_up, NULL, apu_write_nrx2),
+    REG(NR43, 0xFF, 0xFF, apu_catch_up, NULL, apu_write_powered),
+    REG(NR44, 0x40, 0xC0, apu_catch_up, NULL, apu_write_nrx4),
+    REG(NR50, 0xFF, 0xFF, apu_catch_up, NULL, apu_write_powered),
+    REG(NR51, 0xFF, 0xFF, apu_catch_up, NULL, apu_write_powered),
+    REG(NR52, 0x8F, 0x80, apu_catch_up, NULL, apu_write_nr52),
+    WAVE(0),
+    WAVE(1),
+    WAVE(2),
+    WAVE(3),
+    WAVE(4),
+    WAVE(5),
+    WAVE(6),
+    WAVE(7),
+    WAVE(8),
+    WAVE(9),
+    WAVE(10),
+    WAVE(11),
+    WAVE(12),
+    WAVE(13),
+    WAVE(14),
+    WAVE(15),
+
+    REG(LCDC, 0xFF, 0xFF, ppu_catch_up, NULL, lcdc_write),
+    REG(STAT, 0x7F, 0x78, ppu_catch_up, NULL, NULL),
+    REG(SCY, 0xFF, 0xFF, ppu_catch_up, NULL, render_write),
+    REG(SCX, 0xFF, 0xFF, ppu_catch_up, NULL, render_write),
+    REG(LY, 0xFF, 0x00, ppu_catch_up, NULL, NULL),
+    REG(LYC, 0xFF, 0xFF, ppu_catch_up, NULL, NULL),
+    REG(DMA, 0xFF, 0xFF, ppu_catch_up, NULL, dma_write),
+    REG(BGP, 0xFF, 0xFF, ppu_catch_up, NULL, render_write),
+    REG(OBP0, 0xFF, 0xFF, ppu_catch_up, NULL, render_write),
+    REG(OBP1, 0xFF, 0xFF, ppu_catch_up, NULL, render_write),
+    REG(WY, 0xFF, 0xFF, ppu_catch_up, NULL, render_write),
+    REG(WX, 0xFF, 0xFF, ppu_catch_up, NULL, render_write),
+
+    REG(BOOT, 0x01, 0x01, NULL, NULL, boot_write),
+};
+
+#undef WAVE
+#undef REG
+
+uint8_t io_register_read(struct gb_core *gb, uint16_t address)
+{
+    const struct io_register *reg = &io_registers[IO_OFFSET(address)];
+    if (reg->catch_up)
+        reg->catch_up(gb);
+    if (reg->read)
+        return reg->read(gb, address);
+    return gb->memory.io[IO_OFFSET(address)] | ~reg->read_mask;
+}
+
+void io_register_write(struct gb_core *gb, uint16_t address, uint8_t val)
+{
+    const struct io_register *reg = &io_registers[IO_OFFSET(address)];
+    if (reg->catch_up)
+        reg->catch_up(gb);
+    if (reg->write)
+    {
+        reg->write(gb, address, val);
+        return;
+    }
+    gb->memory.io[IO_OFFSET(address)] = (val & reg->write_mask) | (gb->memory.io[IO_OFFSET(address)] & ~reg->write_mask);
+}
@@ -0,0 +1,107 @@
+#include "page_table.h"
+
+#include <string.h>
+
+#include "common.h"
+#include "gb_core.h"
+#include "mbc_base.h"
+#include "ppu.h"
+#include "read.h"
+#include "tile_cache.h"
+
+static void map(struct gb_core *gb, uint16_t start, uint16_t end, uint8_t *read, uint8_t *write)
+{
+    for (unsigned int page = start >> PAGE_SHIFT; page <= end >> PAGE_SHIFT; ++page)
+    {
+        unsigned int offset = (page << PAGE_SHIFT) - start;
+        gb->memory.read_pages[page] = read ? read + offset : NULL;
+        gb->memory.write_pages[page] = write ? write + offset : NULL;
+    }
+}
+
+/*
+ * While an OAM DMA runs, the CPU reads the byte it copies from anywhere on the bus of its source (see read_mem_slow())
+ * and writes to the source must catch it up first (see dma_catch_up()). The DMA itself reads through the saved
+ * pointer of its source page.
+ */
+static void map_dma_bus_conflict(struct gb_core *gb)
+{
+    if (!gb->ppu.dma)
+        return;
+    const uint8_t *source = gb->memory.read_pages[gb->ppu.dma_source];
+    gb->ppu.dma_source_page = source;
+    for (unsigned int page = 0; page < PAGE_COUNT; ++page)
+    {
+        if (is_dma_bus_conflict(gb, page << PAGE_SHIFT))
+            gb->memory.read_pages[page] = NULL;
+        if (source && gb->memory.write_pages[page] == source)
+            gb->memory.write_pages[page] = NULL;
+    }
+}
+
+static void map_banks(struct gb_core *gb)
+{
+    if (!gb->mbc)
+        return;
+
+    /* Writes go to the MBC registers, cartridge RAM writes may have to be saved */
+    map(gb, 0x0000, 0x3FFF, gb->mbc->rom_banks[0], NULL);
+    map(gb, 0x4000, 0x7FFF, gb->mbc->rom_banks[1], NULL);
+    map(gb, EXRAM, WRAM1 - 1, gb->mbc->ram_bank, NULL);
+
+    for (unsigned int page = 0; page < 0x80 && is_boot_rom_mapped(gb, page << PAGE_SHIFT); ++page)
+    {
+        uint16_t address = page << PAGE_SHIFT;
+        /* A page only partly covered by the boot ROM is left to the handlers */
+        if (is_boot_rom_mapped(gb, address | PAGE_MASK))
+            gb->memory.read_pages[page] = gb->memory.boot_rom + address;
+        else
+            gb->memory.read_pages[page] = NULL;
+    }
+}
+
+static void map_vram(struct gb_core *gb)
+{
+    /* The PPU can only lock VRAM while the LCD is on */
+    uint8_t *vram = NULL;
+    if (!get_lcdc(gb->memory.io, LCDC_LCD_PPU_ENABLE) && !gb->ppu.vram_locked)
+        vram = gb->memory.vram;
+    /* Tile data writes must invalidate the tile cache */
+    map(gb, VRAM, VRAM + TILE_DATA_SIZE - 1, vram, NULL);
+    vram = vram ? vram + TILE_DATA_SIZE : NULL;
+    map(gb, VRAM + TILE_DATA_SIZE, EXRAM - 1, vram, vram);
+}
+
+void page_table_clear(struct gb_core *gb)
+{
+    memset(gb->memory.read_pages, 0, sizeof(gb->memory.read_pages));
+    memset(gb->memory.write_pages, 0, sizeof(gb->memory.write_pages));
+}
+
+void page_table_update(struct gb_core *gb)
+{
+    page_table_clear(gb);
+    map_banks(gb);
+    map_vram(gb);
+    map(gb, WRAM1, ECHO_RAM - 1, gb->memory.wram, gb->memory.wram);
+    /* Echo RAM mirrors WRAM up to OAM */
+    map(gb, ECHO_RAM, OAM - 1, gb->memory.wram, gb->memory.wram);
+    map_dma_bus_conflict(gb);
+}
+
+void page_table_update_banks(struct gb_core *gb)
+{
+    /* The pages of a running OAM DMA bus were dropped, only a full update knows its source again */
+    if (gb->ppu.dma)
+        page_table_update(gb);
+    else
+        map_banks(gb);
+}
+
+void page_table_update_vram(struct gb_core *gb)
+{
+    if (gb->ppu.dma)
+        page_table_update(gb);
+    else
+        map_vram(gb);
+}
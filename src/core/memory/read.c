@@ -5,17 +5,20 @@
 #include "common.h"
 #include "emulation.h"
 #include "gb_core.h"
+#include "io_registers.h"
 #include "mbc_base.h"
+#include "ppu.h"
 
 static uint8_t _rom(struct gb_core *gb, uint16_t address)
 {
-    if (!(gb->memory.io[IO_OFFSET(BOOT)] & 0x01) && gb->memory.boot_rom && address < gb->memory.boot_rom_size)
+    if (is_boot_rom_mapped(gb, address))
         return gb->memory.boot_rom[address];
     return read_mbc_rom(gb->mbc, address);
 }
 
 static uint8_t _vram(struct gb_core *gb, uint16_t address)
 {
+    ppu_catch_up(gb);
     if (gb->ppu.vram_locked)
         return 0xFF;
     return gb->memory.vram[VRAM_OFFSET(address)];
@@ -38,6 +41,7 @@ static uint8_t _echo_ram(struct gb_core *gb, uint16_t address)
 
 static uint8_t _oam(struct gb_core *gb, uint16_t address)
 {
+    ppu_catch_up(gb);
     if (gb->ppu.oam_locked)
     {
         /* TODO: OAM Bug */
@@ -51,51 +55,7 @@ static uint8_t _oam(struct gb_core *gb, uint16_t address)
 
 static uint8_t _io(struct gb_core *gb, uint16_t address)
 {
-    switch (address)
-    {
-    case JOYP:
-    {
-        uint8_t select_bits = (io_read(gb->memory.io, JOYP) >> 4) & 0x03;
-        uint8_t buttons_bits[4] = {
-            gb->joyp_a & gb->joyp_d,
-            gb->joyp_a,
-            gb->joyp_d,
-            0xF,
-        };
-        return (gb->memory.io[IO_OFFSET(JOYP)] & 0xF0) | buttons_bits[select_bits];
-    }
-    case DIV:
-        return gb->internal_div >> 8;
-
-    case WAVE_RAM:
-    case WAVE_RAM + 1:
-    case WAVE_RAM + 2:
-    case WAVE_RAM + 3:
-    case WAVE_RAM + 4:
-    case WAVE_RAM + 5:
-    case WAVE_RAM + 6:
-    case WAVE_RAM + 7:
-    case WAVE_RAM + 8:
-    case WAVE_RAM + 9:
-    case WAVE_RAM + 10:
-    case WAVE_RAM + 11:
-    case WAVE_RAM + 12:
-    case WAVE_RAM + 13:
-    case WAVE_RAM + 14:
-    case WAVE_RAM + 15:
-        /* Attempting to access wave RAM while channel 3 is active */
-        if (is_channel_on(gb, 3))
-        {
-            /* Wave RAM accessible to CPU only on same cycle as CH3 read */
-            if ((gb->apu.ch3.frequency_timer >= 4 || gb->apu.ch3.phantom_sample))
-                return 0xFF;
-            /* Whole wave RAM is mapped to the same byte read by CH3 */
-            uint8_t pos = (gb->apu.ch3.wave_pos) % 32;
-            return gb->memory.io[IO_OFFSET(WAVE_RAM + pos / 2)];
-        }
-        break;
-    }
-    return io_read(gb->memory.io, address);
+    return io_register_read(gb, address);
 }
 
 static uint8_t _hram(struct gb_core *gb, uint16_t address)
@@ -201,8 +161,18 @@ static uint8_t _read_mem(struct gb_core *gb, uint16_t address)
     return read_jmp_table[(address & 0xF000) >> 12](gb, address);
 }
 
-uint8_t read_mem(struct gb_core *gb, uint16_t address)
+uint8_t read_mem_slow(struct gb_core *gb, uint16_t address)
+{
+    if (is_dma_bus_conflict(gb, address))
+        return dma_bus_value(gb);
+    return _read_mem(gb, address);
+}
+
+uint8_t read_mem_dma(struct gb_core *gb, uint16_t address)
 {
+    const uint8_t *page = gb->ppu.dma_source_page;
+    if (page && address >> PAGE_SHIFT == gb->ppu.dma_source)
+        return page[address & PAGE_MASK];
     return _read_mem(gb, address);
 }
 
@@ -1,21 +1,31 @@
 #include "write.h"
 
+#include "decode_cache.h"
 #include "emulation.h"
 #include "gb_core.h"
 #include "interrupts.h"
+#include "io_registers.h"
 #include "mbc_base.h"
-#include "read.h"
-#include "ring_buffer.h"
+#include "obj_lines.h"
+#include "page_table.h"
+#include "ppu.h"
+#include "tile_cache.h"
 
 static void _rom(struct gb_core *gb, uint16_t address, uint8_t val)
 {
     write_mbc_rom(gb->mbc, address, val);
+    decode_cache_update_banks(gb);
+    page_table_update_banks(gb);
 }
 
 static void _vram(struct gb_core *gb, uint16_t address, uint8_t val)
 {
+    ppu_catch_up(gb);
     if (!gb->ppu.vram_locked)
+    {
         gb->memory.vram[VRAM_OFFSET(address)] = val;
+        tile_cache_invalidate(&gb->tile_cache, VRAM_OFFSET(address));
+    }
 }
 
 static void _ex_ram(struct gb_core *gb, uint16_t address, uint8_t val)
@@ -35,107 +45,19 @@ static void _echo_ram(struct gb_core *gb, uint16_t address, uint8_t val)
 
 static void _oam(struct gb_core *gb, uint16_t address, uint8_t val)
 {
+    ppu_catch_up(gb);
     if (address >= 0xFEA0 && address <= 0xFEFF)
         return;
     if (!gb->ppu.oam_locked && gb->ppu.dma != 1)
+    {
         gb->memory.oam[OAM_OFFSET(address)] = val;
+        obj_lines_invalidate(&gb->obj_lines, OAM_OFFSET(address));
+    }
 }
 
 static void _io(struct gb_core *gb, uint16_t address, uint8_t val)
 {
-    switch (address)
-    {
-    case JOYP:
-    {
-        uint8_t prev_joyp = read_mem(gb, JOYP);
-        io_write(gb->memory.io, address, val);
-        check_joyp_int(gb, prev_joyp);
-        return;
-    }
-    case DIV:
-        gb->internal_div = 0;
-        return;
-
-    case TIMA:
-        /* Ignore TIMA write on cycle after TIMA overflow */
-        if (gb->schedule_tima_overflow)
-            return;
-        break;
-
-    case NR10:
-    case NR11:
-    case NR12:
-    case NR13:
-    case NR14:
-    case NR21:
-    case NR22:
-    case NR23:
-    case NR24:
-    case NR30:
-    case NR31:
-    case NR32:
-    case NR33:
-    case NR34:
-    case NR41:
-    case NR42:
-    case NR43:
-    case NR44:
-    case NR50:
-    case NR51:
-    case NR52:
-        apu_write_reg(gb, address, val);
-        return;
-
-    case WAVE_RAM:
-    case WAVE_RAM + 1:
-    case WAVE_RAM + 2:
-    case WAVE_RAM + 3:
-    case WAVE_RAM + 4:
-    case WAVE_RAM + 5:
-    case WAVE_RAM + 6:
-    case WAVE_RAM + 7:
-    case WAVE_RAM + 8:
-    case WAVE_RAM + 9:
-    case WAVE_RAM + 10:
-    case WAVE_RAM + 11:
-    case WAVE_RAM + 12:
-    case WAVE_RAM + 13:
-    case WAVE_RAM + 14:
-    case WAVE_RAM + 15:
-        /* Attempting write to wave RAM while channel 3 is active */
-        if (is_channel_on(gb, 3))
-        {
-            /* CPU can only access the Wave RAM when CH3 is also accessing it */
-            if ((gb->apu.ch3.frequency_timer >= 4 || gb->apu.ch3.phantom_sample))
-                return;
-            /* CPU can only access the same byte that CH3 is acessing (CH3 has priority over CPU) */
-            uint8_t pos = (gb->apu.ch3.wave_pos) % 32;
-            address = WAVE_RAM + pos / 2;
-        }
-        break;
-
-    case LCDC:
-        /* LCD off */
-        if (!(val >> 7))
-            ppu_reset(gb);
-        break;
-
-    case DMA:
-    {
-        struct dma_request new_req = {
-            .source = val > 0xDF ? val & 0xDF : val,
-            .status = DMA_REQUESTED,
-        };
-        RING_BUFFER_ENQUEUE(dma_request, &gb->ppu.dma_requests, &new_req);
-        break;
-    }
-
-    case BOOT:
-        if (gb->memory.io[IO_OFFSET(BOOT)] & 0x01)
-            return;
-    }
-
-    io_write(gb->memory.io, address, val);
+    io_register_write(gb, address, val);
 }
 
 static void _hram(struct gb_core *gb, uint16_t address, uint8_t val)
@@ -147,6 +69,7 @@ static void _ie(struct gb_core *gb, uint16_t address, uint8_t val)
 {
     (void)address;
     gb->memory.ie = val;
+    update_pending_interrupts(gb);
 }
 
 static void _write_jmp_level_4(struct gb_core *gb, uint16_t address, uint8_t val)
@@ -243,6 +166,17 @@ static void _write_mem(struct gb_core *gb, uint16_t address, uint8_t val)
 
 void write_mem(struct gb_core *gb, uint16_t address, uint8_t val)
 {
-    _write_mem(gb, address, val);
+    uint8_t *page = gb->memory.write_pages[address >> PAGE_SHIFT];
+    if (page)
+        page[address & PAGE_MASK] = val;
+    else if (gb->ppu.dma)
+    {
+        /* The write may modify the source of the OAM DMA or its mapping */
+        dma_catch_up(gb);
+        _write_mem(gb, address, val);
+        dma_schedule(gb);
+    }
+    else
+        _write_mem(gb, address, val);
     tick_m(gb);
 }
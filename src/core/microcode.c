@@ -0,0 +1,552 @@
+#include "microcode.h"
+
+#include <stddef.h>
+#include <stdlib.h>
+
+#include "disassembler.h"
+#include "emulation.h"
+#include "fetch.h"
+#include "gb_core.h"
+#include "interrupts.h"
+#include "logic.h"
+#include "read.h"
+#include "utils.h"
+#include "write.h"
+
+#define MC_CONTINUE 0
+#define MC_DONE 1 /* Ends the program before its last micro-op, e.g. a conditional branch not taken */
+
+#define CB_HL_OPERAND 6
+
+/* A micro-op does exactly one MCycle: one read_mem_tick(), fetch_mem_tick(), write_mem() or tick_m() */
+typedef int (*uop_fn)(struct gb_core *gb);
+
+/* Register operand order used by the encoding, index 6 is (HL) */
+static const size_t r_offsets[8] = {
+    offsetof(struct cpu, b), offsetof(struct cpu, c), offsetof(struct cpu, d), offsetof(struct cpu, e),
+    offsetof(struct cpu, h), offsetof(struct cpu, l), 0,                       offsetof(struct cpu, a),
+};
+
+static int condition(struct cpu *cpu)
+{
+    switch (cpu->mc_opcode)
+    {
+    case 0x18: // jr e
+    case 0xC3: // jp nn
+    case 0xC9: // ret
+    case 0xCD: // call nn
+    case 0xD9: // reti
+        return 1;
+    default:
+        break;
+    }
+
+    switch ((cpu->mc_opcode >> 3) & 0x03)
+    {
+    case 0:
+        return !get_z(cpu);
+    case 1:
+        return get_z(cpu);
+    case 2:
+        return !get_c(cpu);
+    default:
+        return get_c(cpu);
+    }
+}
+
+static uint16_t get_wz(struct cpu *cpu)
+{
+    return cpu->mc_w << 8 | cpu->mc_z;
+}
+
+/* rr operand of ld rr,nn (x1), index 3 is SP */
+static uint16_t *rr_operand(struct cpu *cpu)
+{
+    switch ((cpu->mc_opcode >> 4) & 0x03)
+    {
+    case 0:
+        return &cpu->bc;
+    case 1:
+        return &cpu->de;
+    case 2:
+        return &cpu->hl;
+    default:
+        return &cpu->sp;
+    }
+}
+
+/* Operand of push and pop, index 3 is AF */
+static uint16_t stack_operand(struct cpu *cpu)
+{
+    if (((cpu->mc_opcode >> 4) & 0x03) == 3)
+        return cpu->a << 8 | get_f(cpu);
+    return *rr_operand(cpu);
+}
+
+static int uop_tick(struct gb_core *gb)
+{
+    tick_m(gb);
+    return MC_CONTINUE;
+}
+
+static int uop_tick_cc(struct gb_core *gb)
+{
+    tick_m(gb);
+    return condition(&gb->cpu) ? MC_CONTINUE : MC_DONE;
+}
+
+/* Second MCycle of an opcode whose handler does a single tick */
+static int uop_execute(struct gb_core *gb)
+{
+    execute_opcode(gb, gb->cpu.mc_opcode);
+    return MC_DONE;
+}
+
+static int uop_fetch_z(struct gb_core *gb)
+{
+    gb->cpu.mc_z = fetch_mem_tick(gb, gb->cpu.pc++);
+    return MC_CONTINUE;
+}
+
+static int uop_fetch_z_cc(struct gb_core *gb)
+{
+    uop_fetch_z(gb);
+    return condition(&gb->cpu) ? MC_CONTINUE : MC_DONE;
+}
+
+static int uop_fetch_w(struct gb_core *gb)
+{
+    gb->cpu.mc_w = fetch_mem_tick(gb, gb->cpu.pc++);
+    return MC_CONTINUE;
+}
+
+static int uop_fetch_w_cc(struct gb_core *gb)
+{
+    uop_fetch_w(gb);
+    return condition(&gb->cpu) ? MC_CONTINUE : MC_DONE;
+}
+
+static int uop_fetch_w_ld_rr(struct gb_core *gb)
+{
+    uop_fetch_w(gb);
+    *rr_operand(&gb->cpu) = get_wz(&gb->cpu);
+    return MC_DONE;
+}
+
+static int uop_read_hl(struct gb_core *gb)
+{
+    gb->cpu.mc_z = read_mem_tick(gb, gb->cpu.hl);
+    return MC_CONTINUE;
+}
+
+static int uop_write_hl(struct gb_core *gb)
+{
+    write_mem(gb, gb->cpu.hl, gb->cpu.mc_z);
+    return MC_DONE;
+}
+
+static int uop_inc_dec_write_hl(struct gb_core *gb)
+{
+    if (gb->cpu.mc_opcode == 0x34)
+        inc_r(gb, &gb->cpu.mc_z);
+    else
+        dec_r(gb, &gb->cpu.mc_z);
+    return uop_write_hl(gb);
+}
+
+static int uop_read_wz(struct gb_core *gb)
+{
+    gb->cpu.a = read_mem_tick(gb, get_wz(&gb->cpu));
+    return MC_DONE;
+}
+
+static int uop_write_wz(struct gb_core *gb)
+{
+    write_mem(gb, get_wz(&gb->cpu), gb->cpu.a);
+    return MC_DONE;
+}
+
+static int uop_write_wz_sp_lo(struct gb_core *gb)
+{
+    write_mem(gb, get_wz(&gb->cpu), regist_lo(&gb->cpu.sp));
+    return MC_CONTINUE;
+}
+
+static int uop_write_wz_sp_hi(struct gb_core *gb)
+{
+    write_mem(gb, get_wz(&gb->cpu) + 1, regist_hi(&gb->cpu.sp));
+    return MC_DONE;
+}
+
+static int uop_read_ff_z(struct gb_core *gb)
+{
+    gb->cpu.a = read_mem_tick(gb, 0xFF00 + gb->cpu.mc_z);
+    return MC_DONE;
+}
+
+static int uop_write_ff_z(struct gb_core *gb)
+{
+    write_mem(gb, 0xFF00 + gb->cpu.mc_z, gb->cpu.a);
+    return MC_DONE;
+}
+
+static int uop_jr(struct gb_core *gb)
+{
+    tick_m(gb);
+    gb->cpu.pc += (int8_t)gb->cpu.mc_z;
+    return MC_DONE;
+}
+
+static int uop_jump_wz(struct gb_core *gb)
+{
+    tick_m(gb);
+    gb->cpu.pc = get_wz(&gb->cpu);
+    return MC_DONE;
+}
+
+static int uop_reti(struct gb_core *gb)
+{
+    uop_jump_wz(gb);
+    gb->cpu.ime = 1;
+    return MC_DONE;
+}
+
+static int uop_pop_z(struct gb_core *gb)
+{
+    gb->cpu.mc_z = read_mem_tick(gb, gb->cpu.sp++);
+    return MC_CONTINUE;
+}
+
+static int uop_pop_w(struct gb_core *gb)
+{
+    gb->cpu.mc_w = read_mem_tick(gb, gb->cpu.sp++);
+    return MC_CONTINUE;
+}
+
+static int uop_pop_w_rr(struct gb_core *gb)
+{
+    uop_pop_w(gb);
+    *rr_operand(&gb->cpu) = get_wz(&gb->cpu);
+    return MC_DONE;
+}
+
+static int uop_pop_w_af(struct gb_core *gb)
+{
+    struct cpu *cpu = &gb->cpu;
+    set_z(cpu, cpu->mc_z >> 7 & 0x1);
+    set_n(cpu, cpu->mc_z >> 6 & 0x1);
+    set_h(cpu, cpu->mc_z >> 5 & 0x1);
+    set_c(cpu, cpu->mc_z >> 4 & 0x1);
+    cpu->a = read_mem_tick(gb, cpu->sp++);
+    return MC_DONE;
+}
+
+static int uop_push_hi(struct gb_core *gb)
+{
+    write_mem(gb, --gb->cpu.sp, stack_operand(&gb->cpu) >> 8);
+    return MC_CONTINUE;
+}
+
+static int uop_push_lo(struct gb_core *gb)
+{
+    write_mem(gb, --gb->cpu.sp, stack_operand(&gb->cpu) & 0xFF);
+    return MC_DONE;
+}
+
+static int uop_push_pc_hi(struct gb_core *gb)
+{
+    write_mem(gb, --gb->cpu.sp, regist_hi(&gb->cpu.pc));
+    return MC_CONTINUE;
+}
+
+static int uop_call(struct gb_core *gb)
+{
+    write_mem(gb, --gb->cpu.sp, regist_lo(&gb->cpu.pc));
+    gb->cpu.pc = get_wz(&gb->cpu);
+    return MC_DONE;
+}
+
+static int uop_rst(struct gb_core *gb)
+{
+    write_mem(gb, --gb->cpu.sp, regist_lo(&gb->cpu.pc));
+    gb->cpu.pc = gb->cpu.mc_opcode & 0x38;
+    return MC_DONE;
+}
+
+// add SP,e
+static int uop_add_sp(struct gb_core *gb)
+{
+    struct cpu *cpu = &gb->cpu;
+    int8_t offset = cpu->mc_z;
+    uint8_t lo = regist_lo(&cpu->sp);
+    tick_m(gb);
+    cflag_add_set(cpu, lo, offset);
+    hflag_add_set(cpu, lo, offset);
+    set_z(cpu, 0);
+    set_n(cpu, 0);
+    cpu->sp += offset;
+    return MC_CONTINUE;
+}
+
+// ld HL,SP+e
+static int uop_ld_hl_sp(struct gb_core *gb)
+{
+    struct cpu *cpu = &gb->cpu;
+    int8_t offset = cpu->mc_z;
+    uint8_t lo = regist_lo(&cpu->sp);
+    hflag_add_set(cpu, lo, offset);
+    cflag_add_set(cpu, lo, offset);
+    set_z(cpu, 0);
+    set_n(cpu, 0);
+    uint16_t res = cpu->sp + offset;
+    tick_m(gb);
+    cpu->hl = res;
+    return MC_DONE;
+}
+
+/* CB opcodes, mc_z holds the CB opcode and mc_w the (HL) operand */
+static int uop_cb_fetch(struct gb_core *gb)
+{
+    struct cpu *cpu = &gb->cpu;
+    cpu->mc_z = fetch_mem_tick(gb, cpu->pc++);
+    uint8_t operand = cpu->mc_z & 0x07;
+    if (operand == CB_HL_OPERAND)
+        return MC_CONTINUE;
+    prefix_execute(gb, cpu->mc_z, (uint8_t *)cpu + r_offsets[operand]);
+    return MC_DONE;
+}
+
+static int uop_cb_read_hl(struct gb_core *gb)
+{
+    struct cpu *cpu = &gb->cpu;
+    cpu->mc_w = read_mem_tick(gb, cpu->hl);
+    // bit n,(HL) doesn't write back
+    if (cpu->mc_z >> 6 != 1)
+        return MC_CONTINUE;
+    prefix_execute(gb, cpu->mc_z, &cpu->mc_w);
+    return MC_DONE;
+}
+
+static int uop_cb_write_hl(struct gb_core *gb)
+{
+    struct cpu *cpu = &gb->cpu;
+    prefix_execute(gb, cpu->mc_z, &cpu->mc_w);
+    write_mem(gb, cpu->hl, cpu->mc_w);
+    return MC_DONE;
+}
+
+/* Interrupt dispatch, mc_z holds the handler address */
+static int uop_int_start(struct gb_core *gb)
+{
+    gb->cpu.ime = 0;
+    tick_m(gb);
+    return MC_CONTINUE;
+}
+
+static int uop_int_push_hi(struct gb_core *gb)
+{
+    gb->cpu.pc -= gb->halt_bug;
+    gb->halt_bug = 0;
+    uop_push_pc_hi(gb);
+
+    /* Interrupt may be aborted from the previous upper SP push writing in IE */
+    gb->cpu.mc_z = acknowledge_interrupt(gb);
+    return MC_CONTINUE;
+}
+
+static int uop_int_push_lo(struct gb_core *gb)
+{
+    /* Lower SP push is too late to cancel even if it modifies IE */
+    write_mem(gb, --gb->cpu.sp, regist_lo(&gb->cpu.pc));
+    gb->cpu.pc = gb->cpu.mc_z;
+    return MC_CONTINUE;
+}
+
+static const uop_fn interrupt_program[MC_MAX_STEPS] = {
+    uop_int_start, uop_tick, uop_int_push_hi, uop_int_push_lo, uop_tick,
+};
+
+/*
+ * Micro-ops run after the opcode fetch MCycle, indexed by opcode. An empty program is a single MCycle instruction
+ * fully run right after its fetch.
+ */
+// clang-format off
+#define EXECUTE {uop_execute}
+static const uop_fn programs[256][MC_MAX_STEPS] = {
+    // ld rr,nn
+    [0x01] = {uop_fetch_z, uop_fetch_w_ld_rr},
+    [0x11] = {uop_fetch_z, uop_fetch_w_ld_rr},
+    [0x21] = {uop_fetch_z, uop_fetch_w_ld_rr},
+    [0x31] = {uop_fetch_z, uop_fetch_w_ld_rr},
+
+    // ld (rr),A and ld A,(rr)
+    [0x02] = EXECUTE, [0x12] = EXECUTE, [0x22] = EXECUTE, [0x32] = EXECUTE,
+    [0x0A] = EXECUTE, [0x1A] = EXECUTE, [0x2A] = EXECUTE, [0x3A] = EXECUTE,
+
+    // inc rr, dec rr and add HL,rr
+    [0x03] = EXECUTE, [0x13] = EXECUTE, [0x23] = EXECUTE, [0x33] = EXECUTE,
+    [0x0B] = EXECUTE, [0x1B] = EXECUTE, [0x2B] = EXECUTE, [0x3B] = EXECUTE,
+    [0x09] = EXECUTE, [0x19] = EXECUTE, [0x29] = EXECUTE, [0x39] = EXECUTE,
+
+    // ld r,n
+    [0x06] = EXECUTE, [0x0E] = EXECUTE, [0x16] = EXECUTE, [0x1E] = EXECUTE,
+    [0x26] = EXECUTE, [0x2E] = EXECUTE, [0x3E] = EXECUTE,
+
+    // ld (nn),SP
+    [0x08] = {uop_fetch_z, uop_fetch_w, uop_write_wz_sp_lo, uop_write_wz_sp_hi},
+
+    // inc (HL), dec (HL) and ld (HL),n
+    [0x34] = {uop_read_hl, uop_inc_dec_write_hl},
+    [0x35] = {uop_read_hl, uop_inc_dec_write_hl},
+    [0x36] = {uop_fetch_z, uop_write_hl},
+
+    // jr e and jr cc,e
+    [0x18] = {uop_fetch_z, uop_jr},
+    [0x20] = {uop_fetch_z_cc, uop_jr},
+    [0x28] = {uop_fetch_z_cc, uop_jr},
+    [0x30] = {uop_fetch_z_cc, uop_jr},
+    [0x38] = {uop_fetch_z_cc, uop_jr},
+
+    // ld r,(HL)
+    [0x46] = EXECUTE, [0x4E] = EXECUTE, [0x56] = EXECUTE, [0x5E] = EXECUTE,
+    [0x66] = EXECUTE, [0x6E] = EXECUTE, [0x7E] = EXECUTE,
+
+    // ld (HL),r
+    [0x70] = EXECUTE, [0x71] = EXECUTE, [0x72] = EXECUTE, [0x73] = EXECUTE,
+    [0x74] = EXECUTE, [0x75] = EXECUTE, [0x77] = EXECUTE,
+
+    // alu A,(HL) and alu A,n
+    [0x86] = EXECUTE, [0x8E] = EXECUTE, [0x96] = EXECUTE, [0x9E] = EXECUTE,
+    [0xA6] = EXECUTE, [0xAE] = EXECUTE, [0xB6] = EXECUTE, [0xBE] = EXECUTE,
+    [0xC6] = EXECUTE, [0xCE] = EXECUTE, [0xD6] = EXECUTE, [0xDE] = EXECUTE,
+    [0xE6] = EXECUTE, [0xEE] = EXECUTE, [0xF6] = EXECUTE, [0xFE] = EXECUTE,
+
+    // ret cc, ret and reti
+    [0xC0] = {uop_tick_cc, uop_pop_z, uop_pop_w, uop_jump_wz},
+    [0xC8] = {uop_tick_cc, uop_pop_z, uop_pop_w, uop_jump_wz},
+    [0xD0] = {uop_tick_cc, uop_pop_z, uop_pop_w, uop_jump_wz},
+    [0xD8] = {uop_tick_cc, uop_pop_z, uop_pop_w, uop_jump_wz},
+    [0xC9] = {uop_pop_z, uop_pop_w, uop_jump_wz},
+    [0xD9] = {uop_pop_z, uop_pop_w, uop_reti},
+
+    // pop rr
+    [0xC1] = {uop_pop_z, uop_pop_w_rr},
+    [0xD1] = {uop_pop_z, uop_pop_w_rr},
+    [0xE1] = {uop_pop_z, uop_pop_w_rr},
+    [0xF1] = {uop_pop_z, uop_pop_w_af},
+
+    // push rr
+    [0xC5] = {uop_tick, uop_push_hi, uop_push_lo},
+    [0xD5] = {uop_tick, uop_push_hi, uop_push_lo},
+    [0xE5] = {uop_tick, uop_push_hi, uop_push_lo},
+    [0xF5] = {uop_tick, uop_push_hi, uop_push_lo},
+
+    // jp nn and jp cc,nn
+    [0xC2] = {uop_fetch_z, uop_fetch_w_cc, uop_jump_wz},
+    [0xC3] = {uop_fetch_z, uop_fetch_w, uop_jump_wz},
+    [0xCA] = {uop_fetch_z, uop_fetch_w_cc, uop_jump_wz},
+    [0xD2] = {uop_fetch_z, uop_fetch_w_cc, uop_jump_wz},
+    [0xDA] = {uop_fetch_z, uop_fetch_w_cc, uop_jump_wz},
+
+    // call nn and call cc,nn
+    [0xC4] = {uop_fetch_z, uop_fetch_w_cc, uop_tick, uop_push_pc_hi, uop_call},
+    [0xCC] = {uop_fetch_z, uop_fetch_w_cc, uop_tick, uop_push_pc_hi, uop_call},
+    [0xCD] = {uop_fetch_z, uop_fetch_w, uop_tick, uop_push_pc_hi, uop_call},
+    [0xD4] = {uop_fetch_z, uop_fetch_w_cc, uop_tick, uop_push_pc_hi, uop_call},
+    [0xDC] = {uop_fetch_z, uop_fetch_w_cc, uop_tick, uop_push_pc_hi, uop_call},
+
+    // rst
+    [0xC7] = {uop_tick, uop_push_pc_hi, uop_rst},
+    [0xCF] = {uop_tick, uop_push_pc_hi, uop_rst},
+    [0xD7] = {uop_tick, uop_push_pc_hi, uop_rst},
+    [0xDF] = {uop_tick, uop_push_pc_hi, uop_rst},
+    [0xE7] = {uop_tick, uop_push_pc_hi, uop_rst},
+    [0xEF] = {uop_tick, uop_push_pc_hi, uop_rst},
+    [0xF7] = {uop_tick, uop_push_pc_hi, uop_rst},
+    [0xFF] = {uop_tick, uop_push_pc_hi, uop_rst},
+
+    // CB prefix
+    [0xCB] = {uop_cb_fetch, uop_cb_read_hl, uop_cb_write_hl},
+
+    // ldh (n),A, ldh A,(n), ldh (C),A and ldh A,(C)
+    [0xE0] = {uop_fetch_z, uop_write_ff_z},
+    [0xF0] = {uop_fetch_z, uop_read_ff_z},
+    [0xE2] = EXECUTE,
+    [0xF2] = EXECUTE,
+
+    // ld (nn),A and ld A,(nn)
+    [0xEA] = {uop_fetch_z, uop_fetch_w, uop_write_wz},
+    [0xFA] = {uop_fetch_z, uop_fetch_w, uop_read_wz},
+
+    // add SP,e, ld HL,SP+e and ld SP,HL
+    [0xE8] = {uop_fetch_z, uop_add_sp, uop_tick},
+    [0xF8] = {uop_fetch_z, uop_ld_hl_sp},
+    [0xF9] = EXECUTE,
+};
+#undef EXECUTE
+// clang-format on
+
+/* Instruction boundary, an interrupt dispatch may start right away */
+static void end_instruction(struct gb_core *gb)
+{
+    gb->cpu.mc_program = MC_NONE;
+    if (poll_interrupt(gb))
+    {
+        gb->cpu.mc_program = MC_INTERRUPT;
+        gb->cpu.mc_step = 0;
+    }
+}
+
+static int start_instruction(struct gb_core *gb)
+{
+    struct cpu *cpu = &gb->cpu;
+
+    if (gb->halt)
+    {
+        tick_m(gb);
+        end_instruction(gb);
+        return EXIT_SUCCESS;
+    }
+
+    uint8_t opcode = fetch_opcode(gb);
+    if (!programs[opcode][0])
+    {
+        if (execute_opcode(gb, opcode) == -1)
+            return EXIT_FAILURE;
+        end_instruction(gb);
+        return EXIT_SUCCESS;
+    }
+
+    cpu->mc_program = MC_OPCODE;
+    cpu->mc_opcode = opcode;
+    cpu->mc_step = 0;
+    return EXIT_SUCCESS;
+}
+
+static void step(struct gb_core *gb)
+{
+    struct cpu *cpu = &gb->cpu;
+    const uop_fn *program = cpu->mc_program == MC_INTERRUPT ? interrupt_program : programs[cpu->mc_opcode];
+
+    int done = program[cpu->mc_step++](gb) == MC_DONE;
+    if (!done && cpu->mc_step < MC_MAX_STEPS && program[cpu->mc_step])
+        return;
+
+    /* Like check_interrupt(), nothing is polled right after a dispatch */
+    if (cpu->mc_program == MC_INTERRUPT)
+        cpu->mc_program = MC_NONE;
+    else
+        end_instruction(gb);
+}
+
+int microcode_run(struct gb_core *gb, int mcycles)
+{
+    for (int i = 0; i < mcycles; ++i)
+    {
+        if (gb->cpu.mc_program != MC_NONE)
+            step(gb);
+        else if (start_instruction(gb))
+            return -1;
+    }
+    return mcycles;
+}
@@ -0,0 +1,51 @@
+#include "obj_lines.h"
+
+#include <string.h>
+
+/* Same condition as the OAM scan: X is not 0 and LY + 16 is in [Y, Y + height) */
+static void obj_lines_set(struct obj_lines *cache, unsigned int entry, uint8_t y, int on)
+{
+    uint64_t bit = (uint64_t)1 << entry;
+    int first = y - 16;
+    int end = first + cache->height;
+    if (first < 0)
+        first = 0;
+    if (end > SCREEN_HEIGHT)
+        end = SCREEN_HEIGHT;
+    for (int line = first; line < end; ++line)
+    {
+        if (on)
+            cache->lines[line] |= bit;
+        else
+            cache->lines[line] &= ~bit;
+    }
+}
+
+void obj_lines_update(struct obj_lines *cache, const uint8_t *oam, uint8_t height)
+{
+    if (cache->height != height)
+    {
+        memset(cache->lines, 0, sizeof(cache->lines));
+        memset(cache->y, 0, sizeof(cache->y));
+        cache->dirty = ((uint64_t)1 << OBJ_ENTRIES) - 1;
+        cache->height = height;
+    }
+
+    for (unsigned int entry = 0; cache->dirty; ++entry, cache->dirty >>= 1)
+    {
+        if (!(cache->dirty & 0x01))
+            continue;
+        if (cache->y[entry])
+            obj_lines_set(cache, entry, cache->y[entry], 0);
+        cache->y[entry] = oam[entry * 4 + 1] != 0 ? oam[entry * 4] : 0;
+        if (cache->y[entry])
+            obj_lines_set(cache, entry, cache->y[entry], 1);
+    }
+}
+
+void obj_lines_invalidate_range(struct obj_lines *cache, uint8_t offset, uint32_t length)
+{
+    uint32_t end = offset + length;
+    for (uint32_t entry = offset / 4; entry < OBJ_ENTRIES && entry * 4 < end; ++entry)
+        cache->dirty |= (uint64_t)1 << entry;
+}
@@ -1,6 +1,7 @@
 #include <err.h>
 
 #include "gb_core.h"
+#include "timers.h"
 #include "utils.h"
 
 // nop
@@ -14,22 +15,17 @@ int nop(void)
 // x10	1 MCycle
 int stop(struct gb_core *gb)
 {
+    apu_catch_up(gb);
+    timer_catch_up(gb);
     gb->stop = 1;
-    gb->internal_div = 0;
+    timer_set_div(gb, 0);
     return 1;
 }
 
-static int pending_interrupt(struct gb_core *gb)
-{
-    if (gb->memory.io[IO_OFFSET(IF)] & gb->memory.ie & 0x1F)
-        return 1;
-    return 0;
-}
-
 // halt
 int halt(struct gb_core *gb)
 {
-    if (gb->cpu.ime != 1 && pending_interrupt(gb))
+    if (gb->cpu.ime != 1 && gb->pending_interrupts)
         gb->halt_bug = 1;
     else
         gb->halt = 1;
@@ -42,7 +38,7 @@ int ccf(struct gb_core *gb)
 {
     set_n(&gb->cpu, 0);
     set_h(&gb->cpu, 0);
-    gb->cpu.f ^= 0x10;
+    set_c(&gb->cpu, !get_c(&gb->cpu));
     return 1;
 }
 
@@ -1,6 +1,7 @@
 #include <err.h>
 
 #include "emulation.h"
+#include "fetch.h"
 #include "gb_core.h"
 #include "read.h"
 #include "utils.h"
@@ -10,7 +11,7 @@
 // x18	3 MCycle
 int jr_e8(struct gb_core *gb)
 {
-    int8_t e = read_mem_tick(gb, gb->cpu.pc++);
+    int8_t e = fetch_mem_tick(gb, gb->cpu.pc++);
     tick_m(gb);
     gb->cpu.pc = gb->cpu.pc + e;
     return 3;
@@ -19,7 +20,7 @@ int jr_e8(struct gb_core *gb)
 // jr cc e (signed 8 bit)
 int jr_cc_e8(struct gb_core *gb, int cc)
 {
-    int8_t e = read_mem_tick(gb, gb->cpu.pc++);
+    int8_t e = fetch_mem_tick(gb, gb->cpu.pc++);
     if (cc)
     {
         tick_m(gb);
@@ -69,15 +70,15 @@ int reti(struct gb_core *gb)
 // 0xE9 1 MCycle
 int jp_hl(struct gb_core *gb)
 {
-    uint16_t address = convert_8to16(&gb->cpu.h, &gb->cpu.l);
+    uint16_t address = gb->cpu.hl;
     gb->cpu.pc = address;
     return 1;
 }
 
 int jp_nn(struct gb_core *gb)
 {
-    uint8_t lo = read_mem_tick(gb, gb->cpu.pc++);
-    uint8_t hi = read_mem_tick(gb, gb->cpu.pc);
+    uint8_t lo = fetch_mem_tick(gb, gb->cpu.pc++);
+    uint8_t hi = fetch_mem_tick(gb, gb->cpu.pc);
     uint16_t address = convert_8to16(&hi, &lo);
     tick_m(gb);
     gb->cpu.pc = address;
@@ -86,8 +87,8 @@ int jp_nn(struct gb_core *gb)
 
 int jp_cc_nn(struct gb_core *gb, int cc)
 {
-    uint8_t lo = read_mem_tick(gb, gb->cpu.pc++);
-    uint8_t hi = read_mem_tick(gb, gb->cpu.pc++);
+    uint8_t lo = fetch_mem_tick(gb, gb->cpu.pc++);
+    uint8_t hi = fetch_mem_tick(gb, gb->cpu.pc++);
     uint16_t address = convert_8to16(&hi, &lo);
     if (cc)
     {
@@ -100,8 +101,8 @@ int jp_cc_nn(struct gb_core *gb, int cc)
 
 int call_nn(struct gb_core *gb)
 {
-    uint8_t lo = read_mem_tick(gb, gb->cpu.pc++);
-    uint8_t hi = read_mem_tick(gb, gb->cpu.pc++);
+    uint8_t lo = fetch_mem_tick(gb, gb->cpu.pc++);
+    uint8_t hi = fetch_mem_tick(gb, gb->cpu.pc++);
     uint16_t nn = convert_8to16(&hi, &lo);
     tick_m(gb);
     write_mem(gb, --gb->cpu.sp, regist_hi(&gb->cpu.pc));
@@ -112,8 +113,8 @@ int call_nn(struct gb_core *gb)
 
 int call_cc_nn(struct gb_core *gb, int cc)
 {
-    uint8_t lo = read_mem_tick(gb, gb->cpu.pc++);
-    uint8_t hi = read_mem_tick(gb, gb->cpu.pc++);
+    uint8_t lo = fetch_mem_tick(gb, gb->cpu.pc++);
+    uint8_t hi = fetch_mem_tick(gb, gb->cpu.pc++);
     uint16_t nn = convert_8to16(&hi, &lo);
     if (cc)
     {
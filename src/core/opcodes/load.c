@@ -1,6 +1,7 @@
 #include <err.h>
 
 #include "emulation.h"
+#include "fetch.h"
 #include "gb_core.h"
 #include "read.h"
 #include "utils.h"
@@ -8,11 +9,9 @@
 
 // ld (rr),a
 // x(0-1)2	2 MCycle
-int ld_rr_a(struct gb_core *gb, uint8_t *hi, uint8_t *lo)
+int ld_rr_a(struct gb_core *gb, uint16_t *rr)
 {
-    uint16_t address = 0;
-    address = convert_8to16(hi, lo);
-    write_mem(gb, address, gb->cpu.a);
+    write_mem(gb, *rr, gb->cpu.a);
     return 2;
 }
 
@@ -29,7 +28,7 @@ int ld_r_r(struct gb_core *gb, uint8_t *dest, uint8_t *src)
 // x(0-3)(6 or E)	2 MCycle
 int ld_r_u8(struct gb_core *gb, uint8_t *dest)
 {
-    *dest = read_mem_tick(gb, gb->cpu.pc++);
+    *dest = fetch_mem_tick(gb, gb->cpu.pc++);
     return 2;
 }
 
@@ -37,19 +36,17 @@ int ld_r_u8(struct gb_core *gb, uint8_t *dest)
 // x36   3 MCycle
 int ld_hl_u8(struct gb_core *gb)
 {
-    uint16_t address = convert_8to16(&gb->cpu.h, &gb->cpu.l);
-    uint8_t n = read_mem_tick(gb, gb->cpu.pc++);
+    uint16_t address = gb->cpu.hl;
+    uint8_t n = fetch_mem_tick(gb, gb->cpu.pc++);
     write_mem(gb, address, n);
     return 3;
 }
 
 // ld a,(rr)
 // x(0-1)A	2 MCycle
-int ld_a_rr(struct gb_core *gb, uint8_t *hi, uint8_t *lo)
+int ld_a_rr(struct gb_core *gb, uint16_t *rr)
 {
-    uint16_t address = convert_8to16(hi, lo);
-    uint8_t n = read_mem_tick(gb, address);
-    gb->cpu.a = n;
+    gb->cpu.a = read_mem_tick(gb, *rr);
     return 2;
 }
 
@@ -57,7 +54,7 @@ int ld_a_rr(struct gb_core *gb, uint8_t *hi, uint8_t *lo)
 // x7(0-5)   2 MCycle
 int ld_hl_r(struct gb_core *gb, uint8_t *src)
 {
-    uint16_t address = convert_8to16(&gb->cpu.h, &gb->cpu.l);
+    uint16_t address = gb->cpu.hl;
     write_mem(gb, address, *src);
     return 2;
 }
@@ -66,7 +63,7 @@ int ld_hl_r(struct gb_core *gb, uint8_t *src)
 //		2 MCycle
 int ld_r_hl(struct gb_core *gb, uint8_t *dest)
 {
-    uint16_t address = convert_8to16(&gb->cpu.h, &gb->cpu.l);
+    uint16_t address = gb->cpu.hl;
     uint8_t value = read_mem_tick(gb, address);
     *dest = value;
     return 2;
@@ -76,8 +73,8 @@ int ld_r_hl(struct gb_core *gb, uint8_t *dest)
 // xEA   4 MCycle
 int ld_nn_a(struct gb_core *gb)
 {
-    uint8_t lo = read_mem_tick(gb, gb->cpu.pc++);
-    uint8_t hi = read_mem_tick(gb, gb->cpu.pc++);
+    uint8_t lo = fetch_mem_tick(gb, gb->cpu.pc++);
+    uint8_t hi = fetch_mem_tick(gb, gb->cpu.pc++);
     uint16_t address = convert_8to16(&hi, &lo);
     write_mem(gb, address, gb->cpu.a);
     return 4;
@@ -87,8 +84,8 @@ int ld_nn_a(struct gb_core *gb)
 // xFA   4 MCycle
 int ld_a_nn(struct gb_core *gb)
 {
-    uint8_t lo = read_mem_tick(gb, gb->cpu.pc++);
-    uint8_t hi = read_mem_tick(gb, gb->cpu.pc++);
+    uint8_t lo = fetch_mem_tick(gb, gb->cpu.pc++);
+    uint8_t hi = fetch_mem_tick(gb, gb->cpu.pc++);
     uint16_t address = convert_8to16(&hi, &lo);
     gb->cpu.a = read_mem_tick(gb, address);
     return 4;
@@ -98,11 +95,7 @@ int ld_a_nn(struct gb_core *gb)
 // x22	2 MCycle
 int ldi_hl_a(struct gb_core *gb)
 {
-    uint16_t address = convert_8to16(&gb->cpu.h, &gb->cpu.l);
-    write_mem(gb, address, gb->cpu.a);
-    ++address;
-    gb->cpu.h = regist_hi(&address);
-    gb->cpu.l = regist_lo(&address);
+    write_mem(gb, gb->cpu.hl++, gb->cpu.a);
     return 2;
 }
 
@@ -110,11 +103,7 @@ int ldi_hl_a(struct gb_core *gb)
 // x32	2 MCycle
 int ldd_hl_a(struct gb_core *gb)
 {
-    uint16_t address = convert_8to16(&gb->cpu.h, &gb->cpu.l);
-    write_mem(gb, address, gb->cpu.a);
-    --address;
-    gb->cpu.h = regist_hi(&address);
-    gb->cpu.l = regist_lo(&address);
+    write_mem(gb, gb->cpu.hl--, gb->cpu.a);
     return 2;
 }
 
@@ -122,11 +111,7 @@ int ldd_hl_a(struct gb_core *gb)
 // x2A	2 MCycle
 int ldi_a_hl(struct gb_core *gb)
 {
-    uint16_t address = convert_8to16(&gb->cpu.h, &gb->cpu.l);
-    gb->cpu.a = read_mem_tick(gb, address);
-    ++address;
-    gb->cpu.h = regist_hi(&address);
-    gb->cpu.l = regist_lo(&address);
+    gb->cpu.a = read_mem_tick(gb, gb->cpu.hl++);
     return 2;
 }
 
@@ -134,11 +119,7 @@ int ldi_a_hl(struct gb_core *gb)
 // x3A	2 MCycle
 int ldd_a_hl(struct gb_core *gb)
 {
-    uint16_t address = convert_8to16(&gb->cpu.h, &gb->cpu.l);
-    gb->cpu.a = read_mem_tick(gb, address);
-    --address;
-    gb->cpu.h = regist_hi(&address);
-    gb->cpu.l = regist_lo(&address);
+    gb->cpu.a = read_mem_tick(gb, gb->cpu.hl--);
     return 2;
 }
 
@@ -148,10 +129,11 @@ int ldd_a_hl(struct gb_core *gb)
 
 // ld rr,nn
 // x(0-2)1	3 MCycle
-int ld_rr_nn(struct gb_core *gb, uint8_t *hi, uint8_t *lo)
+int ld_rr_nn(struct gb_core *gb, uint16_t *rr)
 {
-    *lo = read_mem_tick(gb, gb->cpu.pc++);
-    *hi = read_mem_tick(gb, gb->cpu.pc++);
+    uint8_t lo = fetch_mem_tick(gb, gb->cpu.pc++);
+    uint8_t hi = fetch_mem_tick(gb, gb->cpu.pc++);
+    *rr = convert_8to16(&hi, &lo);
     return 3;
 }
 
@@ -159,8 +141,8 @@ int ld_rr_nn(struct gb_core *gb, uint8_t *hi, uint8_t *lo)
 // x31	3 MCycle
 int ld_sp_nn(struct gb_core *gb)
 {
-    uint8_t lo = read_mem_tick(gb, gb->cpu.pc++);
-    uint8_t hi = read_mem_tick(gb, gb->cpu.pc++);
+    uint8_t lo = fetch_mem_tick(gb, gb->cpu.pc++);
+    uint8_t hi = fetch_mem_tick(gb, gb->cpu.pc++);
     gb->cpu.sp = convert_8to16(&hi, &lo);
     return 3;
 }
@@ -169,8 +151,8 @@ int ld_sp_nn(struct gb_core *gb)
 // x08	5 MCycle
 int ld_nn_sp(struct gb_core *gb)
 {
-    uint8_t lo = read_mem_tick(gb, gb->cpu.pc++);
-    uint8_t hi = read_mem_tick(gb, gb->cpu.pc++);
+    uint8_t lo = fetch_mem_tick(gb, gb->cpu.pc++);
+    uint8_t hi = fetch_mem_tick(gb, gb->cpu.pc++);
     uint16_t address = convert_8to16(&hi, &lo);
     write_mem(gb, address, regist_lo(&gb->cpu.sp));
     write_mem(gb, address + 1, regist_hi(&gb->cpu.sp));
@@ -181,7 +163,7 @@ int ld_nn_sp(struct gb_core *gb)
 // xF8   3 MCycle
 int ld_hl_spe8(struct gb_core *gb)
 {
-    int8_t offset = read_mem_tick(gb, gb->cpu.pc++);
+    int8_t offset = fetch_mem_tick(gb, gb->cpu.pc++);
     uint8_t lo = regist_lo(&gb->cpu.sp);
     hflag_add_set(&gb->cpu, lo, offset);
     cflag_add_set(&gb->cpu, lo, offset);
@@ -189,8 +171,7 @@ int ld_hl_spe8(struct gb_core *gb)
     set_n(&gb->cpu, 0);
     uint16_t res = gb->cpu.sp + offset;
     tick_m(gb);
-    gb->cpu.h = regist_hi(&res);
-    gb->cpu.l = regist_lo(&res);
+    gb->cpu.hl = res;
     return 3;
 }
 
@@ -198,21 +179,21 @@ int ld_hl_spe8(struct gb_core *gb)
 // xF9   2 MCycle
 int ld_sp_hl(struct gb_core *gb)
 {
-    gb->cpu.sp = convert_8to16(&gb->cpu.h, &gb->cpu.l);
+    gb->cpu.sp = gb->cpu.hl;
     tick_m(gb);
     return 2;
 }
 
 int ldh_n_a(struct gb_core *gb)
 {
-    uint8_t offset = read_mem_tick(gb, gb->cpu.pc++);
+    uint8_t offset = fetch_mem_tick(gb, gb->cpu.pc++);
     write_mem(gb, 0xFF00 + offset, gb->cpu.a);
     return 3;
 }
 
 int ldh_a_n(struct gb_core *gb)
 {
-    uint8_t offset = read_mem_tick(gb, gb->cpu.pc++);
+    uint8_t offset = fetch_mem_tick(gb, gb->cpu.pc++);
     gb->cpu.a = read_mem_tick(gb, 0xFF00 + offset);
     return 3;
 }
@@ -229,12 +210,11 @@ int ldh_c_a(struct gb_core *gb)
     return 2;
 }
 
-int pop_rr(struct gb_core *gb, uint8_t *hi, uint8_t *lo)
+int pop_rr(struct gb_core *gb, uint16_t *rr)
 {
-    uint8_t _lo = read_mem_tick(gb, gb->cpu.sp++);
-    uint8_t _hi = read_mem_tick(gb, gb->cpu.sp++);
-    *lo = _lo;
-    *hi = _hi;
+    uint8_t lo = read_mem_tick(gb, gb->cpu.sp++);
+    uint8_t hi = read_mem_tick(gb, gb->cpu.sp++);
+    *rr = convert_8to16(&hi, &lo);
     return 3;
 }
 
@@ -250,10 +230,18 @@ int pop_af(struct gb_core *gb)
     return 3;
 }
 
-int push_rr(struct gb_core *gb, uint8_t *hi, uint8_t *lo)
+int push_rr(struct gb_core *gb, uint16_t *rr)
+{
+    tick_m(gb);
+    write_mem(gb, --gb->cpu.sp, regist_hi(rr));
+    write_mem(gb, --gb->cpu.sp, regist_lo(rr));
+    return 4;
+}
+
+int push_af(struct gb_core *gb)
 {
     tick_m(gb);
-    write_mem(gb, --gb->cpu.sp, *hi);
-    write_mem(gb, --gb->cpu.sp, *lo);
+    write_mem(gb, --gb->cpu.sp, gb->cpu.a);
+    write_mem(gb, --gb->cpu.sp, get_f(&gb->cpu));
     return 4;
 }
@@ -1,19 +1,44 @@
 #include <err.h>
 
 #include "emulation.h"
+#include "fetch.h"
 #include "gb_core.h"
 #include "read.h"
 #include "utils.h"
 #include "write.h"
 
+static inline void alu_add(struct cpu *cpu, uint8_t val, int carry)
+{
+    uint16_t result = cpu->a + val + carry;
+    flags_set_lazy(cpu, FLAGS_ADD, cpu->a, val, result);
+    cpu->a = result;
+}
+
+static inline void alu_sub(struct cpu *cpu, uint8_t val, int carry)
+{
+    uint16_t result = cpu->a - val - carry;
+    flags_set_lazy(cpu, FLAGS_SUB, cpu->a, val, result);
+    cpu->a = result;
+}
+
+static inline void alu_cp(struct cpu *cpu, uint8_t val)
+{
+    flags_set_lazy(cpu, FLAGS_SUB, cpu->a, val, cpu->a - val);
+}
+
+static inline void alu_logic(struct cpu *cpu, uint8_t kind, uint8_t result)
+{
+    cpu->a = result;
+    flags_set_lazy(cpu, kind, 0, 0, result);
+}
+
 // inc r (8 bit)
 // x(0-3)(4 or C)	1 MCycle
 int inc_r(struct gb_core *gb, uint8_t *dest)
 {
-    set_n(&gb->cpu, 0);
-    hflag_add_set(&gb->cpu, *dest, 1);
-    *dest += 1;
-    set_z(&gb->cpu, *dest == 0);
+    uint8_t value = *dest;
+    *dest = value + 1;
+    flags_set_lazy(&gb->cpu, FLAGS_INC, value, 1, *dest);
     return 1;
 }
 
@@ -21,26 +46,20 @@ int inc_r(struct gb_core *gb, uint8_t *dest)
 // x34	3 MCycle
 int inc_hl(struct gb_core *gb)
 {
-    set_n(&gb->cpu, 0);
-    uint16_t address = convert_8to16(&gb->cpu.h, &gb->cpu.l);
+    uint16_t address = gb->cpu.hl;
     uint8_t value = read_mem_tick(gb, address);
-    hflag_add_set(&gb->cpu, value, 1);
-    ++value;
-    write_mem(gb, address, value);
-    set_z(&gb->cpu, value == 0);
+    flags_set_lazy(&gb->cpu, FLAGS_INC, value, 1, (uint8_t)(value + 1));
+    write_mem(gb, address, value + 1);
     return 3;
 }
 
 // inc rr
 // x(0-3)3	2 MCycle
-int inc_rr(struct gb_core *gb, uint8_t *hi, uint8_t *lo)
+int inc_rr(struct gb_core *gb, uint16_t *rr)
 {
     // During fetch of the opcode probably writes to lo
-    uint16_t convert = convert_8to16(hi, lo);
-    ++convert;
+    ++*rr;
     tick_m(gb);
-    *lo = regist_lo(&convert);
-    *hi = regist_hi(&convert);
     return 2;
 }
 
@@ -58,10 +77,9 @@ int inc_sp(struct gb_core *gb)
 // x(0-3)(5 or D)	1 MCycle
 int dec_r(struct gb_core *gb, uint8_t *dest)
 {
-    set_n(&gb->cpu, 1);
-    hflag_sub_set(&gb->cpu, *dest, 1);
-    *dest -= 1;
-    set_z(&gb->cpu, *dest == 0);
+    uint8_t value = *dest;
+    *dest = value - 1;
+    flags_set_lazy(&gb->cpu, FLAGS_DEC, value, 1, *dest);
     return 1;
 }
 
@@ -69,26 +87,20 @@ int dec_r(struct gb_core *gb, uint8_t *dest)
 // x35	3 MCycle
 int dec_hl(struct gb_core *gb)
 {
-    set_n(&gb->cpu, 1);
-    uint16_t address = convert_8to16(&gb->cpu.h, &gb->cpu.l);
+    uint16_t address = gb->cpu.hl;
     uint8_t value = read_mem_tick(gb, address);
-    hflag_sub_set(&gb->cpu, value, 1);
-    --value;
-    write_mem(gb, address, value);
-    set_z(&gb->cpu, value == 0);
+    flags_set_lazy(&gb->cpu, FLAGS_DEC, value, 1, (uint8_t)(value - 1));
+    write_mem(gb, address, value - 1);
     return 3;
 }
 
 // dec rr
 // x(0-2)B	2MCycle
-int dec_rr(struct gb_core *gb, uint8_t *hi, uint8_t *lo)
+int dec_rr(struct gb_core *gb, uint16_t *rr)
 {
     // During fetch of the opcode probably writes to lo
-    uint16_t temp = convert_8to16(hi, lo);
-    --temp;
+    --*rr;
     tick_m(gb);
-    *lo = regist_lo(&temp);
-    *hi = regist_hi(&temp);
     return 2;
 }
 
@@ -106,11 +118,7 @@ int dec_sp(struct gb_core *gb)
 // x8(0-7)   1 MCycle
 int add_a_r(struct gb_core *gb, uint8_t *src)
 {
-    set_n(&gb->cpu, 0);
-    hflag_add_set(&gb->cpu, gb->cpu.a, *src);
-    cflag_add_set(&gb->cpu, gb->cpu.a, *src);
-    gb->cpu.a += *src;
-    set_z(&gb->cpu, gb->cpu.a == 0);
+    alu_add(&gb->cpu, *src, 0);
     return 1;
 }
 
@@ -118,13 +126,8 @@ int add_a_r(struct gb_core *gb, uint8_t *src)
 // x86   2 MCycle
 int add_a_hl(struct gb_core *gb)
 {
-    set_n(&gb->cpu, 0);
-    uint16_t address = convert_8to16(&gb->cpu.h, &gb->cpu.l);
-    uint8_t val = read_mem_tick(gb, address);
-    hflag_add_set(&gb->cpu, gb->cpu.a, val);
-    cflag_add_set(&gb->cpu, gb->cpu.a, val);
-    gb->cpu.a += val;
-    set_z(&gb->cpu, gb->cpu.a == 0);
+    uint8_t val = read_mem_tick(gb, gb->cpu.hl);
+    alu_add(&gb->cpu, val, 0);
     return 2;
 }
 
@@ -132,13 +135,8 @@ int add_a_hl(struct gb_core *gb)
 // xC6   2 MCycle
 int add_a_n(struct gb_core *gb)
 {
-    uint8_t n = read_mem_tick(gb, gb->cpu.pc);
-    set_n(&gb->cpu, 0);
-    hflag_add_set(&gb->cpu, gb->cpu.a, n);
-    cflag_add_set(&gb->cpu, gb->cpu.a, n);
-    gb->cpu.a += n;
-    set_z(&gb->cpu, gb->cpu.a == 0);
-    ++gb->cpu.pc;
+    uint8_t n = fetch_mem_tick(gb, gb->cpu.pc++);
+    alu_add(&gb->cpu, n, 0);
     return 2;
 }
 
@@ -146,21 +144,7 @@ int add_a_n(struct gb_core *gb)
 // x     1 MCycle
 int adc_a_r(struct gb_core *gb, uint8_t *src)
 {
-    uint8_t a_copy = gb->cpu.a;
-    set_n(&gb->cpu, 0);
-    uint8_t val = *src;
-    int temp = gb->cpu.a + val;
-    gb->cpu.a += val;
-    if (get_c(&gb->cpu))
-    {
-        ++temp;
-        ++gb->cpu.a;
-        set_h(&gb->cpu, (((a_copy & 0xF) + (val & 0xF) + (1 & 0xF)) & 0x10) == 0x10);
-    }
-    else
-        set_h(&gb->cpu, (((a_copy & 0xF) + (val & 0xF)) & 0x10) == 0x10);
-    set_c(&gb->cpu, temp > 0xFF);
-    set_z(&gb->cpu, gb->cpu.a == 0);
+    alu_add(&gb->cpu, *src, get_c(&gb->cpu));
     return 1;
 }
 
@@ -168,22 +152,8 @@ int adc_a_r(struct gb_core *gb, uint8_t *src)
 // x8E   2 MCycle
 int adc_a_hl(struct gb_core *gb)
 {
-    uint8_t a_copy = gb->cpu.a;
-    set_n(&gb->cpu, 0);
-    uint16_t address = convert_8to16(&gb->cpu.h, &gb->cpu.l);
-    uint8_t val = read_mem_tick(gb, address);
-    int temp = gb->cpu.a + val;
-    gb->cpu.a += val;
-    if (get_c(&gb->cpu))
-    {
-        ++temp;
-        ++gb->cpu.a;
-        set_h(&gb->cpu, (((a_copy & 0xF) + (val & 0xF) + (1 & 0xF)) & 0x10) == 0x10);
-    }
-    else
-        set_h(&gb->cpu, (((a_copy & 0xF) + (val & 0xF)) & 0x10) == 0x10);
-    set_c(&gb->cpu, temp > 0xFF);
-    set_z(&gb->cpu, gb->cpu.a == 0);
+    uint8_t val = read_mem_tick(gb, gb->cpu.hl);
+    alu_add(&gb->cpu, val, get_c(&gb->cpu));
     return 2;
 }
 
@@ -191,38 +161,20 @@ int adc_a_hl(struct gb_core *gb)
 // xCE   2 MCycle
 int adc_a_n(struct gb_core *gb)
 {
-    uint8_t a_copy = gb->cpu.a;
-    uint8_t val = read_mem_tick(gb, gb->cpu.pc);
-    set_n(&gb->cpu, 0);
-    int temp = gb->cpu.a + val;
-    gb->cpu.a += val;
-    if (get_c(&gb->cpu))
-    {
-        ++temp;
-        ++gb->cpu.a;
-        set_h(&gb->cpu, (((a_copy & 0xF) + (val & 0xF) + (1 & 0xF)) & 0x10) == 0x10);
-    }
-    else
-        set_h(&gb->cpu, (((a_copy & 0xF) + (val & 0xF)) & 0x10) == 0x10);
-    set_c(&gb->cpu, temp > 0xFF);
-    set_z(&gb->cpu, gb->cpu.a == 0);
-    ++gb->cpu.pc;
+    uint8_t n = fetch_mem_tick(gb, gb->cpu.pc++);
+    alu_add(&gb->cpu, n, get_c(&gb->cpu));
     return 2;
 }
 
 // add HL,rr
 // x(0-2)9	2 MCycle
-int add_hl_rr(struct gb_core *gb, uint8_t *hi, uint8_t *lo)
+int add_hl_rr(struct gb_core *gb, uint16_t *rr)
 {
     // During fetch of the opcode probably writes to lo
     set_n(&gb->cpu, 0);
-    uint16_t hl = convert_8to16(&gb->cpu.h, &gb->cpu.l);
-    uint16_t rr = convert_8to16(hi, lo);
-    hflag16_add_set(&gb->cpu, hl, rr);
-    cflag16_add_set(&gb->cpu, hl, rr);
-    uint16_t sum = hl + rr;
-    gb->cpu.h = regist_hi(&sum);
-    gb->cpu.l = regist_lo(&sum);
+    hflag16_add_set(&gb->cpu, gb->cpu.hl, *rr);
+    cflag16_add_set(&gb->cpu, gb->cpu.hl, *rr);
+    gb->cpu.hl += *rr;
     tick_m(gb);
     return 2;
 }
@@ -233,19 +185,16 @@ int add_hl_sp(struct gb_core *gb)
 {
     // During fetch of the opcode probably writes to lo
     set_n(&gb->cpu, 0);
-    uint16_t hl = convert_8to16(&gb->cpu.h, &gb->cpu.l);
-    hflag16_add_set(&gb->cpu, hl, gb->cpu.sp);
-    cflag16_add_set(&gb->cpu, hl, gb->cpu.sp);
-    uint16_t sum = hl + gb->cpu.sp;
-    gb->cpu.h = regist_hi(&sum);
-    gb->cpu.l = regist_lo(&sum);
+    hflag16_add_set(&gb->cpu, gb->cpu.hl, gb->cpu.sp);
+    cflag16_add_set(&gb->cpu, gb->cpu.hl, gb->cpu.sp);
+    gb->cpu.hl += gb->cpu.sp;
     tick_m(gb);
     return 2;
 }
 
 int add_sp_e8(struct gb_core *gb)
 {
-    int8_t offset = read_mem_tick(gb, gb->cpu.pc);
+    int8_t offset = fetch_mem_tick(gb, gb->cpu.pc);
     uint8_t lo = regist_lo(&gb->cpu.sp);
     tick_m(gb);
     cflag_add_set(&gb->cpu, lo, offset);
@@ -261,11 +210,7 @@ int add_sp_e8(struct gb_core *gb)
 // x(0-7)9   1 MCycle
 int sub_a_r(struct gb_core *gb, uint8_t *src)
 {
-    set_n(&gb->cpu, 1);
-    cflag_sub_set(&gb->cpu, gb->cpu.a, *src);
-    hflag_sub_set(&gb->cpu, gb->cpu.a, *src);
-    gb->cpu.a -= *src;
-    set_z(&gb->cpu, gb->cpu.a == 0);
+    alu_sub(&gb->cpu, *src, 0);
     return 1;
 }
 
@@ -273,25 +218,15 @@ int sub_a_r(struct gb_core *gb, uint8_t *src)
 // x69   2 MCycle
 int sub_a_hl(struct gb_core *gb)
 {
-    uint16_t address = convert_8to16(&gb->cpu.h, &gb->cpu.l);
-    set_n(&gb->cpu, 1);
-    uint8_t val = read_mem_tick(gb, address);
-    cflag_sub_set(&gb->cpu, gb->cpu.a, val);
-    hflag_sub_set(&gb->cpu, gb->cpu.a, val);
-    gb->cpu.a -= val;
-    set_z(&gb->cpu, gb->cpu.a == 0);
+    uint8_t val = read_mem_tick(gb, gb->cpu.hl);
+    alu_sub(&gb->cpu, val, 0);
     return 2;
 }
 
 int sub_a_n(struct gb_core *gb)
 {
-    uint8_t n = read_mem_tick(gb, gb->cpu.pc);
-    set_n(&gb->cpu, 1);
-    cflag_sub_set(&gb->cpu, gb->cpu.a, n);
-    hflag_sub_set(&gb->cpu, gb->cpu.a, n);
-    gb->cpu.a -= n;
-    set_z(&gb->cpu, gb->cpu.a == 0);
-    gb->cpu.pc++;
+    uint8_t n = fetch_mem_tick(gb, gb->cpu.pc++);
+    alu_sub(&gb->cpu, n, 0);
     return 2;
 }
 
@@ -299,18 +234,7 @@ int sub_a_n(struct gb_core *gb)
 // x9(8-F)   1 MCycle
 int sbc_a_r(struct gb_core *gb, uint8_t *src)
 {
-    uint8_t a_copy = gb->cpu.a;
-    set_n(&gb->cpu, 1);
-    gb->cpu.a -= *src;
-    if (get_c(&gb->cpu))
-    {
-        --gb->cpu.a;
-        set_h(&gb->cpu, (((a_copy & 0xF) - (*src & 0xF) - (1 & 0xF)) & 0x10) == 0x10);
-    }
-    else
-        set_h(&gb->cpu, (((a_copy & 0xF) - (*src & 0xF)) & 0x10) == 0x10);
-    set_c(&gb->cpu, *src + get_c(&gb->cpu) > a_copy);
-    set_z(&gb->cpu, gb->cpu.a == 0);
+    alu_sub(&gb->cpu, *src, get_c(&gb->cpu));
     return 1;
 }
 
@@ -318,20 +242,8 @@ int sbc_a_r(struct gb_core *gb, uint8_t *src)
 // x9E   2 MCycle
 int sbc_a_hl(struct gb_core *gb)
 {
-    uint8_t a_copy = gb->cpu.a;
-    set_n(&gb->cpu, 1);
-    uint16_t address = convert_8to16(&gb->cpu.h, &gb->cpu.l);
-    uint8_t val = read_mem_tick(gb, address);
-    gb->cpu.a -= val;
-    if (get_c(&gb->cpu))
-    {
-        --gb->cpu.a;
-        set_h(&gb->cpu, (((a_copy & 0xF) - (val & 0xF) - (1 & 0xF)) & 0x10) == 0x10);
-    }
-    else
-        set_h(&gb->cpu, (((a_copy & 0xF) - (val & 0xF)) & 0x10) == 0x10);
-    set_c(&gb->cpu, val + get_c(&gb->cpu) > a_copy);
-    set_z(&gb->cpu, gb->cpu.a == 0);
+    uint8_t val = read_mem_tick(gb, gb->cpu.hl);
+    alu_sub(&gb->cpu, val, get_c(&gb->cpu));
     return 2;
 }
 
@@ -339,20 +251,8 @@ int sbc_a_hl(struct gb_core *gb)
 // xDE   2 MCycle
 int sbc_a_n(struct gb_core *gb)
 {
-    uint8_t a_copy = gb->cpu.a;
-    set_n(&gb->cpu, 1);
-    uint8_t val = read_mem_tick(gb, gb->cpu.pc);
-    gb->cpu.a -= val;
-    if (get_c(&gb->cpu))
-    {
-        --gb->cpu.a;
-        set_h(&gb->cpu, (((a_copy & 0xF) - (val & 0xF) - (1 & 0xF)) & 0x10) == 0x10);
-    }
-    else
-        set_h(&gb->cpu, (((a_copy & 0xF) - (val & 0xF)) & 0x10) == 0x10);
-    set_c(&gb->cpu, val + get_c(&gb->cpu) > a_copy);
-    set_z(&gb->cpu, gb->cpu.a == 0);
-    ++gb->cpu.pc;
+    uint8_t n = fetch_mem_tick(gb, gb->cpu.pc++);
+    alu_sub(&gb->cpu, n, get_c(&gb->cpu));
     return 2;
 }
 
@@ -360,11 +260,7 @@ int sbc_a_n(struct gb_core *gb)
 // xA(0-7)   1 MCycle
 int and_a_r(struct gb_core *gb, uint8_t *src)
 {
-    gb->cpu.a = gb->cpu.a & *src;
-    set_n(&gb->cpu, 0);
-    set_h(&gb->cpu, 1);
-    set_c(&gb->cpu, 0);
-    set_z(&gb->cpu, gb->cpu.a == 0);
+    alu_logic(&gb->cpu, FLAGS_AND, gb->cpu.a & *src);
     return 1;
 }
 
@@ -372,12 +268,8 @@ int and_a_r(struct gb_core *gb, uint8_t *src)
 // x6A   2 MCycle
 int and_a_hl(struct gb_core *gb)
 {
-    uint16_t address = convert_8to16(&gb->cpu.h, &gb->cpu.l);
-    gb->cpu.a = gb->cpu.a & read_mem_tick(gb, address);
-    set_n(&gb->cpu, 0);
-    set_h(&gb->cpu, 1);
-    set_c(&gb->cpu, 0);
-    set_z(&gb->cpu, gb->cpu.a == 0);
+    uint8_t val = read_mem_tick(gb, gb->cpu.hl);
+    alu_logic(&gb->cpu, FLAGS_AND, gb->cpu.a & val);
     return 2;
 }
 
@@ -385,13 +277,8 @@ int and_a_hl(struct gb_core *gb)
 // xE6   2 MCycle
 int and_a_n(struct gb_core *gb)
 {
-    uint8_t n = read_mem_tick(gb, gb->cpu.pc);
-    gb->cpu.a = gb->cpu.a & n;
-    set_n(&gb->cpu, 0);
-    set_h(&gb->cpu, 1);
-    set_c(&gb->cpu, 0);
-    set_z(&gb->cpu, gb->cpu.a == 0);
-    ++gb->cpu.pc;
+    uint8_t n = fetch_mem_tick(gb, gb->cpu.pc++);
+    alu_logic(&gb->cpu, FLAGS_AND, gb->cpu.a & n);
     return 2;
 }
 
@@ -399,11 +286,7 @@ int and_a_n(struct gb_core *gb)
 // xA(8-F)   1 MCycle
 int xor_a_r(struct gb_core *gb, uint8_t *src)
 {
-    gb->cpu.a = gb->cpu.a ^ *src;
-    set_n(&gb->cpu, 0);
-    set_h(&gb->cpu, 0);
-    set_c(&gb->cpu, 0);
-    set_z(&gb->cpu, gb->cpu.a == 0);
+    alu_logic(&gb->cpu, FLAGS_OR, gb->cpu.a ^ *src);
     return 1;
 }
 
@@ -411,12 +294,8 @@ int xor_a_r(struct gb_core *gb, uint8_t *src)
 // xAE   2 MCycle
 int xor_a_hl(struct gb_core *gb)
 {
-    uint16_t address = convert_8to16(&gb->cpu.h, &gb->cpu.l);
-    gb->cpu.a = gb->cpu.a ^ read_mem_tick(gb, address);
-    set_n(&gb->cpu, 0);
-    set_h(&gb->cpu, 0);
-    set_c(&gb->cpu, 0);
-    set_z(&gb->cpu, gb->cpu.a == 0);
+    uint8_t val = read_mem_tick(gb, gb->cpu.hl);
+    alu_logic(&gb->cpu, FLAGS_OR, gb->cpu.a ^ val);
     return 2;
 }
 
@@ -424,13 +303,8 @@ int xor_a_hl(struct gb_core *gb)
 // xEE   2 MCycle
 int xor_a_n(struct gb_core *gb)
 {
-    uint8_t n = read_mem_tick(gb, gb->cpu.pc);
-    gb->cpu.a = gb->cpu.a ^ n;
-    set_n(&gb->cpu, 0);
-    set_h(&gb->cpu, 0);
-    set_c(&gb->cpu, 0);
-    set_z(&gb->cpu, gb->cpu.a == 0);
-    ++gb->cpu.pc;
+    uint8_t n = fetch_mem_tick(gb, gb->cpu.pc++);
+    alu_logic(&gb->cpu, FLAGS_OR, gb->cpu.a ^ n);
     return 2;
 }
 
@@ -438,11 +312,7 @@ int xor_a_n(struct gb_core *gb)
 // xB(0-7)   1 MCycle
 int or_a_r(struct gb_core *gb, uint8_t *src)
 {
-    gb->cpu.a = gb->cpu.a | *src;
-    set_n(&gb->cpu, 0);
-    set_h(&gb->cpu, 0);
-    set_c(&gb->cpu, 0);
-    set_z(&gb->cpu, gb->cpu.a == 0);
+    alu_logic(&gb->cpu, FLAGS_OR, gb->cpu.a | *src);
     return 1;
 }
 
@@ -450,12 +320,8 @@ int or_a_r(struct gb_core *gb, uint8_t *src)
 // xB6   2 MCycle
 int or_a_hl(struct gb_core *gb)
 {
-    uint16_t address = convert_8to16(&gb->cpu.h, &gb->cpu.l);
-    gb->cpu.a = gb->cpu.a | read_mem_tick(gb, address);
-    set_n(&gb->cpu, 0);
-    set_h(&gb->cpu, 0);
-    set_c(&gb->cpu, 0);
-    set_z(&gb->cpu, gb->cpu.a == 0);
+    uint8_t val = read_mem_tick(gb, gb->cpu.hl);
+    alu_logic(&gb->cpu, FLAGS_OR, gb->cpu.a | val);
     return 2;
 }
 
@@ -463,13 +329,8 @@ int or_a_hl(struct gb_core *gb)
 // xF6   2 MCycle
 int or_a_n(struct gb_core *gb)
 {
-    uint8_t n = read_mem_tick(gb, gb->cpu.pc);
-    gb->cpu.a = gb->cpu.a | n;
-    set_n(&gb->cpu, 0);
-    set_h(&gb->cpu, 0);
-    set_c(&gb->cpu, 0);
-    set_z(&gb->cpu, gb->cpu.a == 0);
-    ++gb->cpu.pc;
+    uint8_t n = fetch_mem_tick(gb, gb->cpu.pc++);
+    alu_logic(&gb->cpu, FLAGS_OR, gb->cpu.a | n);
     return 2;
 }
 
@@ -477,10 +338,7 @@ int or_a_n(struct gb_core *gb)
 // xB(8-F)   1 MCycle
 int cp_a_r(struct gb_core *gb, uint8_t *src)
 {
-    set_n(&gb->cpu, 1);
-    cflag_sub_set(&gb->cpu, gb->cpu.a, *src);
-    hflag_sub_set(&gb->cpu, gb->cpu.a, *src);
-    set_z(&gb->cpu, gb->cpu.a == *src);
+    alu_cp(&gb->cpu, *src);
     return 1;
 }
 
@@ -488,12 +346,8 @@ int cp_a_r(struct gb_core *gb, uint8_t *src)
 // xBE   2 MCycle
 int cp_a_hl(struct gb_core *gb)
 {
-    uint16_t address = convert_8to16(&gb->cpu.h, &gb->cpu.l);
-    set_n(&gb->cpu, 1);
-    uint8_t val = read_mem_tick(gb, address);
-    cflag_sub_set(&gb->cpu, gb->cpu.a, val);
-    hflag_sub_set(&gb->cpu, gb->cpu.a, val);
-    set_z(&gb->cpu, gb->cpu.a == val);
+    uint8_t val = read_mem_tick(gb, gb->cpu.hl);
+    alu_cp(&gb->cpu, val);
     return 2;
 }
 
@@ -501,12 +355,8 @@ int cp_a_hl(struct gb_core *gb)
 // xFE   2 MCycle
 int cp_a_n(struct gb_core *gb)
 {
-    uint8_t n = read_mem_tick(gb, gb->cpu.pc);
-    ++gb->cpu.pc;
-    set_n(&gb->cpu, 1);
-    cflag_sub_set(&gb->cpu, gb->cpu.a, n);
-    hflag_sub_set(&gb->cpu, gb->cpu.a, n);
-    set_z(&gb->cpu, gb->cpu.a == n);
+    uint8_t n = fetch_mem_tick(gb, gb->cpu.pc++);
+    alu_cp(&gb->cpu, n);
     return 2;
 }
 
@@ -0,0 +1,247 @@
+#include "pixel_kernels.h"
+
+#include <string.h>
+
+#include "ppu.h"
+
+#ifdef PIXEL_KERNELS_X86
+#include <immintrin.h>
+#endif
+
+const struct pixel_kernels *pixel_kernels = &pixel_kernels_scalar;
+
+static inline uint8_t compose_entry(uint8_t bg, uint8_t obj, int bg_enable, int obj_enable)
+{
+    /* Same order as the FIFO used to select its pixel */
+    if (!(obj & PIXEL_OBJ))
+        return bg;
+    if (!bg_enable)
+        return obj & PIXEL_ENTRY_MASK;
+    if (!obj_enable)
+        return bg;
+    if ((obj & PIXEL_OBJ_PRIORITY) && bg != 0)
+        return bg;
+    if ((obj & 0x03) == 0)
+        return bg;
+    return obj & PIXEL_ENTRY_MASK;
+}
+
+static void compose_scalar(const uint8_t *bg, const uint8_t *obj, uint8_t lcdc, const uint32_t *lut, uint8_t *out,
+                           unsigned int count)
+{
+    int bg_enable = (lcdc >> LCDC_BG_WINDOW_ENABLE) & 0x01;
+    int obj_enable = (lcdc >> LCDC_OBJ_ENABLE) & 0x01;
+    for (unsigned int i = 0; i < count; ++i)
+        memcpy(out + i * 4, &lut[compose_entry(bg[i], obj[i], bg_enable, obj_enable)], 4);
+}
+
+static void decode_rows_scalar(const uint8_t *data, unsigned int rows, uint8_t *colors)
+{
+    for (unsigned int row = 0; row < rows; ++row, data += 2, colors += 8)
+    {
+        for (int i = 0; i < 8; ++i)
+            colors[i] = (((data[1] >> (7 - i)) & 0x01) << 1) | ((data[0] >> (7 - i)) & 0x01);
+    }
+}
+
+static void compose_line_scalar(const uint8_t *bg, const uint8_t *obj, uint8_t lcdc, const uint32_t *lut, void *out,
+                                unsigned int count)
+{
+    compose_scalar(bg, obj, lcdc, lut, out, count);
+}
+
+const struct pixel_kernels pixel_kernels_scalar = {
+    .name = "scalar",
+    .decode_rows = decode_rows_scalar,
+    .compose_line = compose_line_scalar,
+};
+
+#ifdef PIXEL_KERNELS_X86
+
+#define BYTE_REPEAT 0x0101010101010101ULL
+
+/* Bit of each pixel in its slice byte, leftmost first */
+#define SLICE_BITS (char)0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01
+
+__attribute__((target("sse2"))) static __m128i decode_sse2(__m128i lo, __m128i hi, __m128i bits)
+{
+    __m128i lo_set = _mm_cmpeq_epi8(_mm_and_si128(lo, bits), bits);
+    __m128i hi_set = _mm_cmpeq_epi8(_mm_and_si128(hi, bits), bits);
+    return _mm_or_si128(_mm_and_si128(lo_set, _mm_set1_epi8(1)), _mm_and_si128(hi_set, _mm_set1_epi8(2)));
+}
+
+/* Two rows per iteration */
+__attribute__((target("sse2"))) static void decode_rows_sse2(const uint8_t *data, unsigned int rows, uint8_t *colors)
+{
+    __m128i bits = _mm_setr_epi8(SLICE_BITS, SLICE_BITS);
+    unsigned int row = 0;
+    for (; row + 2 <= rows; row += 2, data += 4, colors += 16)
+    {
+        __m128i lo = _mm_set_epi64x(data[2] * BYTE_REPEAT, data[0] * BYTE_REPEAT);
+        __m128i hi = _mm_set_epi64x(data[3] * BYTE_REPEAT, data[1] * BYTE_REPEAT);
+        _mm_storeu_si128((__m128i *)colors, decode_sse2(lo, hi, bits));
+    }
+    decode_rows_scalar(data, rows - row, colors);
+}
+
+/* Palette entries of 16 pixels */
+__attribute__((target("sse2"))) static __m128i compose_entries_sse2(const uint8_t *bg, const uint8_t *obj,
+                                                                    int bg_enable, int obj_enable)
+{
+    __m128i zero = _mm_setzero_si128();
+    __m128i b = _mm_loadu_si128((const __m128i *)bg);
+    __m128i o = _mm_loadu_si128((const __m128i *)obj);
+    __m128i present = _mm_cmpeq_epi8(_mm_and_si128(o, _mm_set1_epi8(PIXEL_OBJ)), _mm_set1_epi8(PIXEL_OBJ));
+
+    __m128i win = present;
+    if (bg_enable && !obj_enable)
+        win = zero;
+    else if (bg_enable)
+    {
+        __m128i transparent = _mm_cmpeq_epi8(_mm_and_si128(o, _mm_set1_epi8(0x03)), zero);
+        __m128i no_priority = _mm_cmpeq_epi8(_mm_and_si128(o, _mm_set1_epi8(PIXEL_OBJ_PRIORITY)), zero);
+        /* Hidden when the priority bit is set and the BG color is not 0 */
+        __m128i hidden = _mm_andnot_si128(_mm_or_si128(no_priority, _mm_cmpeq_epi8(b, zero)), present);
+        win = _mm_andnot_si128(_mm_or_si128(transparent, hidden), present);
+    }
+
+    __m128i entries = _mm_and_si128(o, _mm_set1_epi8(PIXEL_ENTRY_MASK));
+    return _mm_or_si128(_mm_and_si128(win, entries), _mm_andnot_si128(win, b));
+}
+
+/* SSE2 has no byte shuffle, the table lookups stay scalar */
+__attribute__((target("sse2"))) static void compose_line_sse2(const uint8_t *bg, const uint8_t *obj, uint8_t lcdc,
+                                                              const uint32_t *lut, void *out, unsigned int count)
+{
+    int bg_enable = (lcdc >> LCDC_BG_WINDOW_ENABLE) & 0x01;
+    int obj_enable = (lcdc >> LCDC_OBJ_ENABLE) & 0x01;
+    uint8_t *dest = out;
+    unsigned int i = 0;
+    for (; i + 16 <= count; i += 16)
+    {
+        uint8_t entries[16];
+        _mm_storeu_si128((__m128i *)entries, compose_entries_sse2(bg + i, obj + i, bg_enable, obj_enable));
+        for (int j = 0; j < 16; ++j)
+            memcpy(dest + (i + j) * 4, &lut[entries[j]], 4);
+    }
+    compose_scalar(bg + i, obj + i, lcdc, lut, dest + i * 4, count - i);
+}
+
+const struct pixel_kernels pixel_kernels_sse2 = {
+    .name = "sse2",
+    .decode_rows = decode_rows_sse2,
+    .compose_line = compose_line_sse2,
+};
+
+__attribute__((target("avx2"))) static __m256i decode_avx2(__m256i lo, __m256i hi, __m256i bits)
+{
+    __m256i lo_set = _mm256_cmpeq_epi8(_mm256_and_si256(lo, bits), bits);
+    __m256i hi_set = _mm256_cmpeq_epi8(_mm256_and_si256(hi, bits), bits);
+    return _mm256_or_si256(_mm256_and_si256(lo_set, _mm256_set1_epi8(1)),
+                           _mm256_and_si256(hi_set, _mm256_set1_epi8(2)));
+}
+
+/* Four rows per iteration */
+__attribute__((target("avx2"))) static void decode_rows_avx2(const uint8_t *data, unsigned int rows, uint8_t *colors)
+{
+    __m256i bits = _mm256_setr_epi8(SLICE_BITS, SLICE_BITS, SLICE_BITS, SLICE_BITS);
+    unsigned int row = 0;
+    for (; row + 4 <= rows; row += 4, data += 8, colors += 32)
+    {
+        __m256i lo = _mm256_set_epi64x(
+            data[6] * BYTE_REPEAT, data[4] * BYTE_REPEAT, data[2] * BYTE_REPEAT, data[0] * BYTE_REPEAT);
+        __m256i hi = _mm256_set_epi64x(
+            data[7] * BYTE_REPEAT, data[5] * BYTE_REPEAT, data[3] * BYTE_REPEAT, data[1] * BYTE_REPEAT);
+        _mm256_storeu_si256((__m256i *)colors, decode_avx2(lo, hi, bits));
+    }
+    decode_rows_sse2(data, rows - row, colors);
+}
+
+__attribute__((target("avx2"))) static __m256i compose_entries_avx2(const uint8_t *bg, const uint8_t *obj,
+                                                                    int bg_enable, int obj_enable)
+{
+    __m256i zero = _mm256_setzero_si256();
+    __m256i b = _mm256_loadu_si256((const __m256i *)bg);
+    __m256i o = _mm256_loadu_si256((const __m256i *)obj);
+    __m256i present =
+        _mm256_cmpeq_epi8(_mm256_and_si256(o, _mm256_set1_epi8(PIXEL_OBJ)), _mm256_set1_epi8(PIXEL_OBJ));
+
+    __m256i win = present;
+    if (bg_enable && !obj_enable)
+        win = zero;
+    else if (bg_enable)
+    {
+        __m256i transparent = _mm256_cmpeq_epi8(_mm256_and_si256(o, _mm256_set1_epi8(0x03)), zero);
+        __m256i no_priority = _mm256_cmpeq_epi8(_mm256_and_si256(o, _mm256_set1_epi8(PIXEL_OBJ_PRIORITY)), zero);
+        __m256i hidden = _mm256_andnot_si256(_mm256_or_si256(no_priority, _mm256_cmpeq_epi8(b, zero)), present);
+        win = _mm256_andnot_si256(_mm256_or_si256(transparent, hidden), present);
+    }
+
+    __m256i entries = _mm256_and_si256(o, _mm256_set1_epi8(PIXEL_ENTRY_MASK));
+    return _mm256_blendv_epi8(b, entries, win);
+}
+
+/* The lookups are four byte shuffles, one per byte of the output pixels, interleaved back to 32 bits */
+__attribute__((target("avx2"))) static void compose_line_avx2(const uint8_t *bg, const uint8_t *obj, uint8_t lcdc,
+                                                              const uint32_t *lut, void *out, unsigned int count)
+{
+    int bg_enable = (lcdc >> LCDC_BG_WINDOW_ENABLE) & 0x01;
+    int obj_enable = (lcdc >> LCDC_OBJ_ENABLE) & 0x01;
+
+    uint8_t planes[4][16];
+    for (int entry = 0; entry < 16; ++entry)
+    {
+        for (int byte = 0; byte < 4; ++byte)
+            planes[byte][entry] = lut[entry] >> (byte * 8);
+    }
+    __m256i plane[4];
+    for (int byte = 0; byte < 4; ++byte)
+        plane[byte] = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)planes[byte]));
+
+    uint8_t *dest = out;
+    unsigned int i = 0;
+    for (; i + 32 <= count; i += 32)
+    {
+        __m256i entries = compose_entries_avx2(bg + i, obj + i, bg_enable, obj_enable);
+        __m256i b0 = _mm256_shuffle_epi8(plane[0], entries);
+        __m256i b1 = _mm256_shuffle_epi8(plane[1], entries);
+        __m256i b2 = _mm256_shuffle_epi8(plane[2], entries);
+        __m256i b3 = _mm256_shuffle_epi8(plane[3], entries);
+
+        /* Unpacks stay within 128 bits lanes: pixels 0-15 in the low lanes, 16-31 in the high ones */
+        __m256i lo01 = _mm256_unpacklo_epi8(b0, b1);
+        __m256i hi01 = _mm256_unpackhi_epi8(b0, b1);
+        __m256i lo23 = _mm256_unpacklo_epi8(b2, b3);
+        __m256i hi23 = _mm256_unpackhi_epi8(b2, b3);
+        __m256i d0 = _mm256_unpacklo_epi16(lo01, lo23);
+        __m256i d1 = _mm256_unpackhi_epi16(lo01, lo23);
+        __m256i d2 = _mm256_unpacklo_epi16(hi01, hi23);
+        __m256i d3 = _mm256_unpackhi_epi16(hi01, hi23);
+
+        _mm256_storeu_si256((__m256i *)(dest + i * 4), _mm256_permute2x128_si256(d0, d1, 0x20));
+        _mm256_storeu_si256((__m256i *)(dest + i * 4 + 32), _mm256_permute2x128_si256(d2, d3, 0x20));
+        _mm256_storeu_si256((__m256i *)(dest + i * 4 + 64), _mm256_permute2x128_si256(d0, d1, 0x31));
+        _mm256_storeu_si256((__m256i *)(dest + i * 4 + 96), _mm256_permute2x128_si256(d2, d3, 0x31));
+    }
+    compose_line_sse2(bg + i, obj + i, lcdc, lut, dest + i * 4, count - i);
+}
+
+const struct pixel_kernels pixel_kernels_avx2 = {
+    .name = "avx2",
+    .decode_rows = decode_rows_avx2,
+    .compose_line = compose_line_avx2,
+};
+
+#endif
+
+void pixel_kernels_init(void)
+{
+    pixel_kernels = &pixel_kernels_scalar;
+#ifdef PIXEL_KERNELS_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        pixel_kernels = &pixel_kernels_avx2;
+    else if (__builtin_cpu_supports("sse2"))
+        pixel_kernels = &pixel_kernels_sse2;
+#endif
+}
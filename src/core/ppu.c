@@ -10,9 +10,13 @@
 #include "emulation.h"
 #include "gb_core.h"
 #include "interrupts.h"
+#include "obj_lines.h"
+#include "page_table.h"
 #include "ppu_utils.h"
 #include "read.h"
+#include "scheduler.h"
 #include "serialization.h"
+#include "tile_cache.h"
 
 static uint8_t get_tileid(struct gb_core *gb, int obj_index, int bottom_part)
 {
@@ -71,20 +75,17 @@ static uint8_t get_tileid(struct gb_core *gb, int obj_index, int bottom_part)
     return tileid;
 }
 
-static uint8_t get_tile_lo(struct gb_core *gb, uint8_t tileid, int obj_index)
+/* VRAM offset of the low byte of the tile row to fetch */
+static uint16_t get_tile_row(struct gb_core *gb, uint8_t tileid, int obj_index)
 {
     uint8_t y_part = 0;
     int bit_12 = 0;
-    uint8_t attributes = gb->ppu.obj_fetcher.attributes;
     if (obj_index != -1)
     {
         y_part = (gb->memory.io[IO_OFFSET(LY)] - (gb->ppu.obj_slots[obj_index].y - 16)) % 8;
         /* Y flip */
-        if ((attributes >> 6) & 1)
-        {
-            y_part = ~y_part;
-            y_part &= 0x07;
-        }
+        if ((gb->ppu.obj_fetcher.attributes >> 6) & 0x01)
+            y_part = (~y_part) & 0x07;
     }
     else if (gb->ppu.win_mode)
     {
@@ -97,56 +98,30 @@ static uint8_t get_tile_lo(struct gb_core *gb, uint8_t tileid, int obj_index)
         bit_12 = !(get_lcdc(gb->memory.io, LCDC_BG_WINDOW_TILES) | (tileid & 0x80));
     }
 
-    uint16_t address_low = (0x4 << 13) | (bit_12 << 12) | (tileid << 4) | (y_part << 1) | 0;
+    return VRAM_OFFSET((0x4 << 13) | (bit_12 << 12) | (tileid << 4) | (y_part << 1));
+}
 
-    uint8_t slice_low = gb->memory.vram[VRAM_OFFSET(address_low)];
+static int get_tile_xflip(struct gb_core *gb, int obj_index)
+{
+    return obj_index != -1 && ((gb->ppu.obj_fetcher.attributes >> 5) & 0x01);
+}
 
-    if (obj_index != -1)
-    {
-        /* X flip */
-        if ((attributes >> 5) & 0x01)
-            slice_low = slice_xflip(slice_low);
-    }
+/* The slices come from the tile cache, already X flipped for objects which need it */
+static const struct tile_planes *get_tile_planes(struct gb_core *gb, uint8_t tileid, int obj_index)
+{
+    return tile_cache_planes(&gb->tile_cache, gb->memory.vram, get_tile_row(gb, tileid, obj_index));
+}
 
-    return slice_low;
+static uint8_t get_tile_lo(struct gb_core *gb, uint8_t tileid, int obj_index)
+{
+    const struct tile_planes *planes = get_tile_planes(gb, tileid, obj_index);
+    return get_tile_xflip(gb, obj_index) ? planes->lo_xflip : planes->lo;
 }
 
-/* TODO: optimize this ? (address is same as low + 1) */
 static uint8_t get_tile_hi(struct gb_core *gb, uint8_t tileid, int obj_index)
 {
-    uint8_t y_part = 0;
-    int bit_12 = 0;
-    uint8_t attributes = gb->ppu.obj_fetcher.attributes;
-    if (obj_index != -1)
-    {
-        y_part = (gb->memory.io[IO_OFFSET(LY)] - (gb->ppu.obj_slots[obj_index].y - 16)) % 8;
-        /* Y flip */
-        if ((attributes >> 6) & 0x01)
-            y_part = (~y_part) & 0x07;
-    }
-    else if (gb->ppu.win_mode)
-    {
-        y_part = gb->ppu.win_ly % 8;
-        bit_12 = !(get_lcdc(gb->memory.io, LCDC_BG_WINDOW_TILES) | (tileid & 0x80));
-    }
-    else
-    {
-        y_part = (uint8_t)(((gb->memory.io[IO_OFFSET(LY)] + gb->memory.io[IO_OFFSET(SCY)])) % 8);
-        bit_12 = !(get_lcdc(gb->memory.io, LCDC_BG_WINDOW_TILES) | (tileid & 0x80));
-    }
-
-    uint16_t address_high = (0x4 << 13) | (bit_12 << 12) | (tileid << 4) | (y_part << 1) | 1;
-
-    uint8_t slice_high = gb->memory.vram[VRAM_OFFSET(address_high)];
-
-    if (obj_index != -1)
-    {
-        /* X flip */
-        if ((attributes >> 5) & 1)
-            slice_high = slice_xflip(slice_high);
-    }
-
-    return slice_high;
+    const struct tile_planes *planes = get_tile_planes(gb, tileid, obj_index);
+    return get_tile_xflip(gb, obj_index) ? planes->hi_xflip : planes->hi;
 }
 
 // Fetcher functions
@@ -189,9 +164,9 @@ static int bg_fetcher_step(struct gb_core *gb)
         f->tick = 0;
 
         // If BG empty, refill it
-        if (RING_BUFFER_IS_EMPTY(pixel, &gb->ppu.bg_fifo))
+        if (pixel_fifo_is_empty(&gb->ppu.bg_fifo))
         {
-            push_slice(gb, &gb->ppu.bg_fifo, f->hi, f->lo, -1);
+            push_slice(gb, &gb->ppu.bg_fifo, f->lo, f->hi, -1);
             f->current_step = 0;
             return bg_fetcher_step(gb);
         }
@@ -231,10 +206,10 @@ static int obj_fetcher_step(struct gb_core *gb)
         break;
     case 3:
     {
-        if (RING_BUFFER_IS_EMPTY(pixel, &gb->ppu.obj_fifo))
-            push_slice(gb, &gb->ppu.obj_fifo, f->hi, f->lo, f->obj_index);
+        if (pixel_fifo_is_empty(&gb->ppu.obj_fifo))
+            push_slice(gb, &gb->ppu.obj_fifo, f->lo, f->hi, f->obj_index);
         else
-            merge_obj(gb, f->hi, f->lo, f->obj_index);
+            merge_obj(gb, f->lo, f->hi);
 
         // Fetch is done, we can reset the index
         // so that we can detect other (overlapped or not) objects
@@ -257,9 +232,11 @@ void ppu_init(struct gb_core *gb)
 
     gb->ppu.lx = 0;
     gb->ppu.obj_count = 0;
+    gb->ppu.obj_scan_lazy = 0;
+    gb->ppu.obj_next = 0;
 
-    RING_BUFFER_INIT(pixel, &gb->ppu.bg_fifo);
-    RING_BUFFER_INIT(pixel, &gb->ppu.obj_fifo);
+    pixel_fifo_clear(&gb->ppu.bg_fifo);
+    pixel_fifo_clear(&gb->ppu.obj_fifo);
 
     fetcher_reset(&gb->ppu.bg_fetcher);
     fetcher_reset(&gb->ppu.obj_fetcher);
@@ -270,6 +247,9 @@ void ppu_init(struct gb_core *gb)
 
     gb->ppu.dma = 0;
     gb->ppu.dma_acc = 0;
+    gb->ppu.dma_source = 0;
+    gb->ppu.dma_source_page = NULL;
+    gb->ppu.dma_start = 0;
 
     RING_BUFFER_INIT(dma_request, &gb->ppu.dma_requests);
 
@@ -284,6 +264,13 @@ void ppu_init(struct gb_core *gb)
 
     gb->ppu.obj_mode = 0;
 
+    gb->ppu.fast_line = 0;
+    gb->ppu.fast_line_end = 0;
+    gb->ppu.line_drawn = 0;
+
+    gb->ppu.sync_time = gb->scheduler.now;
+    scheduler_schedule(gb, SCHED_PPU, gb->scheduler.now + 1);
+
     gb->memory.io[IO_OFFSET(LCDC)] = 0x00;
     gb->memory.io[IO_OFFSET(STAT)] = 0x84;
     gb->memory.io[IO_OFFSET(SCY)] = 0x00;
@@ -307,6 +294,8 @@ void ppu_reset(struct gb_core *gb)
 
     gb->ppu.oam_locked = 0;
     gb->ppu.vram_locked = 0;
+    gb->ppu.fast_line = 0;
+    gb->ppu.obj_scan_lazy = 0;
 
     gb->memory.io[IO_OFFSET(STAT)] &= ~0x03;
     check_lyc(gb, 0);
@@ -314,9 +303,78 @@ void ppu_reset(struct gb_core *gb)
     fetcher_reset(&gb->ppu.bg_fetcher);
     fetcher_reset(&gb->ppu.obj_fetcher);
 
+    scheduler_schedule(gb, SCHED_PPU, gb->scheduler.now + 1);
+
     lcd_off(gb);
 }
 
+/* Copy the bytes of the current transfer the DMA reads up to timestamp */
+static void dma_copy(struct gb_core *gb, uint64_t timestamp)
+{
+    if (!gb->ppu.dma || timestamp < gb->ppu.dma_start)
+        return;
+
+    /* A byte is copied every MCycle from the one after the start */
+    uint64_t due = (timestamp - gb->ppu.dma_start) / DMA_BYTE_PERIOD;
+    if (due > OAM_SIZE)
+        due = OAM_SIZE;
+    if (due <= gb->ppu.dma_acc)
+        return;
+
+    obj_lines_invalidate_range(&gb->obj_lines, gb->ppu.dma_acc, due - gb->ppu.dma_acc);
+    const uint8_t *source = gb->ppu.dma_source_page;
+    if (source)
+        memcpy(gb->memory.oam + gb->ppu.dma_acc, source + gb->ppu.dma_acc, due - gb->ppu.dma_acc);
+    else
+    {
+        for (uint8_t i = gb->ppu.dma_acc; i < due; ++i)
+            gb->memory.oam[i] = read_mem_dma(gb, (gb->ppu.dma_source << 8) + i);
+    }
+    gb->ppu.dma_acc = due;
+}
+
+static bool scanline_renderer_enabled(struct gb_core *gb)
+{
+    if (gb->ppu.renderer == PPU_RENDERER_DEFAULT)
+        return get_global_settings()->scanline_renderer;
+    return gb->ppu.renderer == PPU_RENDERER_SCANLINE;
+}
+
+/* Whether the scanline renderer can draw the line about to enter mode 3 */
+static bool scanline_fast_path(struct gb_core *gb)
+{
+    uint8_t *io = gb->memory.io;
+    if (!scanline_renderer_enabled(gb) || gb->ppu.win_mode)
+        return false;
+    if (gb->ppu.obj_count && get_lcdc(io, LCDC_OBJ_ENABLE))
+        return false;
+    // The window starts when LX reaches WX + 1, LX stays under 168
+    return !(get_lcdc(io, LCDC_BG_WINDOW_ENABLE) && get_lcdc(io, LCDC_WINDOW_ENABLE) && gb->ppu.wy_trigger &&
+             io[IO_OFFSET(WX)] < 167);
+}
+
+static void obj_slot_add(struct gb_core *gb, uint8_t oam_offset)
+{
+    gb->ppu.obj_slots[gb->ppu.obj_count].y = gb->memory.oam[oam_offset];
+    gb->ppu.obj_slots[gb->ppu.obj_count].x = gb->memory.oam[oam_offset + 1];
+    gb->ppu.obj_slots[gb->ppu.obj_count].oam_offset = oam_offset;
+    gb->ppu.obj_slots[gb->ppu.obj_count].done = 0;
+    ++gb->ppu.obj_count;
+}
+
+/* Stable sort of the objects by X for on_object() */
+static void obj_slots_sort(struct ppu *ppu)
+{
+    for (int8_t i = 0; i < ppu->obj_count; ++i)
+    {
+        int8_t j = i;
+        for (; j > 0 && ppu->obj_slots[ppu->obj_order[j - 1]].x > ppu->obj_slots[i].x; --j)
+            ppu->obj_order[j] = ppu->obj_order[j - 1];
+        ppu->obj_order[j] = i;
+    }
+    ppu->obj_next = 0;
+}
+
 // Mode 2
 static int oam_scan(struct gb_core *gb)
 {
@@ -324,31 +382,50 @@ static int oam_scan(struct gb_core *gb)
     gb->ppu.oam_locked = 1;
     gb->ppu.vram_locked = 0;
 
-    uint8_t oam_offset = 2 * gb->ppu.line_dot_count;
-    if (gb->ppu.obj_count < 10)
+    // 8x16 (LCDC bit 2 = 1) or 8x8 (LCDC bit 2 = 0)
+    int y_max_offset = get_lcdc(gb->memory.io, LCDC_OBJ_SIZE) ? 16 : 8;
+    uint8_t ly = gb->memory.io[IO_OFFSET(LY)];
+
+    // The whole line at once unless an OAM DMA may modify OAM during the scan, see ppu_oam_scan_sync()
+    if (gb->ppu.line_dot_count == 0)
     {
-        // 8x16 (LCDC bit 2 = 1) or 8x8 (LCDC bit 2 = 0)
-        // TODO: obj_y + 1 != 0 condition is weird ? check this
-        int y_max_offset = get_lcdc(gb->memory.io, LCDC_OBJ_SIZE) ? 16 : 8;
-        if (gb->memory.oam[oam_offset + 1] != 0 && gb->memory.io[IO_OFFSET(LY)] + 16 >= gb->memory.oam[oam_offset] &&
-            gb->memory.io[IO_OFFSET(LY)] + 16 < gb->memory.oam[oam_offset] + y_max_offset)
+        dma_copy(gb, gb->ppu.sync_time);
+        gb->ppu.obj_scan_lazy =
+            !gb->ppu.dma && RING_BUFFER_IS_EMPTY(dma_request, &gb->ppu.dma_requests) && ly < SCREEN_HEIGHT;
+        if (gb->ppu.obj_scan_lazy)
         {
-            gb->ppu.obj_slots[gb->ppu.obj_count].y = gb->memory.oam[oam_offset];
-            gb->ppu.obj_slots[gb->ppu.obj_count].x = gb->memory.oam[oam_offset + 1];
-            gb->ppu.obj_slots[gb->ppu.obj_count].oam_offset = oam_offset;
-            gb->ppu.obj_slots[gb->ppu.obj_count].done = 0;
-            ++gb->ppu.obj_count;
+            obj_lines_update(&gb->obj_lines, gb->memory.oam, y_max_offset);
+            uint64_t entries = gb->obj_lines.lines[ly];
+            for (; entries && gb->ppu.obj_count < 10; entries &= entries - 1)
+                obj_slot_add(gb, __builtin_ctzll(entries) * 4);
         }
     }
 
+    uint8_t oam_offset = 2 * gb->ppu.line_dot_count;
+    if (!gb->ppu.obj_scan_lazy && gb->ppu.obj_count < 10)
+    {
+        dma_copy(gb, gb->ppu.sync_time);
+
+        // TODO: obj_y + 1 != 0 condition is weird ? check this
+        if (gb->memory.oam[oam_offset + 1] != 0 && ly + 16 >= gb->memory.oam[oam_offset] &&
+            ly + 16 < gb->memory.oam[oam_offset] + y_max_offset)
+            obj_slot_add(gb, oam_offset);
+    }
+
     gb->ppu.line_dot_count += 2;
 
     // Switch to mode 3 and reset FIFOs
     if (gb->ppu.line_dot_count >= 80)
     {
         gb->ppu.current_mode = 3;
-        RING_BUFFER_INIT(pixel, &gb->ppu.bg_fifo);
-        RING_BUFFER_INIT(pixel, &gb->ppu.obj_fifo);
+        gb->ppu.obj_scan_lazy = 0;
+        obj_slots_sort(&gb->ppu);
+        pixel_fifo_clear(&gb->ppu.bg_fifo);
+        pixel_fifo_clear(&gb->ppu.obj_fifo);
+
+        // Without objects nor window the FIFO draws the last pixel on dot 253 + SCX % 8
+        gb->ppu.fast_line = scanline_fast_path(gb);
+        gb->ppu.fast_line_end = 254 + gb->memory.io[IO_OFFSET(SCX)] % 8;
     }
 
     return 2;
@@ -389,7 +466,7 @@ static uint8_t fetchers_step(struct gb_core *gb)
         if (!gb->ppu.obj_mode)
         {
             // BG FIFO must not be empty and BG fetcher must have a slice ready to be pushed
-            if (!RING_BUFFER_IS_EMPTY(pixel, &gb->ppu.bg_fifo) && gb->ppu.bg_fetcher.current_step == 3)
+            if (!pixel_fifo_is_empty(&gb->ppu.bg_fifo) && gb->ppu.bg_fetcher.current_step == 3)
             {
                 // Once we enter OBJ mode, we have at least 8+ BG pixels fetched
                 gb->ppu.obj_mode = 1;
@@ -405,35 +482,95 @@ static uint8_t fetchers_step(struct gb_core *gb)
     return 1;
 }
 
+/* Write the pixels of the line popped up to end to the frame buffer */
+static void line_draw(struct gb_core *gb, unsigned int end)
+{
+    if (gb->ppu.line_drawn >= end)
+        return;
+    draw_line(gb, gb->ppu.line_bg, gb->ppu.line_obj, gb->ppu.line_drawn, end);
+    gb->ppu.line_drawn = end;
+}
+
+static void line_pop_pixel(struct gb_core *gb)
+{
+    unsigned int x = gb->ppu.lx - 8;
+    pop_pixel(gb, &gb->ppu.line_bg[x], &gb->ppu.line_obj[x]);
+    if (x == SCREEN_WIDTH - 1)
+        line_draw(gb, SCREEN_WIDTH);
+}
+
 static uint8_t send_pixel(struct gb_core *gb)
 {
-    if (RING_BUFFER_IS_EMPTY(pixel, &gb->ppu.bg_fifo))
+    if (pixel_fifo_is_empty(&gb->ppu.bg_fifo))
         return 0;
 
     // Don't draw BG prefetch + shift SCX for first BG tile
     if (!gb->ppu.win_mode && gb->ppu.first_tile && gb->ppu.lx > 7)
     {
         size_t discard = gb->memory.io[IO_OFFSET(SCX)] % 8;
-        if (RING_BUFFER_GET_COUNT(pixel, &gb->ppu.bg_fifo) <= 8 - discard)
-        {
-            struct pixel p = select_pixel(gb);
-            draw_pixel(gb, p);
-        }
-        else if (!RING_BUFFER_IS_EMPTY(pixel, &gb->ppu.bg_fifo))
+        if (gb->ppu.bg_fifo.count <= 8 - discard)
+            line_pop_pixel(gb);
+        else if (!pixel_fifo_is_empty(&gb->ppu.bg_fifo))
         {
-            RING_BUFFER_DEQUEUE(pixel, &gb->ppu.bg_fifo, NULL);
+            pixel_fifo_shift(&gb->ppu.bg_fifo);
             --gb->ppu.lx;
         }
     }
     else if (gb->ppu.lx > 7 && gb->ppu.lx <= 167)
+        line_pop_pixel(gb);
+
+    if (gb->ppu.first_tile && pixel_fifo_is_empty(&gb->ppu.bg_fifo))
+        gb->ppu.first_tile = 0;
+
+    return 1;
+}
+
+/* Draw the whole BG line as the FIFO would, the window and objects are never on a fast line */
+static void scanline_render(struct gb_core *gb)
+{
+    uint8_t *io = gb->memory.io;
+    uint8_t *colors = gb->ppu.line_bg;
+
+    memset(gb->ppu.line_obj, 0, SCREEN_WIDTH);
+    // BG disabled, the FIFO pushes color 0 pixels
+    if (!get_lcdc(io, LCDC_BG_WINDOW_ENABLE))
+        memset(colors, 0, SCREEN_WIDTH);
+    else
     {
-        struct pixel p = select_pixel(gb);
-        draw_pixel(gb, p);
+        uint8_t y = io[IO_OFFSET(LY)] + io[IO_OFFSET(SCY)];
+        uint8_t x = io[IO_OFFSET(SCX)];
+        uint16_t map = (0x13 << 11) | (get_lcdc(io, LCDC_BG_TILE_MAP) << 10) | ((y / 8) << 5);
+        int unsigned_tiles = get_lcdc(io, LCDC_BG_WINDOW_TILES);
+
+        for (int i = 0; i < SCREEN_WIDTH;)
+        {
+            uint8_t tileid = gb->memory.vram[VRAM_OFFSET(map | (x / 8))];
+            int bit_12 = !(unsigned_tiles | (tileid & 0x80));
+            uint16_t address = (0x4 << 13) | (bit_12 << 12) | (tileid << 4) | ((y % 8) << 1);
+            const uint8_t *row = tile_cache_row(&gb->tile_cache, gb->memory.vram, VRAM_OFFSET(address));
+
+            int count = 8 - x % 8;
+            if (count > SCREEN_WIDTH - i)
+                count = SCREEN_WIDTH - i;
+            memcpy(colors + i, row + x % 8, count);
+            i += count;
+            x += count;
+        }
     }
 
-    if (gb->ppu.first_tile && RING_BUFFER_IS_EMPTY(pixel, &gb->ppu.bg_fifo))
-        gb->ppu.first_tile = 0;
+    line_draw(gb, SCREEN_WIDTH);
+}
 
+/* ppu_catch_up() skips the dots before the last one without calling this */
+static uint8_t scanline_step(struct gb_core *gb)
+{
+    // Last dot of mode 3, the FIFO draws the last pixel now
+    if (++gb->ppu.line_dot_count == gb->ppu.fast_line_end)
+    {
+        scanline_render(gb);
+        gb->ppu.lx = SCREEN_WIDTH + 8;
+        gb->ppu.fast_line = 0;
+    }
     return 1;
 }
 
@@ -463,18 +600,22 @@ static uint8_t mode3_handler(struct gb_core *gb)
         gb->ppu.vram_locked = 1;
 
         // Reset FIFOs and Fetchers
-        RING_BUFFER_INIT(pixel, &gb->ppu.bg_fifo);
-        RING_BUFFER_INIT(pixel, &gb->ppu.obj_fifo);
+        pixel_fifo_clear(&gb->ppu.bg_fifo);
+        pixel_fifo_clear(&gb->ppu.obj_fifo);
 
         fetcher_reset(&gb->ppu.bg_fetcher);
         fetcher_reset(&gb->ppu.obj_fetcher);
+        gb->ppu.line_drawn = 0;
     }
 
+    if (gb->ppu.fast_line)
+        return scanline_step(gb);
+
     // Check if window triggers are fulfilled
     if (!gb->ppu.win_mode && on_window(gb))
     {
         // Reset BG Fetcher and FIFO to current step 0 and enable win mode
-        RING_BUFFER_INIT(pixel, &gb->ppu.bg_fifo);
+        pixel_fifo_clear(&gb->ppu.bg_fifo);
         gb->ppu.bg_fetcher.current_step = 0;
         gb->ppu.bg_fetcher.tick = 0;
         gb->ppu.win_mode = 1;
@@ -512,10 +653,10 @@ static uint8_t mode3_handler(struct gb_core *gb)
         // wait for the BG FIFO to be filled before popping
         if (gb->ppu.lx < 8)
         {
-            if (!RING_BUFFER_IS_EMPTY(pixel, &gb->ppu.bg_fifo))
+            if (!pixel_fifo_is_empty(&gb->ppu.bg_fifo))
             {
                 // Pop current pixel and discard it
-                select_pixel(gb);
+                pop_pixel(gb, NULL, NULL);
                 ++gb->ppu.lx;
             }
         }
@@ -621,39 +762,104 @@ static uint8_t mode1_handler(struct gb_core *gb)
     return 0;
 }
 
-void dma_handle(struct gb_core *gb)
+void ppu_oam_scan_sync(struct gb_core *gb)
 {
-    uint8_t dequeue = 0;
-    for (size_t i = 0; i < RING_BUFFER_GET_COUNT(dma_request, &gb->ppu.dma_requests); ++i)
+    struct ppu *ppu = &gb->ppu;
+    if (ppu->current_mode != 2 || !ppu->obj_scan_lazy)
+        return;
+    ppu->obj_scan_lazy = 0;
+
+    // oam_scan() checks the entry line_dot_count / 2 then adds 2 dots
+    int8_t scanned = 0;
+    while (scanned < ppu->obj_count && ppu->obj_slots[scanned].oam_offset / 4 < ppu->line_dot_count / 2)
+        ++scanned;
+    ppu->obj_count = scanned;
+}
+
+void ppu_render_sync(struct gb_core *gb)
+{
+    if (gb->ppu.fast_line)
     {
-        struct dma_request *req = gb->ppu.dma_requests.buffer + ((gb->ppu.dma_requests.head + i) % 3);
-        switch (req->status)
-        {
-        case DMA_REQUESTED:
-            --req->status;
-            break;
-        case DMA_SETUP:
-            --req->status;
-            gb->ppu.dma = 1;
-            gb->ppu.dma_acc = 0;
-            if (i > 0)
-                dequeue = 1; /* This DMA request overrides the currently active one */
-            break;
-        case DMA_ACTIVE:
-            gb->memory.oam[gb->ppu.dma_acc] = read_mem(gb, (req->source << 8) + gb->ppu.dma_acc);
-            ++gb->ppu.dma_acc;
-            if (gb->ppu.dma_acc >= 160)
-            {
-                gb->ppu.dma = 0;
-                gb->ppu.dma_acc = 0;
-                dequeue = 1;
-            }
-            break;
-        }
+        // Nothing the FIFO reads has changed since the start of mode 3, run it up to the current dot
+        uint16_t dots = gb->ppu.line_dot_count;
+        gb->ppu.fast_line = 0;
+        gb->ppu.line_dot_count = 80;
+        while (gb->ppu.line_dot_count < dots)
+            mode3_handler(gb);
     }
 
-    if (dequeue)
+    if (gb->ppu.current_mode == 3 && gb->ppu.lx > 8)
+        line_draw(gb, gb->ppu.lx - 8);
+}
+
+void dma_request_transfer(struct gb_core *gb, uint8_t source)
+{
+    ppu_oam_scan_sync(gb);
+    struct dma_request new_req = {
+        .start = gb->scheduler.now + DMA_START_DELAY,
+        .source = source > 0xDF ? source & 0xDF : source,
+    };
+    RING_BUFFER_ENQUEUE(dma_request, &gb->ppu.dma_requests, &new_req);
+    dma_schedule(gb);
+}
+
+void dma_catch_up(struct gb_core *gb)
+{
+    uint64_t now = gb->scheduler.now;
+
+    /* The PPU scans OAM during the transfer and sees the DMA state one MCycle late */
+    ppu_catch_up(gb);
+
+    struct dma_request req;
+    while (!RING_BUFFER_GET_FRONT(dma_request, &gb->ppu.dma_requests, &req) && req.start <= now)
+    {
+        /* A new transfer overrides the current one, which still copies its byte of this MCycle */
+        dma_copy(gb, req.start);
         RING_BUFFER_DEQUEUE(dma_request, &gb->ppu.dma_requests, NULL);
+        gb->ppu.dma = 1;
+        gb->ppu.dma_acc = 0;
+        gb->ppu.dma_source = req.source;
+        gb->ppu.dma_start = req.start;
+        page_table_update(gb);
+    }
+
+    dma_copy(gb, now);
+    if (gb->ppu.dma && gb->ppu.dma_acc >= OAM_SIZE)
+    {
+        gb->ppu.dma = 0;
+        gb->ppu.dma_acc = 0;
+        page_table_update(gb);
+    }
+
+    dma_schedule(gb);
+}
+
+uint8_t dma_bus_value(struct gb_core *gb)
+{
+    /* The byte copied at the end of this MCycle */
+    uint64_t index = (gb->scheduler.now - gb->ppu.dma_start) / DMA_BYTE_PERIOD;
+    if (index >= OAM_SIZE)
+        index = OAM_SIZE - 1;
+    return read_mem_dma(gb, (gb->ppu.dma_source << 8) + index);
+}
+
+void dma_schedule(struct gb_core *gb)
+{
+    uint64_t next = SCHED_NEVER;
+    struct dma_request req;
+    if (!RING_BUFFER_GET_FRONT(dma_request, &gb->ppu.dma_requests, &req))
+        next = req.start;
+
+    if (gb->ppu.dma)
+    {
+        uint64_t end = gb->ppu.dma_start + OAM_SIZE * DMA_BYTE_PERIOD;
+        if (!gb->ppu.dma_source_page)
+            end = gb->ppu.dma_start + (gb->ppu.dma_acc + 1) * DMA_BYTE_PERIOD;
+        if (end < next)
+            next = end;
+    }
+
+    scheduler_schedule(gb, SCHED_DMA, next);
 }
 
 void ppu_tick(struct gb_core *gb)
@@ -682,6 +888,85 @@ void ppu_tick(struct gb_core *gb)
     }
 }
 
+/* Lower bound of the dots the PPU can run before it may set a bit in IF */
+static uint16_t interrupt_free_dots(struct gb_core *gb)
+{
+    struct ppu *ppu = &gb->ppu;
+    uint16_t dots = ppu->line_dot_count;
+    /* lx is incremented at most once per dot and mode 3 ends when it goes past 167 */
+    uint16_t mode3_dots = ppu->lx < 168 ? 168 - ppu->lx : 0;
+
+    switch (ppu->current_mode)
+    {
+    case 2:
+        // LYC check on dot 4, then the HBlank interrupt after mode 3
+        if (dots <= 4)
+            return 4 - dots;
+        return 78 - dots + mode3_dots;
+    case 3:
+        if (ppu->fast_line)
+            return ppu->fast_line_end - dots;
+        return mode3_dots;
+    case 0:
+        // HBlank entered this dot, then the OAM scan or VBlank interrupts at the end of the line
+        if (gb->memory.io[IO_OFFSET(STAT)] & 0x03)
+            return 0;
+        return dots < 456 ? 456 - dots : 0;
+    default:
+        // VBlank interrupt, LYC checks on dot 4 (dot 12 on line 153) then the next line
+        if (gb->memory.io[IO_OFFSET(LY)] == 144 && dots == 0)
+            return 0;
+        if (dots <= 4)
+            return 4 - dots;
+        if (dots <= 12)
+            return 12 - dots;
+        return dots < 456 ? 456 - dots : 0;
+    }
+}
+
+uint16_t ppu_stable_dots(struct gb_core *gb)
+{
+    struct ppu *ppu = &gb->ppu;
+    if (!get_lcdc(gb->memory.io, LCDC_LCD_PPU_ENABLE))
+        return UINT16_MAX;
+
+    /* The mode bits of STAT lag one dot behind a mode change */
+    if ((gb->memory.io[IO_OFFSET(STAT)] & 0x03) != ppu->current_mode)
+        return 0;
+    // Mode 3 starts on dot 80, the OAM scan takes two dots at a time
+    if (ppu->current_mode == 2 && ppu->line_dot_count > 4)
+        return ppu->line_dot_count < 78 ? 78 - ppu->line_dot_count : 0;
+    return interrupt_free_dots(gb);
+}
+
+void ppu_catch_up(struct gb_core *gb)
+{
+    struct ppu *ppu = &gb->ppu;
+    uint64_t now = gb->scheduler.now;
+    if (!get_lcdc(gb->memory.io, LCDC_LCD_PPU_ENABLE))
+        ppu->sync_time = now;
+
+    while (ppu->sync_time < now)
+    {
+        // The dots of a fast line between the start of mode 3 and its last one do nothing but count
+        if (ppu->fast_line && ppu->current_mode == 3 && ppu->line_dot_count > 80)
+        {
+            uint64_t idle = ppu->fast_line_end - 1 - ppu->line_dot_count;
+            if (idle > now - ppu->sync_time)
+                idle = now - ppu->sync_time;
+            ppu->line_dot_count += idle;
+            ppu->sync_time += idle;
+            if (ppu->sync_time == now)
+                break;
+        }
+
+        ppu_tick(gb);
+        ++ppu->sync_time;
+    }
+
+    scheduler_schedule(gb, SCHED_PPU, now + interrupt_free_dots(gb) + 1);
+}
+
 void ppu_oam_bug_w(struct gb_core *gb)
 {
     /* While OAM contains 40 OBJ 4 bytes each, OAM bug acts on 20 rows of 2 OBJ (8 bytes) */
@@ -689,6 +974,8 @@ void ppu_oam_bug_w(struct gb_core *gb)
     if (curr_row == 0) /* First row is unaffected */
         return;
     uint8_t prec_row = curr_row - 8;
+    ppu_oam_scan_sync(gb);
+    obj_lines_invalidate_range(&gb->obj_lines, curr_row, 8);
 
     /* First word in current row is replaced */
     uint16_t a = (gb->memory.oam[curr_row + 1] << 8) | gb->memory.oam[curr_row]; /* First word in current row */
@@ -718,6 +1005,8 @@ void ppu_oam_bug_r(struct gb_core *gb)
     if (curr_row == 0) /* First row is unaffected */
         return;
     uint8_t prec_row = curr_row - 8;
+    ppu_oam_scan_sync(gb);
+    obj_lines_invalidate_range(&gb->obj_lines, curr_row, 8);
 
     /* First word in current row is replaced */
     uint16_t a = (gb->memory.oam[curr_row + 1] << 8) | gb->memory.oam[curr_row]; /* First word in current row */
@@ -785,6 +1074,37 @@ static int fetcher_load_from_stream(FILE *stream, struct fetcher *fetcher)
     return EXIT_SUCCESS;
 }
 
+static int pixel_fifo_serialize(FILE *stream, struct pixel_fifo *fifo)
+{
+    fwrite(&fifo->count, sizeof(uint8_t), 1, stream);
+    fwrite(&fifo->lo, sizeof(uint8_t), 1, stream);
+    fwrite(&fifo->hi, sizeof(uint8_t), 1, stream);
+    fwrite(&fifo->palette, sizeof(uint8_t), 1, stream);
+    fwrite(&fifo->priority, sizeof(uint8_t), 1, stream);
+
+    return EXIT_SUCCESS;
+}
+
+static int pixel_fifo_load_from_stream(FILE *stream, struct pixel_fifo *fifo)
+{
+    fread(&fifo->count, sizeof(uint8_t), 1, stream);
+    fread(&fifo->lo, sizeof(uint8_t), 1, stream);
+    fread(&fifo->hi, sizeof(uint8_t), 1, stream);
+    fread(&fifo->palette, sizeof(uint8_t), 1, stream);
+    fread(&fifo->priority, sizeof(uint8_t), 1, stream);
+
+    /* The pixels past count must be 0 for the next push */
+    if (fifo->count > 8)
+        fifo->count = 8;
+    uint8_t pending = 0xFF00 >> fifo->count;
+    fifo->lo &= pending;
+    fifo->hi &= pending;
+    fifo->palette &= pending;
+    fifo->priority &= pending;
+
+    return EXIT_SUCCESS;
+}
+
 int ppu_serialize(FILE *stream, struct ppu *ppu)
 {
     fwrite(&ppu->mode2_tick, sizeof(uint8_t), 1, stream);
@@ -800,27 +1120,8 @@ int ppu_serialize(FILE *stream, struct ppu *ppu)
         fwrite(&ppu->obj_slots[i].done, sizeof(uint8_t), 1, stream);
     }
 
-    fwrite_le_64(stream, ppu->bg_fifo.head);
-    fwrite_le_64(stream, ppu->bg_fifo.tail);
-    fwrite_le_64(stream, ppu->bg_fifo.element_count); /* Must be written before the buffer content ! */
-    for (size_t i = 0; i < ppu->bg_fifo.element_count; ++i)
-    {
-        fwrite(&ppu->bg_fifo.buffer[i].obj, sizeof(uint8_t), 1, stream);
-        fwrite(&ppu->bg_fifo.buffer[i].color, sizeof(uint8_t), 1, stream);
-        fwrite(&ppu->bg_fifo.buffer[i].palette, sizeof(uint8_t), 1, stream);
-        fwrite(&ppu->bg_fifo.buffer[i].priority, sizeof(uint8_t), 1, stream);
-    }
-
-    fwrite_le_64(stream, ppu->obj_fifo.head);
-    fwrite_le_64(stream, ppu->obj_fifo.tail);
-    fwrite_le_64(stream, ppu->obj_fifo.element_count); /* Must be written before the buffer content ! */
-    for (size_t i = 0; i < ppu->obj_fifo.element_count; ++i)
-    {
-        fwrite(&ppu->obj_fifo.buffer[i].obj, sizeof(uint8_t), 1, stream);
-        fwrite(&ppu->obj_fifo.buffer[i].color, sizeof(uint8_t), 1, stream);
-        fwrite(&ppu->obj_fifo.buffer[i].palette, sizeof(uint8_t), 1, stream);
-        fwrite(&ppu->obj_fifo.buffer[i].priority, sizeof(uint8_t), 1, stream);
-    }
+    pixel_fifo_serialize(stream, &ppu->bg_fifo);
+    pixel_fifo_serialize(stream, &ppu->obj_fifo);
 
     fetcher_serialize(stream, &ppu->bg_fetcher);
     fetcher_serialize(stream, &ppu->obj_fetcher);
@@ -828,13 +1129,23 @@ int ppu_serialize(FILE *stream, struct ppu *ppu)
     fwrite(&ppu->oam_locked, sizeof(uint8_t), 1, stream);
     fwrite(&ppu->vram_locked, sizeof(uint8_t), 1, stream);
 
-    fwrite_le_64(stream, ppu->dma_requests.head);
-    fwrite_le_64(stream, ppu->dma_requests.tail);
-    fwrite_le_64(stream, ppu->dma_requests.element_count); /* Must be written before the buffer content ! */
+    /* The running transfer is stored as the first request, timestamps relative to the caught up PPU */
+    uint64_t dma_count = ppu->dma + ppu->dma_requests.element_count;
+    fwrite_le_64(stream, 0);
+    fwrite_le_64(stream, dma_count % 3);
+    fwrite_le_64(stream, dma_count); /* Must be written before the buffer content ! */
+    if (ppu->dma)
+    {
+        uint8_t status = DMA_ACTIVE;
+        fwrite(&status, sizeof(uint8_t), 1, stream);
+        fwrite(&ppu->dma_source, sizeof(uint8_t), 1, stream);
+    }
     for (size_t i = 0; i < ppu->dma_requests.element_count; ++i)
     {
-        fwrite(&ppu->dma_requests.buffer[i].status, sizeof(uint8_t), 1, stream);
-        fwrite(&ppu->dma_requests.buffer[i].source, sizeof(uint8_t), 1, stream);
+        struct dma_request *req = ppu->dma_requests.buffer + (ppu->dma_requests.head + i) % 3;
+        uint8_t status = DMA_ACTIVE + (req->start - ppu->sync_time) / DMA_BYTE_PERIOD;
+        fwrite(&status, sizeof(uint8_t), 1, stream);
+        fwrite(&req->source, sizeof(uint8_t), 1, stream);
     }
 
     fwrite(&ppu->dma, sizeof(uint8_t), 1, stream);
@@ -869,27 +1180,8 @@ int ppu_load_from_stream(FILE *stream, struct ppu *ppu)
         fread(&ppu->obj_slots[i].done, sizeof(uint8_t), 1, stream);
     }
 
-    fread_le_64(stream, &ppu->bg_fifo.head);
-    fread_le_64(stream, &ppu->bg_fifo.tail);
-    fread_le_64(stream, &ppu->bg_fifo.element_count); /* Must be written before the buffer content ! */
-    for (size_t i = 0; i < ppu->bg_fifo.element_count; ++i)
-    {
-        fread(&ppu->bg_fifo.buffer[i].obj, sizeof(uint8_t), 1, stream);
-        fread(&ppu->bg_fifo.buffer[i].color, sizeof(uint8_t), 1, stream);
-        fread(&ppu->bg_fifo.buffer[i].palette, sizeof(uint8_t), 1, stream);
-        fread(&ppu->bg_fifo.buffer[i].priority, sizeof(uint8_t), 1, stream);
-    }
-
-    fread_le_64(stream, &ppu->obj_fifo.head);
-    fread_le_64(stream, &ppu->obj_fifo.tail);
-    fread_le_64(stream, &ppu->obj_fifo.element_count); /* Must be written before the buffer content ! */
-    for (size_t i = 0; i < ppu->obj_fifo.element_count; ++i)
-    {
-        fread(&ppu->obj_fifo.buffer[i].obj, sizeof(uint8_t), 1, stream);
-        fread(&ppu->obj_fifo.buffer[i].color, sizeof(uint8_t), 1, stream);
-        fread(&ppu->obj_fifo.buffer[i].palette, sizeof(uint8_t), 1, stream);
-        fread(&ppu->obj_fifo.buffer[i].priority, sizeof(uint8_t), 1, stream);
-    }
+    pixel_fifo_load_from_stream(stream, &ppu->bg_fifo);
+    pixel_fifo_load_from_stream(stream, &ppu->obj_fifo);
 
     fetcher_load_from_stream(stream, &ppu->bg_fetcher);
     fetcher_load_from_stream(stream, &ppu->obj_fetcher);
@@ -897,17 +1189,33 @@ int ppu_load_from_stream(FILE *stream, struct ppu *ppu)
     fread(&ppu->oam_locked, sizeof(uint8_t), 1, stream);
     fread(&ppu->vram_locked, sizeof(uint8_t), 1, stream);
 
-    fread_le_64(stream, &ppu->dma_requests.head);
-    fread_le_64(stream, &ppu->dma_requests.tail);
-    fread_le_64(stream, &ppu->dma_requests.element_count); /* Must be written before the buffer content ! */
-    for (size_t i = 0; i < ppu->dma_requests.element_count; ++i)
+    /* Timestamps are restored relative to sync_time, which must be set beforehand */
+    uint64_t dma_head;
+    uint64_t dma_tail;
+    uint64_t dma_count;
+    fread_le_64(stream, &dma_head);
+    fread_le_64(stream, &dma_tail);
+    fread_le_64(stream, &dma_count); /* Must be written before the buffer content ! */
+    RING_BUFFER_INIT(dma_request, &ppu->dma_requests);
+    ppu->dma_source = 0;
+    for (size_t i = 0; i < dma_count && i < 3; ++i)
     {
-        fread(&ppu->dma_requests.buffer[i].status, sizeof(uint8_t), 1, stream);
-        fread(&ppu->dma_requests.buffer[i].source, sizeof(uint8_t), 1, stream);
+        uint8_t status;
+        struct dma_request req;
+        fread(&status, sizeof(uint8_t), 1, stream);
+        fread(&req.source, sizeof(uint8_t), 1, stream);
+        if (status == DMA_ACTIVE)
+        {
+            ppu->dma_source = req.source;
+            continue;
+        }
+        req.start = ppu->sync_time + (status - DMA_ACTIVE) * DMA_BYTE_PERIOD;
+        RING_BUFFER_ENQUEUE(dma_request, &ppu->dma_requests, &req);
     }
 
     fread(&ppu->dma, sizeof(uint8_t), 1, stream);
     fread(&ppu->dma_acc, sizeof(uint8_t), 1, stream);
+    ppu->dma_start = ppu->sync_time - ppu->dma_acc * DMA_BYTE_PERIOD;
 
     fread_le_16(stream, &ppu->line_dot_count);
 
@@ -920,5 +1228,13 @@ int ppu_load_from_stream(FILE *stream, struct ppu *ppu)
     fread(&ppu->wy_trigger, sizeof(uint8_t), 1, stream);
     fread(&ppu->obj_mode, sizeof(uint8_t), 1, stream);
 
+    /* Lines are saved with the FIFO state, see ppu_render_sync() */
+    ppu->fast_line = 0;
+    /* The pixels popped before the save are lost with the frame buffer */
+    ppu->line_drawn = ppu->lx > 8 ? ppu->lx - 8 : 0;
+    /* The OAM scan is saved as if done every two dots, see ppu_oam_scan_sync() */
+    ppu->obj_scan_lazy = 0;
+    obj_slots_sort(ppu);
+
     return EXIT_SUCCESS;
 }
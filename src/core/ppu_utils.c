@@ -4,38 +4,15 @@
 
 #include "gb_core.h"
 #include "interrupts.h"
+#include "pixel_kernels.h"
 #include "ppu.h"
-#include "ring_buffer.h"
 
 // Pixel and slice utils
-struct pixel make_pixel(uint8_t hi, uint8_t lo, int i, uint8_t *attributes, int obj_i)
-{
-    struct pixel res;
-    uint8_t hi_bit = (hi >> (7 - i)) & 0x01;
-    uint8_t lo_bit = (lo >> (7 - i)) & 0x01;
-    res.color = (hi_bit << 1) | lo_bit;
-    res.obj = -1;
-    if (attributes != NULL)
-    {
-        res.palette = (*attributes >> 4) & 0x01;
-        res.priority = (*attributes >> 7) & 0x01;
-        res.obj = obj_i;
-    }
-    return res;
-}
-
 uint8_t slice_xflip(uint8_t slice)
 {
-    uint8_t res = 0x00;
-    res |= ((slice << 7) & 0x80);
-    res |= ((slice << 5) & 0x40);
-    res |= ((slice << 3) & 0x20);
-    res |= ((slice << 1) & 0x10);
-    res |= ((slice >> 1) & 0x08);
-    res |= ((slice >> 3) & 0x04);
-    res |= ((slice >> 5) & 0x02);
-    res |= ((slice >> 7) & 0x01);
-    return res;
+    slice = (slice >> 4) | (slice << 4);
+    slice = ((slice >> 2) & 0x33) | ((slice << 2) & 0xCC);
+    return ((slice >> 1) & 0x55) | ((slice << 1) & 0xAA);
 }
 
 int on_window(struct gb_core *gb)
@@ -46,19 +23,26 @@ int on_window(struct gb_core *gb)
 
 int on_object(struct gb_core *gb, int *bottom_part)
 {
-    for (int i = 0; i < gb->ppu.obj_count; ++i)
+    struct ppu *ppu = &gb->ppu;
+
+    // LX only increases during mode 3: objects on the left of it are never fetched
+    while (ppu->obj_next < ppu->obj_count && (ppu->obj_slots[ppu->obj_order[ppu->obj_next]].x < ppu->lx ||
+                                              ppu->obj_slots[ppu->obj_order[ppu->obj_next]].done))
+        ++ppu->obj_next;
+
+    for (int n = ppu->obj_next; n < ppu->obj_count && ppu->obj_slots[ppu->obj_order[n]].x == ppu->lx; ++n)
     {
+        int i = ppu->obj_order[n];
         // Ignore already fetched objects
-        if (gb->ppu.obj_slots[i].done)
+        if (ppu->obj_slots[i].done)
             continue;
 
         // 8x16 (LCDC bit 2 = 1) or 8x8 (LCDC bit 2 = 0)
         int y_max_offset = get_lcdc(gb->memory.io, LCDC_OBJ_SIZE) ? 16 : 8;
-        if (gb->ppu.obj_slots[i].x == gb->ppu.lx && gb->memory.io[IO_OFFSET(LY)] + 16 >= gb->ppu.obj_slots[i].y &&
-            gb->memory.io[IO_OFFSET(LY)] + 16 < gb->ppu.obj_slots[i].y + y_max_offset)
+        int ly = gb->memory.io[IO_OFFSET(LY)];
+        if (ly + 16 >= ppu->obj_slots[i].y && ly + 16 < ppu->obj_slots[i].y + y_max_offset)
         {
-            if (bottom_part != NULL && y_max_offset == 16 &&
-                gb->memory.io[IO_OFFSET(LY)] + 16 >= gb->ppu.obj_slots[i].y + 8)
+            if (bottom_part != NULL && y_max_offset == 16 && ly + 16 >= ppu->obj_slots[i].y + 8)
                 *bottom_part = 1;
             return i;
         }
@@ -66,72 +50,59 @@ int on_object(struct gb_core *gb, int *bottom_part)
     return -1;
 }
 
-struct pixel select_pixel(struct gb_core *gb)
+void pop_pixel(struct gb_core *gb, uint8_t *bg, uint8_t *obj)
 {
-    struct pixel bg_p = {0};
-    RING_BUFFER_DEQUEUE(pixel, &gb->ppu.bg_fifo, &bg_p);
-
-    if (RING_BUFFER_IS_EMPTY(pixel, &gb->ppu.obj_fifo))
-        return bg_p;
+    struct pixel_fifo *bg_fifo = &gb->ppu.bg_fifo;
+    struct pixel_fifo *obj_fifo = &gb->ppu.obj_fifo;
 
-    struct pixel obj_p = {0};
-    RING_BUFFER_DEQUEUE(pixel, &gb->ppu.obj_fifo, &obj_p);
+    if (bg)
+        *bg = pixel_fifo_front(bg_fifo);
+    if (obj)
+    {
+        *obj = 0;
+        if (!pixel_fifo_is_empty(obj_fifo))
+            *obj = pixel_fifo_front(obj_fifo) | PIXEL_OBJ | ((obj_fifo->palette >> 4) & PIXEL_OBJ_OBP1) |
+                   ((obj_fifo->priority >> 3) & PIXEL_OBJ_PRIORITY);
+    }
 
-    if (!get_lcdc(gb->memory.io, LCDC_BG_WINDOW_ENABLE))
-        return obj_p;
-    if (!get_lcdc(gb->memory.io, LCDC_OBJ_ENABLE))
-        return bg_p;
-    if (obj_p.priority && bg_p.color != 0)
-        return bg_p;
-    if (obj_p.color == 0)
-        return bg_p;
-    return obj_p;
+    pixel_fifo_shift(bg_fifo);
+    pixel_fifo_shift(obj_fifo);
 }
 
-int push_slice(struct gb_core *gb, RING_BUFFER(pixel) * q, uint8_t hi, uint8_t lo, int obj_i)
+int push_slice(struct gb_core *gb, struct pixel_fifo *fifo, uint8_t lo, uint8_t hi, int obj_i)
 {
-    uint8_t *attributes = NULL;
+    // TODO verify this
+    if (!get_lcdc(gb->memory.io, LCDC_BG_WINDOW_ENABLE))
+    {
+        lo = 0x00;
+        hi = 0x00;
+    }
+    fifo->lo |= lo;
+    fifo->hi |= hi;
     if (obj_i != -1)
-        attributes = &gb->ppu.obj_fetcher.attributes;
-    for (int i = 0; i < 8; ++i)
     {
-        struct pixel p = make_pixel(hi, lo, i, attributes, obj_i);
-        // TODO verify this
-        if (!get_lcdc(gb->memory.io, LCDC_BG_WINDOW_ENABLE))
-            p.color = 0;
-        RING_BUFFER_ENQUEUE(pixel, q, &p);
+        uint8_t attributes = gb->ppu.obj_fetcher.attributes;
+        fifo->palette |= (attributes >> 4) & 0x01 ? 0xFF : 0x00;
+        fifo->priority |= (attributes >> 7) & 0x01 ? 0xFF : 0x00;
     }
+    fifo->count = 8;
     return 2;
 }
 
-int merge_obj(struct gb_core *gb, uint8_t hi, uint8_t lo, int obj_i)
+int merge_obj(struct gb_core *gb, uint8_t lo, uint8_t hi)
 {
+    struct pixel_fifo *fifo = &gb->ppu.obj_fifo;
     uint8_t attributes = gb->ppu.obj_fetcher.attributes;
 
-    // Merge the pending pixels in the OBJ FIFO
-    size_t i = 0;
-    for (; i < RING_BUFFER_GET_COUNT(pixel, &gb->ppu.obj_fifo); ++i)
-    {
-        struct pixel *q = gb->ppu.obj_fifo.buffer + ((gb->ppu.obj_fifo.head + i) % 8);
-        int same_x = gb->ppu.obj_slots[q->obj].x == gb->ppu.obj_slots[obj_i].x;
-        // Replace only transparent pixels of object already pending
-        struct pixel p = make_pixel(hi, lo, i, &attributes, obj_i);
-        if (q->color == 0)
-            *q = p;
-        else if (same_x && p.color != 0)
-        {
-            // If both objects have the same X, use OAM index to choose pixel
-            if (obj_i < q->obj)
-                *q = p;
-        }
-    }
-
-    // Add the remaining pixels that don't need merging in the FIFO
-    for (; i < 8; ++i)
-    {
-        struct pixel p = make_pixel(hi, lo, i, &attributes, obj_i);
-        RING_BUFFER_ENQUEUE(pixel, &gb->ppu.obj_fifo, &p);
-    }
+    // Replace only transparent pixels of objects already pending, the free pixels are filled. Objects with the same X
+    // are fetched in OAM order, so the pending pixel always has the priority
+    uint8_t pending = 0xFF00 >> fifo->count;
+    uint8_t keep = pending & (fifo->lo | fifo->hi);
+    fifo->lo = (fifo->lo & keep) | (lo & ~keep);
+    fifo->hi = (fifo->hi & keep) | (hi & ~keep);
+    fifo->palette = (fifo->palette & keep) | ((attributes >> 4) & 0x01 ? ~keep : 0x00);
+    fifo->priority = (fifo->priority & keep) | ((attributes >> 7) & 0x01 ? ~keep : 0x00);
+    fifo->count = 8;
     return 2;
 }
 
@@ -0,0 +1,282 @@
+#define _DEFAULT_SOURCE
+
+#include "rom_image.h"
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "logger.h"
+
+#if defined(_LINUX) || defined(_MACOS)
+#define ROM_IMAGE_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#define ROM_SIZE_ADDR 0x0148
+#define ROM_MIN_SIZE 0x8000
+
+#ifdef ROM_IMAGE_MMAP
+/* Identity of the file an image was mapped from, reopening the same unmodified file doesn't need to hash it again */
+struct file_id
+{
+    dev_t dev;
+    ino_t ino;
+    off_t size;
+    time_t mtime;
+    long mtime_nsec; /* Files rewritten within the same second only differ there */
+};
+#endif
+
+struct rom_image
+{
+#ifdef ROM_IMAGE_MMAP
+    struct file_id file;
+#endif
+    uint64_t hash;
+    size_t file_size;
+    size_t size;
+    uint8_t *data;
+    unsigned int refs;
+    struct rom_image *next;
+};
+
+static struct rom_image *images = NULL;
+static pthread_mutex_t images_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static uint64_t hash(const uint8_t *data, size_t size)
+{
+    /* FNV-1a */
+    uint64_t res = 0xCBF29CE484222325;
+    for (size_t i = 0; i < size; ++i)
+        res = (res ^ data[i]) * 0x100000001B3;
+    return res;
+}
+
+static size_t padded_size(size_t file_size, uint8_t rom_size_header)
+{
+    size_t size = ROM_MIN_SIZE;
+    /* Unknown sizes are handled as the largest one by set_mbc() */
+    size_t declared = rom_size_header > 0x08 ? 512 * 0x4000 : (size_t)0x8000 << rom_size_header;
+    while (size < file_size || size < declared)
+        size <<= 1;
+    return size;
+}
+
+#ifdef ROM_IMAGE_MMAP
+
+static void get_file_id(const struct stat *st, struct file_id *file)
+{
+    memset(file, 0, sizeof(struct file_id));
+    file->dev = st->st_dev;
+    file->ino = st->st_ino;
+    file->size = st->st_size;
+    file->mtime = st->st_mtime;
+#if defined(_MACOS)
+    file->mtime_nsec = st->st_mtimespec.tv_nsec;
+#else
+    file->mtime_nsec = st->st_mtim.tv_nsec;
+#endif
+}
+
+/* Image already mapped from the file at path, must be called with images_mutex held */
+static struct rom_image *find_file(const char *path)
+{
+    struct stat st;
+    if (stat(path, &st))
+        return NULL;
+
+    struct file_id file;
+    get_file_id(&st, &file);
+    struct rom_image *image = images;
+    while (image && memcmp(&image->file, &file, sizeof(struct file_id)) != 0)
+        image = image->next;
+    return image;
+}
+
+/* Fills the data, sizes and file identity of image */
+static uint8_t *map_file(const char *path, struct rom_image *image)
+{
+    int fd = open(path, O_RDONLY);
+    if (fd == -1)
+    {
+        LOG_ERROR("No such file: %s", path);
+        return NULL;
+    }
+
+    uint8_t *data = NULL;
+    struct stat st;
+    uint8_t rom_size_header = 0;
+    if (fstat(fd, &st) || st.st_size <= ROM_SIZE_ADDR || pread(fd, &rom_size_header, 1, ROM_SIZE_ADDR) != 1)
+    {
+        LOG_ERROR("Error reading file: %s", path);
+        goto exit;
+    }
+    get_file_id(&st, &image->file);
+    image->file_size = st.st_size;
+    image->size = padded_size(image->file_size, rom_size_header);
+
+    /*
+     * Zero filled reservation of the padded size, the file is mapped over its beginning. MAP_PRIVATE only copies the
+     * pages written to, the others keep reading the file: if it is truncated while mapped, every core sharing the image
+     * gets SIGBUS on its next access to a page past the new end.
+     */
+    void *reserved = mmap(NULL, image->size, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (reserved == MAP_FAILED)
+    {
+        LOG_ERROR("Error mapping ROM: %s", path);
+        goto exit;
+    }
+    if (mmap(reserved, image->file_size, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED)
+    {
+        LOG_ERROR("Error mapping ROM: %s", path);
+        munmap(reserved, image->size);
+        goto exit;
+    }
+    data = reserved;
+
+exit:
+    close(fd);
+    return image->data = data;
+}
+
+static void unmap_file(uint8_t *data, size_t size)
+{
+    munmap(data, size);
+}
+
+#else
+
+/* Without a reliable file identity every ROM is hashed */
+static struct rom_image *find_file(const char *path)
+{
+    (void)path;
+    return NULL;
+}
+
+/* Fills the data and sizes of image */
+static uint8_t *map_file(const char *path, struct rom_image *image)
+{
+    FILE *fptr = fopen(path, "rb");
+    if (!fptr)
+    {
+        LOG_ERROR("No such file: %s", path);
+        return NULL;
+    }
+
+    uint8_t *data = NULL;
+    long fsize = 0;
+    uint8_t header[ROM_SIZE_ADDR + 1];
+    if (fseek(fptr, 0, SEEK_END) || (fsize = ftell(fptr)) <= ROM_SIZE_ADDR)
+    {
+        LOG_ERROR("Error reading file: %s", path);
+        goto exit;
+    }
+    rewind(fptr);
+    if (fread(header, 1, sizeof(header), fptr) != sizeof(header))
+    {
+        LOG_ERROR("Error reading file: %s", path);
+        goto exit;
+    }
+    rewind(fptr);
+
+    image->file_size = fsize;
+    image->size = padded_size(image->file_size, header[ROM_SIZE_ADDR]);
+    if (!(data = calloc(image->size, sizeof(uint8_t))))
+    {
+        LOG_ERROR("Error allocating memory for loading ROM file");
+        goto exit;
+    }
+    if (fread(data, 1, image->file_size, fptr) != image->file_size)
+    {
+        LOG_ERROR("Error loading ROM: %s", path);
+        free(data);
+        data = NULL;
+    }
+
+exit:
+    fclose(fptr);
+    return image->data = data;
+}
+
+static void unmap_file(uint8_t *data, size_t size)
+{
+    (void)size;
+    free(data);
+}
+
+#endif
+
+uint8_t *rom_image_acquire(const char *path)
+{
+    /* The same file again, the image holds a reference so it stays valid once unlocked */
+    pthread_mutex_lock(&images_mutex);
+    struct rom_image *image = find_file(path);
+    if (image)
+        ++image->refs;
+    pthread_mutex_unlock(&images_mutex);
+    if (image)
+        return image->data;
+
+    /* Otherwise the content may still be shared with another file */
+    struct rom_image mapped;
+    memset(&mapped, 0, sizeof(struct rom_image));
+    if (!map_file(path, &mapped))
+        return NULL;
+    mapped.hash = hash(mapped.data, mapped.file_size);
+    mapped.refs = 1;
+
+    pthread_mutex_lock(&images_mutex);
+
+    image = images;
+    while (image && (image->hash != mapped.hash || image->file_size != mapped.file_size ||
+                     memcmp(image->data, mapped.data, mapped.file_size) != 0))
+        image = image->next;
+
+    if (image)
+    {
+        ++image->refs;
+        unmap_file(mapped.data, mapped.size);
+    }
+    else if ((image = malloc(sizeof(struct rom_image))))
+    {
+        *image = mapped;
+        image->next = images;
+        images = image;
+    }
+    else
+    {
+        LOG_ERROR("Error allocating memory for loading ROM file");
+        unmap_file(mapped.data, mapped.size);
+    }
+
+    pthread_mutex_unlock(&images_mutex);
+    return image ? image->data : NULL;
+}
+
+void rom_image_release(uint8_t *data)
+{
+    if (!data)
+        return;
+
+    pthread_mutex_lock(&images_mutex);
+
+    struct rom_image **link = &images;
+    while (*link && (*link)->data != data)
+        link = &(*link)->next;
+
+    struct rom_image *image = *link;
+    if (image && --image->refs == 0)
+    {
+        *link = image->next;
+        unmap_file(image->data, image->size);
+        free(image);
+    }
+
+    pthread_mutex_unlock(&images_mutex);
+}
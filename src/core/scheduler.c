@@ -0,0 +1,91 @@
+#include "scheduler.h"
+
+#include "apu.h"
+#include "gb_core.h"
+#include "ppu.h"
+#include "serial.h"
+#include "timers.h"
+
+static void (*const handlers[SCHED_EVENT_COUNT])(struct gb_core *gb) = {
+    [SCHED_PPU] = ppu_catch_up,
+    [SCHED_APU] = apu_catch_up,
+    [SCHED_TIMER] = timer_catch_up,
+    [SCHED_SERIAL] = serial_catch_up,
+    [SCHED_DMA] = dma_catch_up,
+};
+
+static void swap(struct scheduler *scheduler, uint8_t i, uint8_t j)
+{
+    uint8_t event = scheduler->heap[i];
+    scheduler->heap[i] = scheduler->heap[j];
+    scheduler->heap[j] = event;
+    scheduler->positions[scheduler->heap[i]] = i;
+    scheduler->positions[scheduler->heap[j]] = j;
+}
+
+static uint64_t key(struct scheduler *scheduler, uint8_t i)
+{
+    return scheduler->timestamps[scheduler->heap[i]];
+}
+
+static void sift_up(struct scheduler *scheduler, uint8_t i)
+{
+    while (i > 0 && key(scheduler, (i - 1) / 2) > key(scheduler, i))
+    {
+        swap(scheduler, i, (i - 1) / 2);
+        i = (i - 1) / 2;
+    }
+}
+
+static void sift_down(struct scheduler *scheduler, uint8_t i)
+{
+    while (1)
+    {
+        uint8_t smallest = i;
+        uint8_t left = 2 * i + 1;
+        uint8_t right = 2 * i + 2;
+        if (left < SCHED_EVENT_COUNT && key(scheduler, left) < key(scheduler, smallest))
+            smallest = left;
+        if (right < SCHED_EVENT_COUNT && key(scheduler, right) < key(scheduler, smallest))
+            smallest = right;
+        if (smallest == i)
+            return;
+        swap(scheduler, i, smallest);
+        i = smallest;
+    }
+}
+
+void scheduler_init(struct scheduler *scheduler)
+{
+    scheduler->now = 0;
+    scheduler->next = SCHED_NEVER;
+    for (uint8_t i = 0; i < SCHED_EVENT_COUNT; ++i)
+    {
+        scheduler->timestamps[i] = SCHED_NEVER;
+        scheduler->heap[i] = i;
+        scheduler->positions[i] = i;
+    }
+}
+
+void scheduler_schedule(struct gb_core *gb, enum sched_event event, uint64_t timestamp)
+{
+    struct scheduler *scheduler = &gb->scheduler;
+    uint64_t previous = scheduler->timestamps[event];
+    scheduler->timestamps[event] = timestamp;
+    if (timestamp < previous)
+        sift_up(scheduler, scheduler->positions[event]);
+    else
+        sift_down(scheduler, scheduler->positions[event]);
+    scheduler->next = key(scheduler, 0);
+}
+
+void scheduler_run(struct gb_core *gb)
+{
+    struct scheduler *scheduler = &gb->scheduler;
+    while (key(scheduler, 0) <= scheduler->now)
+    {
+        uint8_t event = scheduler->heap[0];
+        scheduler_schedule(gb, event, SCHED_NEVER);
+        handlers[event](gb);
+    }
+}
@@ -4,37 +4,124 @@
 
 #include "gb_core.h"
 #include "interrupts.h"
+#include "scheduler.h"
 
 #define SC_TRANSFER_ENABLE (1 << 7)
 #define SC_INTERNAL_CLK (1 << 0)
 
-void update_serial(struct gb_core *gb)
+#define SERIAL_CLOCK_PERIOD 0x200
+
+static uint16_t clock_at(struct gb_core *gb, uint64_t timestamp)
+{
+    return (timestamp - gb->serial_origin) & (SERIAL_CLOCK_PERIOD - 1);
+}
+
+static uint8_t serial_AND(struct gb_core *gb, uint64_t timestamp)
+{
+    return get_clock_select(gb) & (clock_at(gb, timestamp) >> 8);
+}
+
+/* The falling edge detector sees exactly the edges of the serial clock */
+static int is_steady(struct gb_core *gb)
+{
+    return gb->prev_serial_AND == serial_AND(gb, gb->serial_sync_time);
+}
+
+static int is_transferring(struct gb_core *gb)
+{
+    return get_transfer_enable(gb) && get_clock_select(gb);
+}
+
+/* Shift bits out, simulating no slave GameBoy connected by receiving $FF */
+static void shift(struct gb_core *gb, uint8_t bits)
 {
-    uint16_t new_clk = (gb->serial_clock + 1) & 0x1FF;
+    gb->memory.io[IO_OFFSET(SB)] = (gb->memory.io[IO_OFFSET(SB)] << bits) | ((1 << bits) - 1);
+    gb->serial_acc += bits;
 
-    uint8_t transfer_enabled = (gb->memory.io[IO_OFFSET(SC)] & SC_INTERNAL_CLK);
-    uint8_t clk_bit = new_clk >> 8;
+    if (gb->serial_acc == 8)
+    {
+        gb->memory.io[IO_OFFSET(SC)] &= ~0x80;
+        set_if(gb, INTERRUPT_SERIAL);
+    }
+    gb->serial_acc %= 8;
+}
 
-    uint8_t new_serial_AND = transfer_enabled & clk_bit;
+static void step(struct gb_core *gb)
+{
+    uint8_t new_serial_AND = serial_AND(gb, ++gb->serial_sync_time);
 
     /* SC_TRANSFER_ENABLE & SERIAL_CLK bit 8 falling edge detection */
-    if (get_transfer_enable(gb))
+    if (get_transfer_enable(gb) && gb->prev_serial_AND && !new_serial_AND)
+        shift(gb, 1);
+
+    gb->prev_serial_AND = new_serial_AND;
+}
+
+/* Run a steady serial port up to timestamp, or up to the end of the transfer */
+static void run(struct gb_core *gb, uint64_t timestamp)
+{
+    if (is_transferring(gb))
     {
-        if (gb->prev_serial_AND && !new_serial_AND)
+        /* A bit is shifted every time the serial clock wraps around */
+        uint16_t phase = clock_at(gb, gb->serial_sync_time);
+        uint64_t bits = (phase + (timestamp - gb->serial_sync_time)) / SERIAL_CLOCK_PERIOD;
+        uint8_t left = 8 - gb->serial_acc;
+        if (bits >= left)
         {
-            gb->memory.io[IO_OFFSET(SB)] <<= 1; /* Shift bit out */
-            gb->memory.io[IO_OFFSET(SB)] |= 1;  /* Simulate no slave GameBoy connected, receiving $FF */
-            ++gb->serial_acc;
+            bits = left;
+            timestamp = gb->serial_sync_time + left * SERIAL_CLOCK_PERIOD - phase;
         }
+        if (bits)
+            shift(gb, bits);
+    }
 
-        if (gb->serial_acc == 8)
-        {
-            gb->memory.io[IO_OFFSET(SC)] &= ~0x80;
-            set_if(gb, INTERRUPT_SERIAL);
-        }
+    gb->serial_sync_time = timestamp;
+    gb->prev_serial_AND = serial_AND(gb, timestamp);
+}
+
+void serial_init(struct gb_core *gb)
+{
+    gb->serial_origin = gb->scheduler.now + 24; /* TODO: investigate why this value works */
+    gb->serial_sync_time = gb->scheduler.now;
+    gb->prev_serial_AND = 0;
+    gb->serial_acc = 0;
+    serial_schedule(gb);
+}
+
+uint16_t serial_get_clock(struct gb_core *gb)
+{
+    return clock_at(gb, gb->scheduler.now);
+}
+
+void serial_set_clock(struct gb_core *gb, uint16_t clock)
+{
+    serial_catch_up(gb);
+    gb->serial_origin = gb->scheduler.now - clock;
+    serial_schedule(gb);
+}
+
+void serial_catch_up(struct gb_core *gb)
+{
+    while (gb->serial_sync_time < gb->scheduler.now)
+    {
+        if (is_steady(gb))
+            run(gb, gb->scheduler.now);
+        else
+            step(gb);
     }
+    serial_schedule(gb);
+}
 
-    gb->serial_clock = new_clk;
-    gb->prev_serial_AND = new_serial_AND;
-    gb->serial_acc %= 8;
+void serial_schedule(struct gb_core *gb)
+{
+    uint64_t now = gb->serial_sync_time;
+
+    /* Glitches are run in the next MCycle */
+    if (!is_steady(gb))
+        scheduler_schedule(gb, SCHED_SERIAL, now + 1);
+    else if (is_transferring(gb))
+        scheduler_schedule(gb, SCHED_SERIAL,
+                           now + (8 - gb->serial_acc) * SERIAL_CLOCK_PERIOD - clock_at(gb, now));
+    else
+        scheduler_schedule(gb, SCHED_SERIAL, SCHED_NEVER);
 }
@@ -0,0 +1,204 @@
+#include "superop.h"
+
+#include <string.h>
+
+#include "common.h"
+#include "emulation.h"
+#include "gb_core.h"
+#include "logic.h"
+#include "mbc_base.h"
+#include "ring_buffer.h"
+
+struct loop_pattern
+{
+    uint8_t length;
+    uint8_t mcycles; /* Per iteration, with the branch taken */
+    uint8_t bytes[8];
+};
+
+static const struct loop_pattern patterns[] = {
+    [SUPEROP_COPY_HL_DE] = {8, 13, {0x2A, 0x12, 0x13, 0x0B, 0x78, 0xB1, 0x20, 0xF8}},
+    [SUPEROP_COPY_DE_HL] = {8, 13, {0x1A, 0x22, 0x13, 0x0B, 0x78, 0xB1, 0x20, 0xF8}},
+    [SUPEROP_COPY8_B] = {6, 10, {0x2A, 0x12, 0x13, 0x05, 0x20, 0xFA}},
+    [SUPEROP_COPY8_C] = {6, 10, {0x2A, 0x12, 0x13, 0x0D, 0x20, 0xFA}},
+    [SUPEROP_FILL_INC_B] = {4, 6, {0x22, 0x05, 0x20, 0xFC}},
+    [SUPEROP_FILL_INC_C] = {4, 6, {0x22, 0x0D, 0x20, 0xFC}},
+    [SUPEROP_FILL_DEC_B] = {4, 6, {0x32, 0x05, 0x20, 0xFC}},
+    [SUPEROP_FILL_DEC_C] = {4, 6, {0x32, 0x0D, 0x20, 0xFC}},
+};
+
+#define PATTERN_COUNT (sizeof(patterns) / sizeof(patterns[0]))
+
+uint8_t superop_match(struct gb_core *gb, uint16_t address)
+{
+    switch (read_mbc_rom(gb->mbc, address))
+    {
+    case 0x1A:
+    case 0x22:
+    case 0x2A:
+    case 0x32:
+        break;
+    default:
+        return SUPEROP_NONE;
+    }
+
+    for (uint8_t kind = SUPEROP_NONE + 1; kind < PATTERN_COUNT; ++kind)
+    {
+        const struct loop_pattern *pattern = &patterns[kind];
+        /* The whole loop must be in the same bank as its head */
+        if ((address & 0x3FFF) + pattern->length > 0x4000)
+            continue;
+
+        uint8_t i = 0;
+        while (i < pattern->length && read_mbc_rom(gb->mbc, address + i) == pattern->bytes[i])
+            ++i;
+        if (i == pattern->length)
+            return kind;
+    }
+    return SUPEROP_NONE;
+}
+
+/* Host pointer to the length bytes at address when they can be accessed without side effects, NULL otherwise */
+static uint8_t *plain_memory(struct gb_core *gb, uint16_t address, uint32_t length, int write)
+{
+    uint32_t end = address + length;
+    int lcd_off = !get_lcdc(gb->memory.io, LCDC_LCD_PPU_ENABLE);
+
+    if (end <= 0x8000)
+    {
+        if (write || is_boot_rom_mapped(gb, 0x0000) || (address >> 14) != ((end - 1) >> 14))
+            return NULL;
+        return gb->mbc->rom + mbc_rom_offset(gb->mbc, address);
+    }
+    if (address >= VRAM && end <= EXRAM)
+    {
+        if (!lcd_off || gb->ppu.vram_locked)
+            return NULL;
+        if (write)
+            tile_cache_invalidate_range(&gb->tile_cache, VRAM_OFFSET(address), length);
+        return gb->memory.vram + VRAM_OFFSET(address);
+    }
+    if (address >= WRAM1 && end <= ECHO_RAM)
+        return gb->memory.wram + WRAM_OFFSET(address);
+    if (address >= OAM && end <= NOT_USABLE)
+    {
+        if (!lcd_off || gb->ppu.oam_locked || gb->ppu.dma)
+            return NULL;
+        if (write)
+            obj_lines_invalidate_range(&gb->obj_lines, OAM_OFFSET(address), length);
+        return gb->memory.oam + OAM_OFFSET(address);
+    }
+    if (address >= HRAM && end <= 0xFFFF)
+        return gb->memory.hram + HRAM_OFFSET(address);
+    return NULL;
+}
+
+/* Iterations left including the current one, a zero counter wraps around */
+static uint32_t remaining_iterations(struct gb_core *gb, uint8_t superop)
+{
+    switch (superop)
+    {
+    case SUPEROP_COPY_HL_DE:
+    case SUPEROP_COPY_DE_HL:
+        return gb->cpu.bc ? gb->cpu.bc : 0x10000;
+    case SUPEROP_COPY8_B:
+    case SUPEROP_FILL_INC_B:
+    case SUPEROP_FILL_DEC_B:
+        return gb->cpu.b ? gb->cpu.b : 0x100;
+    default:
+        return gb->cpu.c ? gb->cpu.c : 0x100;
+    }
+}
+
+static void copy(uint8_t *dest, const uint8_t *src, uint32_t length)
+{
+    /* Overlapping ranges must replicate the byte by byte forward copy */
+    if (dest > src && dest < src + length)
+    {
+        for (uint32_t i = 0; i < length; ++i)
+            dest[i] = src[i];
+    }
+    else
+        memmove(dest, src, length);
+}
+
+/* Counter of the 8 bit loops as left by the dec of the last iteration run */
+static void finish_counter(struct gb_core *gb, uint8_t *counter, uint32_t iterations)
+{
+    *counter = *counter - iterations + 1;
+    dec_r(gb, counter);
+}
+
+int superop_run(struct gb_core *gb, uint8_t superop)
+{
+    /* Interrupts can't be serviced between two instructions, IE can't be written by the loop */
+    if (gb->cpu.ime > 1 || (gb->cpu.ime && (gb->memory.ie & 0x1F)))
+        return 0;
+    /* OAM DMA reads memory in parallel */
+    if (gb->ppu.dma || !RING_BUFFER_IS_EMPTY(dma_request, &gb->ppu.dma_requests))
+        return 0;
+
+    const struct loop_pattern *pattern = &patterns[superop];
+    uint32_t iterations = remaining_iterations(gb, superop) - 1;
+    if (iterations > SUPEROP_MAX_MCYCLES / pattern->mcycles)
+        iterations = SUPEROP_MAX_MCYCLES / pattern->mcycles;
+    if (!iterations)
+        return 0;
+
+    uint16_t head = gb->cpu.pc - 1;
+    struct cpu *cpu = &gb->cpu;
+    switch (superop)
+    {
+    case SUPEROP_COPY_HL_DE:
+    case SUPEROP_COPY_DE_HL:
+    case SUPEROP_COPY8_B:
+    case SUPEROP_COPY8_C:
+    {
+        uint16_t src_address = superop == SUPEROP_COPY_DE_HL ? cpu->de : cpu->hl;
+        uint16_t dest_address = superop == SUPEROP_COPY_DE_HL ? cpu->hl : cpu->de;
+        const uint8_t *src = plain_memory(gb, src_address, iterations, 0);
+        uint8_t *dest = plain_memory(gb, dest_address, iterations, 1);
+        if (!src || !dest)
+            return 0;
+
+        copy(dest, src, iterations);
+        cpu->hl += iterations;
+        cpu->de += iterations;
+        if (superop == SUPEROP_COPY8_B || superop == SUPEROP_COPY8_C)
+        {
+            cpu->a = src[iterations - 1];
+            finish_counter(gb, superop == SUPEROP_COPY8_B ? &cpu->b : &cpu->c, iterations);
+        }
+        else
+        {
+            cpu->bc -= iterations;
+            cpu->a = cpu->b;
+            or_a_r(gb, &cpu->c);
+        }
+        break;
+    }
+    default:
+    {
+        int increment = superop == SUPEROP_FILL_INC_B || superop == SUPEROP_FILL_INC_C;
+        if (!increment && cpu->hl < iterations - 1)
+            return 0;
+        uint16_t start = increment ? cpu->hl : cpu->hl - (iterations - 1);
+        uint8_t *dest = plain_memory(gb, start, iterations, 1);
+        if (!dest)
+            return 0;
+
+        memset(dest, cpu->a, iterations);
+        cpu->hl = increment ? cpu->hl + iterations : cpu->hl - iterations;
+        finish_counter(gb, superop == SUPEROP_FILL_INC_B || superop == SUPEROP_FILL_DEC_B ? &cpu->b : &cpu->c,
+                       iterations);
+        break;
+    }
+    }
+
+    /* No component touches these ranges, ticking after the copy is cycle identical */
+    int mcycles = iterations * pattern->mcycles;
+    for (int i = 1; i < mcycles; ++i)
+        tick_m(gb);
+    cpu->pc = head;
+    return mcycles;
+}
@@ -0,0 +1,28 @@
+#include "tile_cache.h"
+
+#include "pixel_kernels.h"
+#include "ppu_utils.h"
+
+void tile_cache_decode(struct tile_cache *cache, const uint8_t *vram, unsigned int tile)
+{
+    const uint8_t *data = vram + tile * 16;
+    pixel_kernels->decode_rows(data, 8, cache->rows[tile][0]);
+    for (int row = 0; row < 8; ++row)
+    {
+        struct tile_planes *planes = &cache->planes[tile][row];
+        planes->lo = data[row * 2];
+        planes->hi = data[row * 2 + 1];
+        planes->lo_xflip = slice_xflip(planes->lo);
+        planes->hi_xflip = slice_xflip(planes->hi);
+    }
+    cache->dirty[tile / 64] &= ~((uint64_t)1 << (tile % 64));
+}
+
+void tile_cache_invalidate_range(struct tile_cache *cache, uint16_t offset, uint32_t length)
+{
+    if (!length)
+        return;
+    uint32_t end = offset + length;
+    for (uint32_t tile = offset / 16; tile < TILE_COUNT && tile * 16 < end; ++tile)
+        cache->dirty[tile / 64] |= (uint64_t)1 << (tile % 64);
+}
@@ -1,12 +1,37 @@
+#include "timers.h"
+
 #include "gb_core.h"
 #include "interrupts.h"
+#include "scheduler.h"
 
 #define TAC_TIMER_ENABLED (1 << 2)
 #define TAC_CLOCK_SELECT 0x3
 
 static unsigned int clock_shifts[] = {9, 3, 5, 7};
 
-void update_timers(struct gb_core *gb)
+static uint16_t div_at(struct gb_core *gb, uint64_t timestamp)
+{
+    return gb->stop ? 0 : (uint16_t)(timestamp - gb->div_origin);
+}
+
+static unsigned int clock_shift(struct gb_core *gb)
+{
+    return clock_shifts[gb->memory.io[IO_OFFSET(TAC)] & TAC_CLOCK_SELECT];
+}
+
+static uint8_t tac_AND(struct gb_core *gb, uint16_t div)
+{
+    uint8_t tac_enabled = (gb->memory.io[IO_OFFSET(TAC)] & TAC_TIMER_ENABLED) >> 2;
+    return tac_enabled & ((div >> clock_shift(gb)) & 1);
+}
+
+/* The falling edge detector sees exactly the edges of DIV, TIMA can be run in closed form */
+static int is_steady(struct gb_core *gb)
+{
+    return !gb->schedule_tima_overflow && gb->prev_tac_AND == tac_AND(gb, div_at(gb, gb->timer_sync_time));
+}
+
+static void step(struct gb_core *gb)
 {
     /* TIMA overflow consequences are delayed by 4 TCycles and can be aborted before */
     if (gb->schedule_tima_overflow)
@@ -17,27 +42,114 @@ void update_timers(struct gb_core *gb)
         gb->schedule_tima_overflow = 0;
     }
 
-    uint16_t new_div = gb->internal_div;
-    if (!gb->stop)
-        new_div += 1;
+    uint8_t new_tac_AND = tac_AND(gb, div_at(gb, ++gb->timer_sync_time));
 
-    uint8_t previous_tima = gb->memory.io[IO_OFFSET(TIMA)];
+    /* TAC_ENABLED & CLOCK_SELECT falling edge detection */
+    if (gb->prev_tac_AND && !new_tac_AND && !++gb->memory.io[IO_OFFSET(TIMA)])
+        gb->schedule_tima_overflow = 1; /* Schedule an interrupt for next Mcycle */
 
-    unsigned int clock_shift = clock_shifts[gb->memory.io[IO_OFFSET(TAC)] & TAC_CLOCK_SELECT];
+    gb->prev_tac_AND = new_tac_AND;
+}
 
-    uint8_t tac_enabled = (gb->memory.io[IO_OFFSET(TAC)] & TAC_TIMER_ENABLED) >> 2;
-    uint8_t selected_div_bit = (new_div >> clock_shift) & 1;
+/* Run a steady timer up to timestamp, or up to the TCycle TIMA overflows on */
+static void run(struct gb_core *gb, uint64_t timestamp)
+{
+    uint64_t tcycles = timestamp - gb->timer_sync_time;
+    if (!(gb->memory.io[IO_OFFSET(TAC)] & TAC_TIMER_ENABLED) || gb->stop)
+    {
+        gb->timer_sync_time = timestamp;
+        return;
+    }
 
-    uint8_t new_tac_AND = tac_enabled & selected_div_bit;
+    /* TIMA is incremented every time DIV reaches a multiple of period */
+    uint32_t period = 1 << (clock_shift(gb) + 1);
+    uint32_t phase = div_at(gb, gb->timer_sync_time) & (period - 1);
+    uint64_t increments = (phase + tcycles) / period;
+    uint32_t to_overflow = 0x100 - gb->memory.io[IO_OFFSET(TIMA)];
 
-    /* TAC_ENABLED & CLOCK_SELECT falling edge detection */
-    if (gb->prev_tac_AND && !new_tac_AND)
-        ++gb->memory.io[IO_OFFSET(TIMA)];
+    if (increments < to_overflow)
+    {
+        gb->memory.io[IO_OFFSET(TIMA)] += increments;
+        gb->timer_sync_time = timestamp;
+        gb->prev_tac_AND = tac_AND(gb, div_at(gb, timestamp));
+        return;
+    }
 
-    /* TIMA overflow consequences are delayed by 4 TCycles */
-    if (previous_tima > gb->memory.io[IO_OFFSET(TIMA)])
-        gb->schedule_tima_overflow = 1; /* Schedule an interrupt for next Mcycle */
+    gb->memory.io[IO_OFFSET(TIMA)] = 0;
+    gb->schedule_tima_overflow = 1;
+    gb->timer_sync_time += (uint64_t)to_overflow * period - phase;
+    gb->prev_tac_AND = 0;
+}
 
-    gb->prev_tac_AND = new_tac_AND;
-    gb->internal_div = new_div;
+void timer_init(struct gb_core *gb)
+{
+    gb->div_origin = gb->scheduler.now + 24; /* DIV starts at -24, TODO: investigate why this value works */
+    gb->timer_sync_time = gb->scheduler.now;
+    gb->prev_tac_AND = 0;
+    gb->schedule_tima_overflow = 0;
+    timer_schedule(gb);
+}
+
+uint16_t timer_get_div(struct gb_core *gb)
+{
+    return div_at(gb, gb->scheduler.now);
+}
+
+void timer_set_div(struct gb_core *gb, uint16_t div)
+{
+    timer_catch_up(gb);
+    gb->div_origin = gb->scheduler.now - div;
+    timer_schedule(gb);
+}
+
+uint64_t timer_stable_tcycles(struct gb_core *gb, uint16_t address)
+{
+    if (gb->stop)
+        return UINT64_MAX;
+
+    uint16_t div = div_at(gb, gb->scheduler.now);
+    if (address == DIV)
+        return 0xFF - (div & 0xFF);
+
+    if (!is_steady(gb))
+        return 0;
+    if (!(gb->memory.io[IO_OFFSET(TAC)] & TAC_TIMER_ENABLED))
+        return UINT64_MAX;
+    uint32_t period = 1 << (clock_shift(gb) + 1);
+    return period - 1 - (div & (period - 1));
+}
+
+void timer_catch_up(struct gb_core *gb)
+{
+    while (gb->timer_sync_time < gb->scheduler.now)
+    {
+        if (is_steady(gb))
+            run(gb, gb->scheduler.now);
+        else
+            step(gb);
+    }
+    timer_schedule(gb);
+}
+
+void timer_schedule(struct gb_core *gb)
+{
+    uint64_t now = gb->timer_sync_time;
+
+    /* Glitches are run in the next MCycle */
+    if (!is_steady(gb))
+    {
+        scheduler_schedule(gb, SCHED_TIMER, now + 1);
+        return;
+    }
+    if (!(gb->memory.io[IO_OFFSET(TAC)] & TAC_TIMER_ENABLED) || gb->stop)
+    {
+        scheduler_schedule(gb, SCHED_TIMER, SCHED_NEVER);
+        return;
+    }
+
+    /* The overflow is handled on the TCycle after TIMA wrapped */
+    uint32_t period = 1 << (clock_shift(gb) + 1);
+    uint32_t phase = div_at(gb, now) & (period - 1);
+    uint32_t to_overflow = 0x100 - gb->memory.io[IO_OFFSET(TIMA)];
+    scheduler_schedule(gb, SCHED_TIMER, now + (uint64_t)to_overflow * period - phase + 1);
 }
@@ -9,6 +9,7 @@
 #include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 
 #include "audio.h"
@@ -19,6 +20,7 @@
 #include "interrupts.h"
 #include "logger.h"
 #include "mbc_base.h"
+#include "microcode.h"
 #include "rendering.h"
 #include "save.h"
 #include "sdl_utils.h"
@@ -33,14 +35,21 @@ static struct
 {
     char *rom_path;
     char *bootrom_path;
+    enum ppu_renderer renderer;
 } args;
 
 static void print_usage(FILE *stream)
 {
     fprintf(stream,
-            "Usage: gemu [-b BOOT_ROM_PATH] ROM_PATH"
+            "Usage: gemu [-b BOOT_ROM_PATH] [-j] [-I] [-L] [-m] [-s] [-r RENDERER] ROM_PATH"
             "\nOptions:\n"
             "  -b BOOT_ROM_PATH   Specify the path to the boot ROM file.\n"
+            "  -j                 Enable the dynamic recompiler (x86-64 only).\n"
+            "  -I                 Disable idle loop detection.\n"
+            "  -L                 Disable copy and fill loop superinstructions.\n"
+            "  -m                 Use the microcoded CPU, stepped one MCycle at a time.\n"
+            "  -s                 Use the scanline renderer by default.\n"
+            "  -r RENDERER        Renderer of this ROM only, fifo or scanline.\n"
             "  -h                 Show this help message and exit.\n"
             "\nArguments:\n"
             "  ROM_PATH           Path to the ROM file to be used.\n");
@@ -49,13 +58,40 @@ static void print_usage(FILE *stream)
 static void parse_arguments(int argc, char **argv)
 {
     int opt;
-    while ((opt = getopt(argc, argv, "b:h")) != -1)
+    while ((opt = getopt(argc, argv, "b:jILmsr:h")) != -1)
     {
         switch (opt)
         {
         case 'b':
             args.bootrom_path = optarg;
             break;
+        case 'j':
+            get_global_settings()->dynarec = true;
+            break;
+        case 'I':
+            get_global_settings()->idle_loop_detection = false;
+            break;
+        case 'L':
+            get_global_settings()->superinstructions = false;
+            break;
+        case 'm':
+            get_global_settings()->microcoded_cpu = true;
+            break;
+        case 's':
+            get_global_settings()->scanline_renderer = true;
+            break;
+        case 'r':
+            if (!strcmp(optarg, "fifo"))
+                args.renderer = PPU_RENDERER_FIFO;
+            else if (!strcmp(optarg, "scanline"))
+                args.renderer = PPU_RENDERER_SCANLINE;
+            else
+            {
+                fprintf(stderr, "ERROR: Unknown renderer: %s\n", optarg);
+                print_usage(stderr);
+                exit(EXIT_FAILURE);
+            }
+            break;
         case 'h':
             print_usage(stdout);
             exit(EXIT_SUCCESS);
@@ -130,16 +166,20 @@ static int main_loop(void)
         {
             char save_path[PATH_MAX];
             snprintf(save_path, PATH_MAX, "%s" SAVESTATE_EXTENSION "%d", gb.mbc->rom_path, settings->save_state);
-            gb_core_serialize(save_path, &gb);
-            LOG_INFO("Created save state in slot %d", settings->save_state);
+            if (gb_core_serialize(save_path, &gb))
+                LOG_ERROR("Couldn't create save state in slot %d", settings->save_state);
+            else
+                LOG_INFO("Created save state in slot %d", settings->save_state);
             settings->save_state = 0;
         }
         else if (settings->load_state)
         {
             char load_path[PATH_MAX];
             snprintf(load_path, PATH_MAX, "%s" SAVESTATE_EXTENSION "%d", gb.mbc->rom_path, settings->load_state);
-            gb_core_load_from_file(load_path, &gb);
-            LOG_INFO("Loaded save state in slot %d", settings->load_state);
+            if (gb_core_load_from_file(load_path, &gb))
+                LOG_ERROR("Couldn't load save state in slot %d", settings->load_state);
+            else
+                LOG_INFO("Loaded save state in slot %d", settings->load_state);
             settings->load_state = 0;
         }
         else if (settings->open_rom)
@@ -157,9 +197,16 @@ static int main_loop(void)
         /* GB emulation routine */
         if (now_ts >= emulation_resume_ts)
         {
-            if (gb.halt)
-                tick_m(&gb);
-            else if (next_op(&gb) == -1)
+            /* A suspended instruction is always finished by the microcoded CPU */
+            bool microcoded = settings->microcoded_cpu || !microcode_at_boundary(&gb);
+            if (microcoded)
+            {
+                if (microcode_run(&gb, MICROCODE_RUN_MCYCLES) == -1)
+                    return EXIT_FAILURE;
+            }
+            else if (gb.halt)
+                halt_fast_forward(&gb, HALT_FAST_FORWARD_MAX_MCYCLES);
+            else if (next_ops(&gb, NEXT_OPS_MAX_MCYCLES) == -1)
                 return EXIT_FAILURE;
 
             int64_t ns_to_wait = synchronize(&gb);
@@ -168,7 +215,9 @@ static int main_loop(void)
             else
                 emulation_resume_ts = now_ts;
 
-            check_interrupt(&gb);
+            /* The microcoded CPU dispatches interrupts itself */
+            if (!microcoded)
+                check_interrupt(&gb);
         }
 
         /* Idle waiting to avoid busy looping */
@@ -216,8 +265,10 @@ int main(int argc, char **argv)
         err_code = EXIT_FAILURE;
         goto exit1;
     }
+    gb.ppu.renderer = args.renderer;
 
     main_loop();
+    idle_loop_log_stats(&gb);
 
 exit1:
     free_gb_core(&gb);
@@ -158,5 +158,14 @@ void show_ui(void)
         ImGui_Checkbox("Channel 4", &settings->apu_channels_enable[3]);
     }
 
+    if (ImGui_CollapsingHeader("Emulation settings", ImGuiTreeNodeFlags_None))
+    {
+        ImGui_Checkbox("Dynamic recompiler (x86-64)", &settings->dynarec);
+        ImGui_Checkbox("Idle loop detection", &settings->idle_loop_detection);
+        ImGui_Checkbox("Copy/fill loop superinstructions", &settings->superinstructions);
+        ImGui_Checkbox("Microcoded CPU (MCycle stepping)", &settings->microcoded_cpu);
+        ImGui_Checkbox("Scanline renderer", &settings->scanline_renderer);
+    }
+
     ImGui_End();
 }
@@ -0,0 +1,232 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "pixel_kernels.h"
+
+/*
+ * Checks every pixel kernel set the CPU supports against a per pixel reference, written like the PPU used to do the
+ * same work (one make_pixel() per pixel, select_pixel() then draw_pixel() for each pixel), then measures them on
+ * random tiles and lines.
+ */
+
+#define TILES 384
+#define LINES 1024
+#define LINE_WIDTH 160
+#define DEFAULT_REPEAT 200
+
+/* ------------------------ Reference ------------------------ */
+
+static uint8_t ref_color(uint8_t hi, uint8_t lo, int i)
+{
+    return (((hi >> (7 - i)) & 0x01) << 1) | ((lo >> (7 - i)) & 0x01);
+}
+
+static void ref_decode(const uint8_t *data, unsigned int rows, uint8_t *colors)
+{
+    for (unsigned int row = 0; row < rows; ++row)
+    {
+        for (int i = 0; i < 8; ++i)
+            colors[row * 8 + i] = ref_color(data[row * 2 + 1], data[row * 2], i);
+    }
+}
+
+static void ref_compose(const uint8_t *bg, const uint8_t *obj, uint8_t lcdc, const uint8_t *palettes,
+                        const uint32_t *colors, uint32_t *out, unsigned int count)
+{
+    for (unsigned int i = 0; i < count; ++i)
+    {
+        int obj_wins = 0;
+        if (obj[i] & PIXEL_OBJ)
+        {
+            if (!(lcdc & 0x01))
+                obj_wins = 1;
+            else if (!(lcdc & 0x02))
+                obj_wins = 0;
+            else if ((obj[i] & PIXEL_OBJ_PRIORITY) && bg[i] != 0)
+                obj_wins = 0;
+            else
+                obj_wins = (obj[i] & 0x03) != 0;
+        }
+
+        uint8_t palette = palettes[0];
+        uint8_t color = bg[i];
+        if (obj_wins)
+        {
+            palette = obj[i] & PIXEL_OBJ_OBP1 ? palettes[2] : palettes[1];
+            color = obj[i] & 0x03;
+        }
+        out[i] = colors[(palette >> (color * 2)) & 0x03];
+    }
+}
+
+/* ------------------------ Harness ------------------------ */
+
+static uint8_t tile_data[TILES * 16];
+static uint8_t line_bg[LINES][LINE_WIDTH];
+static uint8_t line_obj[LINES][LINE_WIDTH];
+static uint8_t line_lcdc[LINES];
+static uint8_t palettes[3] = {0xE4, 0xD2, 0x1B}; /* BGP, OBP0, OBP1 */
+static const uint32_t colors[4] = {0x00D0F8E0, 0x0070C088, 0x00566834, 0x00201808};
+
+static uint8_t expected_rows[TILES * 64];
+static uint32_t expected_lines[LINES][LINE_WIDTH];
+
+static uint8_t rows[TILES * 64];
+static uint32_t lines[LINES][LINE_WIDTH];
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static void make_inputs(void)
+{
+    srand(1);
+    for (size_t i = 0; i < sizeof(tile_data); ++i)
+        tile_data[i] = rand();
+    for (int line = 0; line < LINES; ++line)
+    {
+        /* Mostly BG and objects enabled, like games */
+        line_lcdc[line] = line % 8 ? 0x03 : rand() & 0x03;
+        for (int x = 0; x < LINE_WIDTH; ++x)
+        {
+            line_bg[line][x] = rand() & 0x03;
+            line_obj[line][x] = rand() % 4 ? 0 : PIXEL_OBJ | (rand() & (PIXEL_OBJ_OBP1 | PIXEL_OBJ_PRIORITY | 0x03));
+        }
+    }
+}
+
+/* Compose palette, see pixel_kernels.h */
+static void make_lut(uint32_t *lut)
+{
+    for (unsigned int entry = 0; entry < 16; ++entry)
+    {
+        uint8_t palette = palettes[(entry & 0x04) ? ((entry & 0x08) ? 2 : 1) : 0];
+        lut[entry] = colors[(palette >> ((entry % 4) * 2)) & 0x03];
+    }
+}
+
+static void run_reference(unsigned long repeat, double *decode_ns, double *compose_ns)
+{
+    uint64_t start = now_ns();
+    for (unsigned long r = 0; r < repeat; ++r)
+    {
+        for (int tile = 0; tile < TILES; ++tile)
+            ref_decode(tile_data + tile * 16, 8, expected_rows + tile * 64);
+    }
+    *decode_ns = (double)(now_ns() - start) / ((double)repeat * TILES);
+
+    start = now_ns();
+    for (unsigned long r = 0; r < repeat; ++r)
+    {
+        for (int line = 0; line < LINES; ++line)
+            ref_compose(line_bg[line], line_obj[line], line_lcdc[line], palettes, colors, expected_lines[line],
+                        LINE_WIDTH);
+    }
+    *compose_ns = (double)(now_ns() - start) / ((double)repeat * LINES);
+}
+
+/* Returns 0 when the kernels give the reference results */
+static int run_kernels(const struct pixel_kernels *kernels, unsigned long repeat, double *decode_ns,
+                       double *compose_ns)
+{
+    uint32_t lut[16];
+    make_lut(lut);
+
+    uint64_t start = now_ns();
+    for (unsigned long r = 0; r < repeat; ++r)
+    {
+        for (int tile = 0; tile < TILES; ++tile)
+            kernels->decode_rows(tile_data + tile * 16, 8, rows + tile * 64);
+    }
+    *decode_ns = (double)(now_ns() - start) / ((double)repeat * TILES);
+
+    start = now_ns();
+    for (unsigned long r = 0; r < repeat; ++r)
+    {
+        for (int line = 0; line < LINES; ++line)
+            kernels->compose_line(line_bg[line], line_obj[line], line_lcdc[line], lut, lines[line], LINE_WIDTH);
+    }
+    *compose_ns = (double)(now_ns() - start) / ((double)repeat * LINES);
+
+    if (memcmp(rows, expected_rows, sizeof(rows)))
+    {
+        printf("  FAIL %s: decoded tiles differ\n", kernels->name);
+        return 1;
+    }
+    if (memcmp(lines, expected_lines, sizeof(lines)))
+    {
+        printf("  FAIL %s: composed lines differ\n", kernels->name);
+        return 1;
+    }
+
+    /* Batches of any length, as flushed on mid line register writes */
+    for (unsigned int count = 0; count <= LINE_WIDTH; ++count)
+    {
+        memset(lines[0], 0, sizeof(lines[0]));
+        kernels->compose_line(line_bg[1], line_obj[1], line_lcdc[1], lut, lines[0], count);
+        if (memcmp(lines[0], expected_lines[1], count * sizeof(uint32_t)) || (count < LINE_WIDTH && lines[0][count]))
+        {
+            printf("  FAIL %s: batch of %u pixels differs\n", kernels->name, count);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void print_usage(FILE *stream)
+{
+    fprintf(stream, "Usage: pixel_bench [-r REPEAT]\n"
+                    "\nOptions:\n"
+                    "  -r REPEAT   Times the tiles and lines are processed (default: 200).\n"
+                    "  -h          Show this help message and exit.\n");
+}
+
+int main(int argc, char **argv)
+{
+    unsigned long repeat = DEFAULT_REPEAT;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (!strcmp(argv[i], "-r") && i + 1 < argc)
+            repeat = strtoul(argv[++i], NULL, 10);
+        else
+        {
+            print_usage(strcmp(argv[i], "-h") ? stderr : stdout);
+            return strcmp(argv[i], "-h") ? EXIT_FAILURE : EXIT_SUCCESS;
+        }
+    }
+    if (!repeat)
+        repeat = 1;
+
+    make_inputs();
+
+    double decode_ns = 0;
+    double compose_ns = 0;
+    run_reference(repeat, &decode_ns, &compose_ns);
+    printf("%-10s %8.1f ns/tile %8.1f ns/line\n", "reference", decode_ns, compose_ns);
+
+    const struct pixel_kernels *sets[3] = {&pixel_kernels_scalar};
+    size_t count = 1;
+#ifdef PIXEL_KERNELS_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse2"))
+        sets[count++] = &pixel_kernels_sse2;
+    if (__builtin_cpu_supports("avx2"))
+        sets[count++] = &pixel_kernels_avx2;
+#endif
+
+    int failed = 0;
+    for (size_t i = 0; i < count; ++i)
+    {
+        failed |= run_kernels(sets[i], repeat, &decode_ns, &compose_ns);
+        printf("%-10s %8.1f ns/tile %8.1f ns/line\n", sets[i]->name, decode_ns, compose_ns);
+    }
+
+    pixel_kernels_init();
+    printf("Selected: %s\n", pixel_kernels->name);
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
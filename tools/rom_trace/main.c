@@ -0,0 +1,228 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "apu.h"
+#include "disassembler.h"
+#include "display.h"
+#include "emulation.h"
+#include "gb_core.h"
+#include "interrupts.h"
+#include "ppu.h"
+#include "serial.h"
+#include "timers.h"
+#include "utils.h"
+
+/*
+ * Runs ROMs headless for a fixed number of TCycles, the same way the frontend does without the synchronization, and
+ * prints hashes of every frame, of every audio buffer and of the final CPU and memory state. Two builds or two sets of
+ * options are equivalent on a ROM when they print the same line, the host time is reported apart on stderr.
+ *
+ * The last FINISH_TCYCLES are always run by the plain interpreter so every run stops at the same instruction boundary,
+ * whatever the fast paths skipped before.
+ */
+
+#define DEFAULT_TCYCLES 40000000ULL
+#define FINISH_TCYCLES 4096
+#define GB_CLOCK_HZ 4194304.0
+
+#define FNV_OFFSET 1469598103934665603ULL
+#define FNV_PRIME 1099511628211ULL
+
+static struct
+{
+    unsigned long long tcycles;
+    bool interpreter;
+    bool dynarec;
+    bool halt_step;
+    bool scanline_renderer;
+} args = {
+    .tcycles = DEFAULT_TCYCLES,
+};
+
+static struct gb_core gb;
+
+static struct
+{
+    uint64_t frames;
+    uint64_t video;
+    uint64_t audio;
+} trace;
+
+static uint64_t hash(uint64_t h, const void *data, size_t size)
+{
+    const uint8_t *bytes = data;
+    for (size_t i = 0; i < size; ++i)
+        h = (h ^ bytes[i]) * FNV_PRIME;
+    return h;
+}
+
+static int frame_ready(void)
+{
+    ++trace.frames;
+    trace.video = hash(trace.video, get_frame_buffer(), SCREEN_RESOLUTION * sizeof(uint32_t));
+    return 0;
+}
+
+static int queue_audio(void *buffer)
+{
+    trace.audio = hash(trace.audio, buffer, AUDIO_BUFFER_SIZE * sizeof(union audio_sample));
+    return 0;
+}
+
+static int get_queued_audio_sample_count(void)
+{
+    return 0;
+}
+
+static int render_frame(void)
+{
+    return 0;
+}
+
+static void handle_events(struct gb_core *gb)
+{
+    (void)gb;
+}
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static void set_fast_paths(bool enable)
+{
+    struct global_settings *settings = get_global_settings();
+    settings->superinstructions = enable && !args.interpreter;
+    settings->idle_loop_detection = enable && !args.interpreter;
+    settings->dynarec = enable && args.dynarec;
+}
+
+static uint64_t hash_state(struct gb_core *gb)
+{
+    struct cpu *cpu = &gb->cpu;
+    uint8_t registers[] = {
+        cpu->a, get_f(cpu), cpu->b, cpu->c, cpu->d, cpu->e, cpu->h, cpu->l,
+        cpu->sp, cpu->sp >> 8, cpu->pc, cpu->pc >> 8, cpu->ime, gb->halt,
+    };
+    uint64_t h = hash(FNV_OFFSET, registers, sizeof(registers));
+    h = hash(h, gb->memory.wram, WRAM_SIZE);
+    h = hash(h, gb->memory.vram, VRAM_SIZE);
+    h = hash(h, gb->memory.oam, OAM_SIZE);
+    h = hash(h, gb->memory.io, IO_SIZE);
+    h = hash(h, gb->memory.hram, HRAM_SIZE);
+    return hash(h, &gb->memory.ie, 1);
+}
+
+/* Returns EXIT_FAILURE when the ROM couldn't be loaded or ran an undefined opcode */
+static int run_rom(char *path)
+{
+    memset(&trace, 0, sizeof(trace));
+    trace.video = FNV_OFFSET;
+    trace.audio = FNV_OFFSET;
+
+    memset(&gb, 0, sizeof(gb));
+    if (init_gb_core(&gb))
+        return EXIT_FAILURE;
+    gb.callbacks.frame_ready = frame_ready;
+    gb.callbacks.queue_audio = queue_audio;
+    gb.callbacks.get_queued_audio_sample_count = get_queued_audio_sample_count;
+    gb.callbacks.render_frame = render_frame;
+    gb.callbacks.handle_events = handle_events;
+
+    int err = load_rom(&gb, path, NULL);
+    set_fast_paths(true);
+
+    uint64_t start = now_ns();
+    while (!err && gb.tcycles_since_sync < args.tcycles)
+    {
+        uint64_t left = args.tcycles - gb.tcycles_since_sync;
+        if (left <= FINISH_TCYCLES)
+            set_fast_paths(false);
+
+        /* Batches stop at the first boundary past the target, like single instructions would */
+        uint64_t left_mcycles = (left + 3) / 4;
+        if (gb.halt && args.halt_step)
+            tick_m(&gb);
+        else if (gb.halt)
+            halt_fast_forward(&gb, left_mcycles < HALT_FAST_FORWARD_MAX_MCYCLES ? (int)left_mcycles
+                                                                              : HALT_FAST_FORWARD_MAX_MCYCLES);
+        else if (next_ops(&gb, left_mcycles < NEXT_OPS_MAX_MCYCLES ? (int)left_mcycles : NEXT_OPS_MAX_MCYCLES) == -1)
+        {
+            fprintf(stderr, "%s: undefined opcode at PC=0x%04X\n", path, gb.cpu.pc);
+            err = EXIT_FAILURE;
+        }
+        check_interrupt(&gb);
+    }
+    uint64_t elapsed = now_ns() - start;
+
+    if (!err)
+    {
+        ppu_catch_up(&gb);
+        apu_catch_up(&gb);
+        timer_catch_up(&gb);
+        serial_catch_up(&gb);
+
+        const char *name = strrchr(path, '/');
+        printf("%s cycles=%llu frames=%llu pc=%04X video=%016llx audio=%016llx state=%016llx\n", name ? name + 1 : path,
+               (unsigned long long)gb.tcycles_since_sync, (unsigned long long)trace.frames, gb.cpu.pc,
+               (unsigned long long)trace.video, (unsigned long long)trace.audio,
+               (unsigned long long)hash_state(&gb));
+        fprintf(stderr, "%s %.1f ms, %.1fx real time\n", name ? name + 1 : path, elapsed / 1e6,
+                gb.tcycles_since_sync / GB_CLOCK_HZ / (elapsed / 1e9));
+    }
+
+    free_gb_core(&gb);
+    return err;
+}
+
+static void print_usage(FILE *stream)
+{
+    fprintf(stream, "Usage: rom_trace [-c CYCLES] [-i] [-d] [-H] [-s] ROM_PATH...\n"
+                    "\nOptions:\n"
+                    "  -c CYCLES   TCycles to run every ROM for (default: 40000000).\n"
+                    "  -i          Interpreter only: no superinstructions nor idle loop detection.\n"
+                    "  -d          Enable the dynarec.\n"
+                    "  -H          Step a halted CPU one MCycle at a time instead of calling halt_fast_forward().\n"
+                    "  -s          Use the scanline renderer.\n"
+                    "  -h          Show this help message and exit.\n");
+}
+
+int main(int argc, char **argv)
+{
+    int first = 1;
+    for (; first < argc && argv[first][0] == '-'; ++first)
+    {
+        if (!strcmp(argv[first], "-c") && first + 1 < argc)
+            args.tcycles = strtoull(argv[++first], NULL, 10);
+        else if (!strcmp(argv[first], "-i"))
+            args.interpreter = true;
+        else if (!strcmp(argv[first], "-d"))
+            args.dynarec = true;
+        else if (!strcmp(argv[first], "-H"))
+            args.halt_step = true;
+        else if (!strcmp(argv[first], "-s"))
+            args.scanline_renderer = true;
+        else
+        {
+            print_usage(strcmp(argv[first], "-h") ? stderr : stdout);
+            return strcmp(argv[first], "-h") ? EXIT_FAILURE : EXIT_SUCCESS;
+        }
+    }
+    if (first >= argc)
+    {
+        print_usage(stderr);
+        return EXIT_FAILURE;
+    }
+
+    get_global_settings()->turbo = true;
+    get_global_settings()->scanline_renderer = args.scanline_renderer;
+
+    int err = EXIT_SUCCESS;
+    for (int i = first; i < argc; ++i)
+        err |= run_rom(argv[i]);
+    return err ? EXIT_FAILURE : EXIT_SUCCESS;
+}
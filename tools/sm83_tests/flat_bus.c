@@ -0,0 +1,102 @@
+#include "flat_bus.h"
+
+#include "decode_cache.h"
+#include "dynarec.h"
+#include "emulation.h"
+#include "gb_core.h"
+#include "mbc_base.h"
+#include "page_table.h"
+#include "read.h"
+#include "write.h"
+
+/* Bytes a decoded instruction depends on, its superinstruction pattern included */
+#define CODE_REACH 8
+
+struct flat_bus flat_bus;
+
+/* ROM only cartridge over the bus memory, only ever read through read_mbc_rom() and mbc_rom_offset() */
+static struct mbc_base flat_rom = {
+    .type = NO_MBC,
+    .rom = flat_bus.memory,
+    .rom_bank_count = 2,
+    .rom_total_size = 0x8000,
+    .rom_banks = {flat_bus.memory, flat_bus.memory + 0x4000},
+};
+
+static void log_access(struct gb_core *gb, uint16_t address, uint8_t value, char kind)
+{
+    if (flat_bus.log_count >= FLAT_BUS_LOG_SIZE)
+        return;
+    struct bus_access *access = &flat_bus.log[flat_bus.log_count++];
+    access->mcycle = gb->tcycles_since_sync / 4;
+    access->address = address;
+    access->value = value;
+    access->kind = kind;
+}
+
+/* Drop the decoded instructions and compiled blocks which may hold the previous value of address */
+static void invalidate_code(struct gb_core *gb, uint16_t address)
+{
+    /* Blocks are only compiled from ROM, which never changes on a cartridge: there is nothing finer than a flush */
+    if (address < 0x8000)
+        dynarec_flush(gb);
+
+    for (uint16_t offset = 0; offset < CODE_REACH; ++offset)
+    {
+        uint16_t head = address - offset;
+        if (head < 0x8000)
+            gb->decode_cache.entries[head & DECODE_CACHE_MASK].tag = 0;
+    }
+}
+
+uint8_t read_mem_slow(struct gb_core *gb, uint16_t address)
+{
+    (void)gb;
+    return flat_bus.memory[address];
+}
+
+uint8_t read_mem_dma(struct gb_core *gb, uint16_t address)
+{
+    (void)gb;
+    return flat_bus.memory[address];
+}
+
+uint8_t read_mem_tick(struct gb_core *gb, uint16_t address)
+{
+    uint8_t res = flat_bus.memory[address];
+    log_access(gb, address, res, 'r');
+    tick_m(gb);
+    return res;
+}
+
+void write_mem(struct gb_core *gb, uint16_t address, uint8_t val)
+{
+    flat_bus_store(gb, address, val);
+    log_access(gb, address, val, 'w');
+    tick_m(gb);
+}
+
+void flat_bus_store(struct gb_core *gb, uint16_t address, uint8_t val)
+{
+    if (flat_bus.memory[address] == val)
+        return;
+    flat_bus.memory[address] = val;
+    invalidate_code(gb, address);
+}
+
+void flat_bus_map(struct gb_core *gb)
+{
+    gb->mbc = &flat_rom;
+    decode_cache_flush(gb);
+    for (unsigned int page = 0; page < PAGE_COUNT; ++page)
+    {
+        gb->memory.read_pages[page] = flat_bus.memory + (page << PAGE_SHIFT);
+        gb->memory.write_pages[page] = NULL;
+    }
+}
+
+void flat_bus_unmap(struct gb_core *gb)
+{
+    gb->mbc = NULL;
+    page_table_clear(gb);
+}
@@ -0,0 +1,47 @@
+#ifndef SM83_TESTS_FLAT_BUS_H
+#define SM83_TESTS_FLAT_BUS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Flat 64 KiB test bus. flat_bus.c provides read_mem_slow(), read_mem_tick() and write_mem() and is linked in place
+ * of memory/read.c and memory/write.c, so the opcode handlers run unchanged without any memory mapped component.
+ * Every ticked access is logged with the MCycle it happened in.
+ *
+ * flat_bus_map() maps the whole bus in the page table and 0x0000-0x7FFF as a 32 KiB ROM, so instructions there are
+ * fetched through the decode cache and the dynarec like on a cartridge. Such fetches are served from the decoded
+ * instruction and never reach the bus log.
+ */
+
+#define FLAT_BUS_LOG_SIZE 16
+
+struct bus_access
+{
+    uint64_t mcycle; /* Value of tcycles_since_sync / 4 when the access happened */
+    uint16_t address;
+    uint8_t value;
+    char kind; /* 'r' or 'w' */
+};
+
+struct flat_bus
+{
+    uint8_t memory[0x10000];
+
+    size_t log_count;
+    struct bus_access log[FLAT_BUS_LOG_SIZE];
+};
+
+extern struct flat_bus flat_bus;
+
+struct gb_core;
+
+void flat_bus_map(struct gb_core *gb);
+
+/* Untimed write of a test state, keeps the decoded instructions and compiled blocks in sync like write_mem() */
+void flat_bus_store(struct gb_core *gb, uint16_t address, uint8_t val);
+
+/* Must be called before free_gb_core(), nothing the core has to free is mapped */
+void flat_bus_unmap(struct gb_core *gb);
+
+#endif
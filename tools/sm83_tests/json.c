@@ -0,0 +1,192 @@
+#include "json.h"
+
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "logger.h"
+
+struct parser
+{
+    const char *text;
+    size_t pos;
+};
+
+static int parse_value(struct parser *p, struct json_value *out);
+
+static void skip_spaces(struct parser *p)
+{
+    while (isspace((unsigned char)p->text[p->pos]))
+        ++p->pos;
+}
+
+static int expect(struct parser *p, char c)
+{
+    skip_spaces(p);
+    if (p->text[p->pos] != c)
+        return EXIT_FAILURE;
+    ++p->pos;
+    return EXIT_SUCCESS;
+}
+
+static char *parse_string(struct parser *p)
+{
+    if (expect(p, '"'))
+        return NULL;
+
+    size_t start = p->pos;
+    while (p->text[p->pos] && p->text[p->pos] != '"')
+        p->pos += p->text[p->pos] == '\\' && p->text[p->pos + 1] ? 2 : 1;
+    if (!p->text[p->pos])
+        return NULL;
+
+    size_t length = p->pos - start;
+    char *res = malloc(length + 1);
+    if (!res)
+        return NULL;
+
+    /* Escapes are kept as the escaped character */
+    size_t j = 0;
+    for (size_t i = start; i < p->pos; ++i)
+    {
+        if (p->text[i] == '\\')
+            ++i;
+        res[j++] = p->text[i];
+    }
+    res[j] = '\0';
+    ++p->pos;
+    return res;
+}
+
+/* Grows the item (and key) arrays of a container to hold one more element */
+static int push_item(struct json_value *container, int with_key)
+{
+    struct json_value *items = realloc(container->items, (container->count + 1) * sizeof(struct json_value));
+    if (!items)
+        return EXIT_FAILURE;
+    container->items = items;
+    memset(&items[container->count], 0, sizeof(struct json_value));
+
+    if (with_key)
+    {
+        char **keys = realloc(container->keys, (container->count + 1) * sizeof(char *));
+        if (!keys)
+            return EXIT_FAILURE;
+        container->keys = keys;
+        keys[container->count] = NULL;
+    }
+    ++container->count;
+    return EXIT_SUCCESS;
+}
+
+static int parse_container(struct parser *p, struct json_value *out, int object)
+{
+    out->type = object ? JSON_OBJECT : JSON_ARRAY;
+    ++p->pos;
+    skip_spaces(p);
+    if (p->text[p->pos] == (object ? '}' : ']'))
+    {
+        ++p->pos;
+        return EXIT_SUCCESS;
+    }
+
+    while (1)
+    {
+        if (push_item(out, object))
+            return EXIT_FAILURE;
+        if (object)
+        {
+            skip_spaces(p);
+            if (!(out->keys[out->count - 1] = parse_string(p)) || expect(p, ':'))
+                return EXIT_FAILURE;
+        }
+        if (parse_value(p, &out->items[out->count - 1]))
+            return EXIT_FAILURE;
+
+        skip_spaces(p);
+        if (p->text[p->pos] == ',')
+        {
+            ++p->pos;
+            continue;
+        }
+        return expect(p, object ? '}' : ']');
+    }
+}
+
+static int parse_value(struct parser *p, struct json_value *out)
+{
+    skip_spaces(p);
+    const char *c = p->text + p->pos;
+    switch (*c)
+    {
+    case '{':
+        return parse_container(p, out, 1);
+    case '[':
+        return parse_container(p, out, 0);
+    case '"':
+        out->type = JSON_STRING;
+        return (out->string = parse_string(p)) ? EXIT_SUCCESS : EXIT_FAILURE;
+    case 'n':
+        out->type = JSON_NULL;
+        p->pos += 4;
+        return strncmp(c, "null", 4) ? EXIT_FAILURE : EXIT_SUCCESS;
+    case 't':
+        out->type = JSON_BOOL;
+        out->number = 1;
+        p->pos += 4;
+        return strncmp(c, "true", 4) ? EXIT_FAILURE : EXIT_SUCCESS;
+    case 'f':
+        out->type = JSON_BOOL;
+        p->pos += 5;
+        return strncmp(c, "false", 5) ? EXIT_FAILURE : EXIT_SUCCESS;
+    default:
+    {
+        char *end;
+        out->type = JSON_NUMBER;
+        out->number = strtod(c, &end);
+        if (end == c)
+            return EXIT_FAILURE;
+        p->pos += end - c;
+        return EXIT_SUCCESS;
+    }
+    }
+}
+
+int json_parse(const char *text, struct json_value *out)
+{
+    struct parser p = {.text = text, .pos = 0};
+    memset(out, 0, sizeof(struct json_value));
+    if (parse_value(&p, out))
+    {
+        LOG_ERROR("Invalid JSON at offset %zu", p.pos);
+        json_free(out);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+void json_free(struct json_value *value)
+{
+    for (size_t i = 0; i < value->count; ++i)
+    {
+        json_free(&value->items[i]);
+        if (value->keys)
+            free(value->keys[i]);
+    }
+    free(value->items);
+    free(value->keys);
+    free(value->string);
+    memset(value, 0, sizeof(struct json_value));
+}
+
+const struct json_value *json_get(const struct json_value *object, const char *key)
+{
+    if (object->type != JSON_OBJECT)
+        return NULL;
+    for (size_t i = 0; i < object->count; ++i)
+    {
+        if (object->keys[i] && !strcmp(object->keys[i], key))
+            return &object->items[i];
+    }
+    return NULL;
+}
@@ -0,0 +1,36 @@
+#ifndef SM83_TESTS_JSON_H
+#define SM83_TESTS_JSON_H
+
+#include <stddef.h>
+
+/* Minimal JSON reader, enough for the single-step test vectors (no unicode escapes) */
+
+enum json_type
+{
+    JSON_NULL = 0,
+    JSON_BOOL,
+    JSON_NUMBER,
+    JSON_STRING,
+    JSON_ARRAY,
+    JSON_OBJECT,
+};
+
+struct json_value
+{
+    enum json_type type;
+    double number; /* Also holds booleans */
+    char *string;
+
+    /* Elements of an array or values of an object, keys is only set for objects */
+    size_t count;
+    struct json_value *items;
+    char **keys;
+};
+
+int json_parse(const char *text, struct json_value *out);
+void json_free(struct json_value *value);
+
+/* NULL when the key is missing or value is not an object */
+const struct json_value *json_get(const struct json_value *object, const char *key);
+
+#endif
@@ -0,0 +1,478 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "disassembler.h"
+#include "emulation.h"
+#include "flat_bus.h"
+#include "gb_core.h"
+#include "idle_loop.h"
+#include "interrupts.h"
+#include "json.h"
+#include "logger.h"
+#include "opcode_table.h"
+#include "utils.h"
+
+/*
+ * Runs the JSON single-step SM83 test vectors (one file per opcode, e.g. "3e.json" or "cb 46.json") through
+ * next_op() on the flat test bus, then replays every file to measure the nanoseconds spent per instruction. Every file
+ * is run once per execution tier, each one enabling one of the optional fast paths of next_op(). The dynarec is built
+ * to compile every instruction it supports on its first execution (see CMakeLists.txt).
+ */
+
+#define MAX_RAM 16
+#define MAX_CYCLES 8
+#define DEFAULT_REPEAT 100
+
+struct sm83_state
+{
+    uint16_t pc;
+    uint16_t sp;
+    uint8_t a;
+    uint8_t f;
+    uint8_t b;
+    uint8_t c;
+    uint8_t d;
+    uint8_t e;
+    uint8_t h;
+    uint8_t l;
+    uint8_t ime;
+    uint8_t ei; /* IME enable pending */
+    uint8_t ie;
+
+    size_t ram_count;
+    uint16_t ram_address[MAX_RAM];
+    uint8_t ram_value[MAX_RAM];
+};
+
+struct sm83_test
+{
+    char name[64];
+    struct sm83_state initial;
+    struct sm83_state final;
+
+    /* Expected bus activity of every MCycle, kind is 0 for internal cycles */
+    size_t cycle_count;
+    struct bus_access cycles[MAX_CYCLES];
+};
+
+struct tier
+{
+    const char *name;
+    bool superinstructions;
+    bool idle_loop_detection;
+    bool dynarec;
+};
+
+static const struct tier tiers[] = {
+    {"interpreter", false, false, false},
+    {"superop", true, false, false},
+    {"idle loop", false, true, false},
+    {"dynarec", false, false, true},
+};
+
+#define TIER_COUNT (sizeof(tiers) / sizeof(tiers[0]))
+
+static struct
+{
+    int verbose;
+    unsigned long repeat;
+} args = {.repeat = DEFAULT_REPEAT};
+
+static int get_uint(const struct json_value *object, const char *key, int required, unsigned int *out)
+{
+    const struct json_value *value = json_get(object, key);
+    if (!value || value->type != JSON_NUMBER)
+    {
+        *out = 0;
+        return required ? EXIT_FAILURE : EXIT_SUCCESS;
+    }
+    *out = (unsigned int)value->number;
+    return EXIT_SUCCESS;
+}
+
+static int parse_state(const struct json_value *object, struct sm83_state *state)
+{
+    unsigned int v[13];
+    static const char *const keys[13] = {"pc", "sp", "a", "f", "b", "c", "d", "e", "h", "l", "ime", "ei", "ie"};
+    for (size_t i = 0; i < 13; ++i)
+    {
+        if (get_uint(object, keys[i], i < 10, &v[i]))
+            return EXIT_FAILURE;
+    }
+    *state = (struct sm83_state){
+        .pc = v[0], .sp = v[1], .a = v[2], .f = v[3], .b = v[4], .c = v[5], .d = v[6],
+        .e = v[7],  .h = v[8],  .l = v[9], .ime = v[10], .ei = v[11], .ie = v[12],
+    };
+
+    const struct json_value *ram = json_get(object, "ram");
+    if (!ram || ram->type != JSON_ARRAY || ram->count > MAX_RAM)
+        return EXIT_FAILURE;
+    for (size_t i = 0; i < ram->count; ++i)
+    {
+        const struct json_value *entry = &ram->items[i];
+        if (entry->type != JSON_ARRAY || entry->count != 2)
+            return EXIT_FAILURE;
+        state->ram_address[i] = (uint16_t)entry->items[0].number;
+        state->ram_value[i] = (uint8_t)entry->items[1].number;
+    }
+    state->ram_count = ram->count;
+    return EXIT_SUCCESS;
+}
+
+static int parse_test(const struct json_value *object, struct sm83_test *test)
+{
+    const struct json_value *name = json_get(object, "name");
+    const struct json_value *initial = json_get(object, "initial");
+    const struct json_value *final = json_get(object, "final");
+    const struct json_value *cycles = json_get(object, "cycles");
+    if (!initial || !final || !cycles || cycles->type != JSON_ARRAY || cycles->count > MAX_CYCLES)
+        return EXIT_FAILURE;
+
+    snprintf(test->name, sizeof(test->name), "%s", name && name->type == JSON_STRING ? name->string : "?");
+    if (parse_state(initial, &test->initial) || parse_state(final, &test->final))
+        return EXIT_FAILURE;
+
+    test->cycle_count = cycles->count;
+    for (size_t i = 0; i < cycles->count; ++i)
+    {
+        const struct json_value *cycle = &cycles->items[i];
+        struct bus_access *access = &test->cycles[i];
+        memset(access, 0, sizeof(struct bus_access));
+        access->mcycle = i;
+
+        /* Internal cycles are either null or have a "---" like activity string */
+        if (cycle->type != JSON_ARRAY || cycle->count < 3 || cycle->items[2].type != JSON_STRING)
+            continue;
+        const char *activity = cycle->items[2].string;
+        access->kind = strchr(activity, 'r') ? 'r' : strchr(activity, 'w') ? 'w' : 0;
+        access->address = (uint16_t)cycle->items[0].number;
+        access->value = (uint8_t)cycle->items[1].number;
+    }
+    return EXIT_SUCCESS;
+}
+
+static char *read_file(const char *path)
+{
+    FILE *file = fopen(path, "rb");
+    if (!file)
+    {
+        LOG_ERROR("Couldn't open %s", path);
+        return NULL;
+    }
+
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    char *res = size >= 0 ? malloc(size + 1) : NULL;
+    if (!res || fread(res, 1, size, file) != (size_t)size)
+    {
+        LOG_ERROR("Couldn't read %s", path);
+        free(res);
+        fclose(file);
+        return NULL;
+    }
+    res[size] = '\0';
+    fclose(file);
+    return res;
+}
+
+static struct sm83_test *load_tests(const char *path, size_t *count)
+{
+    char *text = read_file(path);
+    if (!text)
+        return NULL;
+
+    struct json_value root;
+    int err = json_parse(text, &root);
+    free(text);
+    if (err)
+        return NULL;
+
+    struct sm83_test *tests = NULL;
+    if (root.type == JSON_ARRAY && root.count)
+        tests = malloc(root.count * sizeof(struct sm83_test));
+    if (!tests)
+        LOG_ERROR("%s doesn't hold any test", path);
+
+    for (size_t i = 0; tests && i < root.count; ++i)
+    {
+        if (parse_test(&root.items[i], &tests[i]))
+        {
+            LOG_ERROR("Malformed test %zu in %s", i, path);
+            free(tests);
+            tests = NULL;
+        }
+    }
+
+    *count = root.count;
+    json_free(&root);
+    return tests;
+}
+
+static void load_state(struct gb_core *gb, const struct sm83_state *state)
+{
+    struct cpu *cpu = &gb->cpu;
+    cpu->pc = state->pc;
+    cpu->sp = state->sp;
+    cpu->a = state->a;
+    cpu->f = state->f;
+    cpu->flags_kind = FLAGS_MATERIALISED;
+    cpu->b = state->b;
+    cpu->c = state->c;
+    cpu->d = state->d;
+    cpu->e = state->e;
+    cpu->h = state->h;
+    cpu->l = state->l;
+    /* A pending enable becomes effective after the instruction, same as right after ei's first MCycle */
+    cpu->ime = state->ime ? 1 : state->ei ? 2 : 0;
+
+    gb->halt = 0;
+    gb->halt_bug = 0;
+    gb->memory.ie = state->ie;
+    update_pending_interrupts(gb);
+    idle_loop_flush(gb);
+
+    for (size_t i = 0; i < state->ram_count; ++i)
+        flat_bus_store(gb, state->ram_address[i], state->ram_value[i]);
+    flat_bus.log_count = 0;
+}
+
+/* Length of the instruction at PC when it is fetched from the decode cache instead of the bus, 0 otherwise */
+static uint8_t cached_fetch_length(const struct sm83_state *state)
+{
+#define OPCODE_LENGTH(OPCODE, MNEMONIC, LENGTH, HANDLER) [OPCODE] = LENGTH,
+    static const uint8_t lengths[256] = {SM83_OPCODE_TABLE(OPCODE_LENGTH)};
+#undef OPCODE_LENGTH
+
+    if (state->pc >= 0x8000)
+        return 0;
+    for (size_t i = 0; i < state->ram_count; ++i)
+    {
+        if (state->ram_address[i] != state->pc)
+            continue;
+        uint8_t length = lengths[state->ram_value[i]];
+        return (state->pc & 0x3FFF) + length <= 0x4000 ? length : 0;
+    }
+    return 0;
+}
+
+#define CHECK_REGISTER(NAME, ACTUAL, EXPECTED)                                                                         \
+    if ((ACTUAL) != (EXPECTED))                                                                                        \
+    {                                                                                                                  \
+        snprintf(error, size, "%s is 0x%X, expected 0x%X", NAME, (unsigned int)(ACTUAL), (unsigned int)(EXPECTED));    \
+        return EXIT_FAILURE;                                                                                           \
+    }
+
+static int check_state(struct gb_core *gb, const struct sm83_test *test, uint64_t start, char *error, size_t size)
+{
+    struct cpu *cpu = &gb->cpu;
+    const struct sm83_state *expected = &test->final;
+    CHECK_REGISTER("PC", cpu->pc, expected->pc);
+    CHECK_REGISTER("SP", cpu->sp, expected->sp);
+    CHECK_REGISTER("A", cpu->a, expected->a);
+    CHECK_REGISTER("F", get_f(cpu), expected->f);
+    CHECK_REGISTER("B", cpu->b, expected->b);
+    CHECK_REGISTER("C", cpu->c, expected->c);
+    CHECK_REGISTER("D", cpu->d, expected->d);
+    CHECK_REGISTER("E", cpu->e, expected->e);
+    CHECK_REGISTER("H", cpu->h, expected->h);
+    CHECK_REGISTER("L", cpu->l, expected->l);
+    CHECK_REGISTER("IME", cpu->ime == 1, expected->ime);
+    CHECK_REGISTER("IME pending", cpu->ime > 1, expected->ei);
+
+    for (size_t i = 0; i < expected->ram_count; ++i)
+    {
+        uint16_t address = expected->ram_address[i];
+        if (flat_bus.memory[address] != expected->ram_value[i])
+        {
+            snprintf(error, size, "(0x%04X) is 0x%02X, expected 0x%02X", address, flat_bus.memory[address],
+                     expected->ram_value[i]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    uint64_t mcycles = (gb->tcycles_since_sync - start) / 4;
+    CHECK_REGISTER("MCycle count", mcycles, test->cycle_count);
+
+    /* Fetches served by the decode cache are the only expected accesses allowed to be missing from the log */
+    uint8_t fetch_length = cached_fetch_length(&test->initial);
+    size_t logged = 0;
+    for (size_t i = 0; i < test->cycle_count; ++i)
+    {
+        const struct bus_access *cycle = &test->cycles[i];
+        if (logged < flat_bus.log_count && flat_bus.log[logged].mcycle - start / 4 == i)
+        {
+            const struct bus_access *access = &flat_bus.log[logged++];
+            if (access->kind != cycle->kind || access->address != cycle->address || access->value != cycle->value)
+            {
+                snprintf(error, size, "MCycle %zu: %c 0x%04X=0x%02X, expected %c 0x%04X=0x%02X", i, access->kind,
+                         access->address, access->value, cycle->kind ? cycle->kind : '-', cycle->address,
+                         cycle->value);
+                return EXIT_FAILURE;
+            }
+        }
+        else if (cycle->kind && (cycle->kind != 'r' || (uint16_t)(cycle->address - test->initial.pc) >= fetch_length))
+        {
+            snprintf(error, size, "MCycle %zu: no access, expected %c 0x%04X=0x%02X", i, cycle->kind, cycle->address,
+                     cycle->value);
+            return EXIT_FAILURE;
+        }
+    }
+    CHECK_REGISTER("Bus access count", flat_bus.log_count, logged);
+    return EXIT_SUCCESS;
+}
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/* Nanoseconds per instruction, the time spent restoring the initial states is measured apart and removed */
+static double measure(struct gb_core *gb, const struct sm83_test *tests, size_t count)
+{
+    uint64_t start = now_ns();
+    for (unsigned long r = 0; r < args.repeat; ++r)
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            load_state(gb, &tests[i].initial);
+            next_op(gb);
+        }
+    }
+    uint64_t total = now_ns() - start;
+
+    start = now_ns();
+    for (unsigned long r = 0; r < args.repeat; ++r)
+    {
+        for (size_t i = 0; i < count; ++i)
+            load_state(gb, &tests[i].initial);
+    }
+    uint64_t setup = now_ns() - start;
+
+    return total > setup ? (double)(total - setup) / ((double)args.repeat * count) : 0.0;
+}
+
+static size_t run_tests(struct gb_core *gb, const struct sm83_test *tests, size_t count)
+{
+    size_t failed = 0;
+    for (size_t i = 0; i < count; ++i)
+    {
+        char error[128];
+        uint64_t start = gb->tcycles_since_sync;
+        load_state(gb, &tests[i].initial);
+        int res = next_op(gb);
+        if (res == -1)
+            snprintf(error, sizeof(error), "Undefined opcode");
+        if (res == -1 || check_state(gb, &tests[i], start, error, sizeof(error)))
+        {
+            if (args.verbose || !failed)
+                printf("  FAIL %s: %s\n", tests[i].name, error);
+            ++failed;
+        }
+    }
+    return failed;
+}
+
+/* Returns the number of failed tests over every tier or -1 when the file couldn't be loaded */
+static long run_file(struct gb_core *gb, const char *path)
+{
+    size_t count = 0;
+    struct sm83_test *tests = load_tests(path, &count);
+    if (!tests)
+        return -1;
+
+    const char *name = strrchr(path, '/');
+    struct global_settings *settings = get_global_settings();
+    size_t failed = 0;
+    for (size_t t = 0; t < TIER_COUNT; ++t)
+    {
+        settings->superinstructions = tiers[t].superinstructions;
+        settings->idle_loop_detection = tiers[t].idle_loop_detection;
+        settings->dynarec = tiers[t].dynarec;
+
+        size_t tier_failed = run_tests(gb, tests, count);
+        printf("%-12s %-12s %5zu/%-5zu passed %9.1f ns/op\n", name ? name + 1 : path, tiers[t].name,
+               count - tier_failed, count, measure(gb, tests, count));
+        failed += tier_failed;
+    }
+    free(tests);
+    return failed;
+}
+
+static void print_usage(FILE *stream)
+{
+    fprintf(stream, "Usage: sm83_tests [-v] [-r REPEAT] TEST_FILE...\n"
+                    "\nOptions:\n"
+                    "  -v          Print every failing test instead of the first one of each file.\n"
+                    "  -r REPEAT   Times each file is replayed for the timings (default: 100).\n"
+                    "  -h          Show this help message and exit.\n");
+}
+
+static int queue_audio(void *buffer)
+{
+    (void)buffer;
+    return 0;
+}
+
+static int get_queued_audio_sample_count(void)
+{
+    return 0;
+}
+
+static int frame_ready(void)
+{
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    int first = 1;
+    for (; first < argc && argv[first][0] == '-'; ++first)
+    {
+        if (!strcmp(argv[first], "-v"))
+            args.verbose = 1;
+        else if (!strcmp(argv[first], "-r") && first + 1 < argc)
+            args.repeat = strtoul(argv[++first], NULL, 10);
+        else
+        {
+            print_usage(strcmp(argv[first], "-h") ? stderr : stdout);
+            return strcmp(argv[first], "-h") ? EXIT_FAILURE : EXIT_SUCCESS;
+        }
+    }
+    if (first >= argc)
+    {
+        print_usage(stderr);
+        return EXIT_FAILURE;
+    }
+
+    static struct gb_core gb;
+    memset(&gb, 0, sizeof(gb));
+    if (init_gb_core(&gb))
+        return EXIT_FAILURE;
+    gb.callbacks.queue_audio = queue_audio;
+    gb.callbacks.get_queued_audio_sample_count = get_queued_audio_sample_count;
+    gb.callbacks.frame_ready = frame_ready;
+
+    flat_bus_map(&gb);
+
+    size_t failed_files = 0;
+    int err = EXIT_SUCCESS;
+    for (int i = first; i < argc; ++i)
+    {
+        long failed = run_file(&gb, argv[i]);
+        if (failed)
+            ++failed_files;
+        if (failed < 0)
+            err = EXIT_FAILURE;
+    }
+    printf("%zu/%d files passed\n", argc - first - failed_files, argc - first);
+
+    flat_bus_unmap(&gb);
+    free_gb_core(&gb);
+    return err || failed_files ? EXIT_FAILURE : EXIT_SUCCESS;
+}